@@ -1,75 +1,110 @@
 #ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_ANIMATION_ENGINE_HPP
 #define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_ANIMATION_ENGINE_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
 #include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
 #include <utility>
-#include <windows.h>
+#include <vector>
 
+#include "animation/behavior.hpp"
+#include "animation/frame_pacing.hpp"
+#include "animation/render_stats.hpp"
 #include "geometry/graph.hpp"
 #include "geometry/scene.hpp"
 #include "graphics/camera.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/hidden_lines.hpp"
+#include "graphics/occlusion.hpp"
 #include "graphics/quad_mesh.hpp"
 #include "graphics/triangle_mesh.hpp"
-#include "output/d3d9_screen.hpp"
+#include "output/command_buffer.hpp"
+#include "output/screen.hpp"
+#include "util/frame_arena.hpp"
+#include "util/job_system.hpp"
+#include "util/profiler.hpp"
 
 namespace vbag {
 
-/// @class Engine
-/// @brief The Engine class provides a framework for creating and
-/// animating scenes.
-///
-/// The Engine class is responsible for managing scenes, drawing
-/// elements, and controlling the animation loop. It should allow dynamic scene
-/// changes, and provides functionality for drawing lines and graphs on the
-/// screen.
-class Engine {
+/// @class EngineCore
+/// @brief Everything an engine does that doesn't depend on the types of its
+/// setup and loop functions: managing the scene, drawing it and presenting
+/// it. The animation loop is up to BasicEngine, which derives from it.
+class EngineCore {
   // TODO: add a setScene method, allowing for dynamic scene changing
 public:
-  /// @brief Alias for a function pointer used in setup and loop animations.
-  ///
-  /// An RenderFunc represents a function pointer that takes an Engine*
-  /// as an argument. It is used to define setup and loop animations for the
-  /// Engine.
-  using RenderFunc = std::function<void(Engine *)>;
-
-  /// @brief Constructs an Engine object with the given parameters.
+  /// @brief Constructs the core of an engine.
   ///
   /// @param screen The reference to the Screen object where the animation will
   /// be displayed.
-  /// @param setup The function to be executed once at the beginning of the
-  /// animation.
-  /// @param loop The function to be executed repeatedly during the animation
-  /// loop.
   /// @param scene The initial scene to be displayed.
-  /// @param frameRate The desired frame rate for the animation (default
-  /// is 60.0).
-  Engine(Screen &screen, RenderFunc setup, RenderFunc loop,
-                  Scene scene, float frameRate = 60.0F);
+  /// @param frameRate The desired frame rate for the animation.
+  /// @param threads How many threads process the scene, the one drawing
+  /// included; 0 means one per hardware thread.
+  EngineCore(Screen &screen, Scene scene, float frameRate, size_t threads);
+
+  EngineCore(const EngineCore &) = delete;
+  EngineCore &operator=(const EngineCore &) = delete;
 
-  /// @brief Draws a graph on the screen.
+  /// @brief Presents the frames still in the pipeline and stops the thread
+  /// presenting them.
+  ~EngineCore();
+
+  /// @brief Projects the edges of a graph to the screen, for the caller to
+  /// draw.
+  ///
+  /// Edges are clipped against the near and far planes (and against the
+  /// guard band, if they reach that far), so edges that cross the near plane
+  /// are shortened instead of dropped. With hidden line removal enabled, the
+  /// faces of the graph are drawn into the depth prepass of the next frame
+  /// the engine draws as well.
   ///
   /// @param g A pointer to the object representing the graph.
-  /// @param thickness The thickness of the graph (default is 3).
-  /// @param fill The character representing the graph (default is '#').
+  /// @param dst The list the visible edges are appended to.
   void queueGraph(const GV3F *g, std::vector<Line> &dst);
 
+  /// @brief Records a triangle mesh into the command buffer of the frame.
+  ///
+  /// Triangles are clipped just like graph edges are, and back-facing ones
+  /// are dropped before reaching the screen if back-face culling is enabled.
+  /// The ones left are kept as a single packet until the next frame the
+  /// engine draws (this one, when called from a setup or loop function),
+  /// which hands them to the screen along with the scene.
+  ///
+  /// @param mesh A pointer to the mesh.
   void drawMesh(const TriangleMesh *mesh);
 
+  /// @brief Records a quad mesh, split in triangles, like drawMesh does.
+  ///
+  /// @param mesh A pointer to the mesh.
   void drawQuadMesh(const QuadMesh *mesh);
 
   /// @brief Draws the current scene on the screen.
-  void draw();
-
-  /// @brief Starts the animation loop and continues indefinitely until the
-  /// program terminates.
   ///
-  /// This function will continuously execute the setup animation function once
-  /// and the loop animation function at the specified frame rate until the
-  /// program is terminated or an exception is thrown.
+  /// The scene is recorded into a command buffer first, which is then sorted
+  /// and executed on the screen in one pass. Objects whose bounding boxes are
+  /// outside the view volume, or hidden according to the occlusion culling
+  /// mode, are skipped before any of their vertices are transformed.
   ///
-  /// @note This function does not return.
-  [[noreturn]] void run();
+  /// Objects are culled, transformed and recorded in parallel on the job
+  /// system, large meshes split into chunks of their own. Every object is
+  /// recorded into a list of its own, and the lists are merged in scene
+  /// order, so the frame doesn't depend on how the jobs were scheduled.
+  ///
+  /// Everything that only lives while the frame is recorded comes from a
+  /// frame arena, reset as recording starts, so once the storage kept
+  /// between frames has settled, recording doesn't touch the heap; see
+  /// frameAllocations.
+  ///
+  /// Frames still in the pipeline are presented first.
+  void draw();
 
   /// @brief Returns the desired frame rate for the animation.
   ///
@@ -93,27 +128,608 @@ public:
   /// @return Reference to the Camera object.
   [[nodiscard]] Camera &camera();
 
+  /// @brief Returns the job system the scene is processed on, which setup
+  /// and loop functions can run jobs of their own on.
+  ///
+  /// @return Reference to the job system.
+  [[nodiscard]] JobSystem &jobs();
+
   /// @brief Static function to introduce a delay in the animation.
   ///
+  /// The delay is kept with preciseSleepUntil, to well under a millisecond.
+  ///
   /// @param milliseconds The number of milliseconds to delay the animation by.
   static void delay(float);
 
-  /// @brief Returns the time elapsed between the current and the previous
-  /// animation frame.
+  /// @brief Returns the time elapsed between the starts of the current and
+  /// the previous animation frame, or 0 for the first frame.
   ///
   /// @return The time elapsed in seconds.
   [[nodiscard]] float deltaTime() const;
 
+  /// @brief Returns the length of a fixed update step.
+  ///
+  /// @return The step in seconds.
+  [[nodiscard]] double fixedDeltaTime() const;
+
+  /// @brief Returns how far the current frame is between the last fixed
+  /// update and the next one.
+  ///
+  /// @return The fraction of a step, in [0, 1).
+  [[nodiscard]] double interpolationAlpha() const;
+
+  /// @brief Enables or disables back-face culling of mesh triangles.
+  ///
+  /// Front faces are the ones whose vertices are in counter-clockwise order
+  /// when looked at. Culling is enabled by default.
+  ///
+  /// @param enabled Whether back-facing triangles should be dropped.
+  void setBackfaceCulling(bool enabled);
+
+  /// @brief Returns whether back-face culling of mesh triangles is enabled.
+  ///
+  /// @return True if back-facing triangles are dropped.
+  [[nodiscard]] bool backfaceCulling() const;
+
+  /// @brief Sets how objects hidden behind others are found and skipped.
+  ///
+  /// The bounding box of every object is tested against a hierarchical depth
+  /// buffer built at the start of each frame, either from the meshes marked
+  /// with TriangleMesh::setOccluder or from the depth the screen kept from
+  /// the previous frame. Without a depth buffer on the screen, the latter
+  /// culls nothing. Occlusion culling is disabled by default.
+  ///
+  /// @param mode Where the depth buffer comes from.
+  void setOcclusionCulling(OcclusionCulling mode);
+
+  /// @brief Enables or disables hidden line removal.
+  ///
+  /// When enabled, the faces of graphs and the triangles of meshes are
+  /// rasterized into a depth-only prepass, and graph edges are split into the
+  /// pieces in front of it, so wireframes only show what's facing the
+  /// camera. Graphs without faces are still hidden by other objects. Meshes
+  /// can be drawn as wireframes by turning them into graphs with
+  /// toWireframe. Disabled by default.
+  ///
+  /// @param enabled Whether hidden lines should be removed.
+  void setHiddenLineRemoval(bool enabled);
+
+  /// @brief Returns whether hidden line removal is enabled.
+  ///
+  /// @return True if edges behind faces are removed.
+  [[nodiscard]] bool hiddenLineRemoval() const;
+
+  /// @brief Returns how objects hidden behind others are found.
+  ///
+  /// @return The occlusion culling mode.
+  [[nodiscard]] OcclusionCulling occlusionCulling() const;
+
+  /// @brief Sets how many frames can be in flight at once.
+  ///
+  /// With a depth of 1, every frame is updated, drawn and presented before
+  /// the next one starts. With a depth of 2 or 3, a thread of its own draws
+  /// and presents the frames from the commands recorded for them, while the
+  /// loop function already updates the next one, so a frame takes about as
+  /// long as the slower of the two instead of both. Up to depth - 1 frames
+  /// wait to be presented, each adding up to a frame of latency; see
+  /// frameLatency. Loop functions must not touch the screen themselves while
+  /// frames are pipelined, and previous-frame occlusion culling uses the
+  /// depth of the last frame presented, which can be older than the
+  /// previous one. The depth is 1 by default.
+  ///
+  /// @param depth The number of frames in flight, clamped to [1, 3].
+  void setPipelineDepth(size_t depth);
+
+  /// @brief Returns how many frames can be in flight at once.
+  ///
+  /// @return The pipeline depth.
+  [[nodiscard]] size_t pipelineDepth() const;
+
+  /// @brief Returns how long the last presented frame took from the start of
+  /// its update to the end of its present.
+  ///
+  /// @return The latency in seconds.
+  [[nodiscard]] float frameLatency() const;
+
+  /// @brief Returns how many heap allocations rendering the last frame made,
+  /// on every thread, from the end of its loop function to the end of its
+  /// present (or, with a deeper pipeline, until it was handed to the
+  /// pipeline).
+  ///
+  /// Allocations are only counted when the library is built with
+  /// VBAG_COUNT_ALLOCATIONS; otherwise this is always 0. Debug builds that
+  /// count them also assert that rendering makes none once the first few
+  /// frames have been drawn, or the first few since the settings of the
+  /// engine changed. What the update makes is counted apart; see
+  /// updateAllocations.
+  ///
+  /// @return The number of allocations.
+  [[nodiscard]] size_t frameAllocations() const;
+
+  /// @brief Returns how many heap allocations the update of the last frame
+  /// made: its fixed updates, behaviors and loop function, along with
+  /// whatever they drew themselves.
+  ///
+  /// Like frameAllocations, this is always 0 unless the library is built
+  /// with VBAG_COUNT_ALLOCATIONS, but nothing asserts on it.
+  ///
+  /// @return The number of allocations.
+  [[nodiscard]] size_t updateAllocations() const;
+
+  /// @brief Returns what the engine did to render the frames presented so
+  /// far: objects visited, culled and drawn, vertices transformed, primitives
+  /// clipped and submitted, calls made to the screen and bytes handed to it.
+  ///
+  /// Every thread counts into a slot of its own while a frame is recorded,
+  /// and the slots are summed once it's done, so the counters are cheap
+  /// enough to always be on. With frames pipelined, a frame is counted once
+  /// it's presented.
+  ///
+  /// @return The statistics of the last frame, and sums over the recent
+  /// frames and all of them.
+  [[nodiscard]] RenderStats stats() const;
+
+  /// @brief Starts a behavior, running it up to its first co_await.
+  ///
+  /// From then on it's resumed when what it awaits comes, every frame after
+  /// the fixed updates and before the loop function, on the thread running
+  /// them. Behaviors still running when the engine is destroyed are
+  /// destroyed with it.
+  ///
+  /// @param behavior The behavior to run.
+  /// @throw What the behavior threw, if it threw before suspending.
+  void spawn(Behavior behavior);
+
+  /// @brief Returns the scheduler running the behaviors of the engine.
+  [[nodiscard]] BehaviorScheduler &behaviors();
+
+protected:
+  /// @brief Starts timing a frame, and counting its allocations.
+  ///
+  /// @return The time since the previous frame started.
+  std::chrono::steady_clock::duration beginFrame_();
+
+  /// @brief Returns how many fixed update steps fit in the time since the
+  /// previous frame.
+  size_t fixedSteps_(std::chrono::steady_clock::duration elapsed);
+
+  /// @brief Sets how many fixed update steps are taken per second.
+  void setFixedRate_(double rate);
+
+  /// @brief Resumes the behaviors due this frame.
+  void updateBehaviors_(std::chrono::steady_clock::duration elapsed);
+
+  /// @brief Draws and presents the scene after the loop function has run,
+  /// or hands it to the pipeline.
+  void endFrame_();
+
+  /// @brief Waits until the next frame is due, at the frame rate.
+  void waitForFrame_();
+
+  /// @brief Pumps the window messages of the thread until the window is
+  /// closed. Does nothing without windows.
+  static void pumpWindowMessages_();
+
+  /// @brief Waits until every frame in the pipeline has been presented.
+  ///
+  /// @throw The exception presenting a frame threw, if any.
+  void flush_();
+
 private:
+  /// @brief The screen triangles emitted by a chunk of a mesh.
+  struct MeshChunk {
+    ArenaVector<V3F> vertices;
+    ArenaVector<D3DCOLOR> colors;
+
+    /// @brief Empties the chunk, drawing its storage from an arena.
+    void reset(const ArenaAllocator<std::byte> &allocator);
+  };
+
+  /// @brief What an object records while being drawn. The lists are kept
+  /// between frames, while their storage comes from the frame arena.
+  struct DrawList {
+    ArenaVector<Line> lines;
+    /// @brief The faces for the hidden line prepass, three vertices each.
+    ArenaVector<V3F> faces;
+    ArenaVector<V4F> clipped;      ///< The clip space vertices of a mesh.
+    ArenaVector<uint8_t> outcodes; ///< The view outcodes of clipped.
+    std::vector<MeshChunk> chunks;
+    /// @brief The screen triangles of a mesh, three vertices each.
+    MeshChunk triangles;
+
+    /// @brief Empties the list, drawing its storage from an arena.
+    void reset(const ArenaAllocator<std::byte> &allocator);
+  };
+
+  /// @brief What drawing a mesh needs of it, so quad meshes can be drawn
+  /// from triangles made up for the frame.
+  struct MeshView {
+    const Object *object;
+    std::span<const V3F> vertices, normals;
+    std::span<const TriangleMesh::Triangle> triangles;
+  };
+
+  /// @brief Returns an allocator drawing from the sub-arena of the calling
+  /// thread.
+  [[nodiscard]] ArenaAllocator<std::byte> frameAllocator_();
+
+  /// @brief Returns the whole of a triangle mesh.
+  static MeshView viewOf_(const TriangleMesh *mesh);
+
+  /// @brief Splits every quad of a mesh in two.
+  ///
+  /// @param mesh The mesh.
+  /// @param triangles Where the triangles are stored.
+  /// @return The mesh, with the triangles in place of its quads.
+  static MeshView
+  triangulate_(const QuadMesh *mesh,
+               ArenaVector<TriangleMesh::Triangle> &triangles);
+
+  /// @brief Transforms and clips the edges of a graph into a list, and its
+  /// faces too with hidden line removal enabled.
+  void queueGraph_(const GV3F *g, DrawList &list) const;
+
+  /// @brief Transforms and clips the triangles of a mesh into a list,
+  /// splitting large meshes into jobs.
+  void drawMesh_(const MeshView &mesh, DrawList &list);
+
+  /// @brief Clips and emits the screen triangles of a range of triangles of
+  /// a mesh whose vertices are in list.clipped.
+  void emitTriangles_(const MeshView &mesh, const DrawList &list,
+                      size_t begin, size_t end,
+                      std::span<const D3DCOLOR> vertexColors,
+                      MeshChunk &out) const;
+
+  /// @brief The counters of a thread, on a cache line of their own.
+  struct alignas(64) ThreadStats {
+    FrameStats stats;
+  };
+
+  /// @brief Returns the counters of the calling thread for the frame being
+  /// recorded.
+  [[nodiscard]] FrameStats &counters_() const;
+
+  /// @brief Adds a frame that has been drawn to the statistics.
+  ///
+  /// @param stats What recording the frame counted.
+  /// @param submission What drawing it handed to the screen.
+  void addFrameStats_(FrameStats stats,
+                      const CommandBuffer::Submission &submission);
+
+  /// @brief A recorded frame waiting to be presented by the pipeline.
+  struct PipelinedFrame {
+    CommandBuffer commands;
+    FrameStats stats; ///< What recording the frame counted.
+    /// @brief When the update of the frame started.
+    std::chrono::steady_clock::time_point start;
+    /// @brief Whether the depth of the frame should be kept for occlusion
+    /// culling.
+    bool keepsDepth{};
+  };
+
+  /// @brief Records the scene into commands_, without executing it.
+  void record_();
+
+  /// @brief Records the scene and executes it on the screen, like draw, but
+  /// leaves adding the frame to the statistics to the caller.
+  ///
+  /// @return What drawing handed to the screen.
+  CommandBuffer::Submission draw_();
+
+  /// @brief Counts the allocations made since the frame began rendering,
+  /// once it has been presented or handed to the pipeline.
+  void countFrameAllocations_();
+
+  /// @brief Hands the frame in commands_ to the presenting thread, waiting
+  /// for room in the pipeline first.
+  void submitFrame_(std::chrono::steady_clock::time_point start);
+
+  /// @brief Presents the frames handed to the pipeline, until stopped.
+  void presentFrames_();
+
+  /// @brief Culls an object and records it into a list if it's visible.
+  void drawObject_(Object *object, DrawList &list);
+
+  /// @brief Records the triangles in a list into commands_ and draws its
+  /// faces into the hidden line prepass.
+  void mergeList_(const DrawList &list);
+
+  /// @brief Keeps what a direct call recorded into directList_ for the next
+  /// frame drawn.
+  void keepDirect_();
+
+  /// @brief Transforms a vertex into clip space.
+  static V4F toClipSpace_(const M4F &mvp, const V3F &vertex);
+
+  /// @brief Performs the perspective divide on a point in clip space and maps
+  /// it onto the screen.
+  [[nodiscard]] V3F toScreen_(const V4F &clipSpace) const;
+
+  /// @brief Checks whether a polygon in screen coordinates is
+  /// counter-clockwise.
+  static bool isFrontFacing_(const V3F *polygon, size_t count);
+
+  /// @brief Builds the hierarchical depth buffer objects are tested against
+  /// in this frame, according to the occlusion culling mode.
+  void buildOcclusion_();
+
+  /// @brief Rasterizes the triangles of an occluder that are entirely
+  /// between the near and far planes into the hierarchical depth buffer.
+  void drawOccluder_(const TriangleMesh *mesh);
+
+  /// @brief Clips a face of a graph and appends it to a list of faces for
+  /// the hidden line prepass.
+  void clipHiddenLineFace_(const ClipVertex (&face)[3],
+                           ArenaVector<V3F> &faces) const;
+
+  /// @brief Checks whether an object can be skipped, because its bounding
+  /// box is either outside the view volume or hidden.
+  ///
+  /// @param object The object.
+  /// @param bounds The bounding box of its vertices, in its own space.
+  [[nodiscard]] bool isCulled_(const Object *object,
+                               const Bounds &bounds) const;
+
+  /// @brief Clears the screen, as a zone of the profiler.
+  void clear_();
+
+  /// @brief Presents the screen, as a zone of the profiler.
+  void present_();
+
   Screen &screen_;    ///< Reference to the Screen object used for rendering.
   Scene scene_;       ///< The current scene being displayed.
-  RenderFunc setup_;  ///< The setup animation function.
-  RenderFunc loop_;   ///< The loop animation function.
   float frameRate_;   ///< The desired frame rate for the animation.
-  float deltaTime_{}; ///< The time elapsed between the current and previous
-                      ///< animation frame.
+  JobSystem jobs_;    ///< The workers the scene is processed on.
+  /// @brief Where the data of the frame being recorded lives, with a
+  /// sub-arena for every thread of jobs_.
+  FrameArena arena_;
+  double deltaTime_{}; ///< The time elapsed between the current and previous
+                       ///< animation frame.
+  /// @brief When the current frame started, to time the next one from.
+  std::chrono::steady_clock::time_point frameStart_{};
+  bool hasFrameStart_{};         ///< Whether a frame has started yet.
+  FixedTimestep fixedTimestep_;  ///< The steps fixed updates run in.
+  BehaviorScheduler behaviors_;  ///< Runs the spawned behaviors.
+  FrameLimiter limiter_;         ///< Paces run() at frameRate_.
+  bool backfaceCulling_{true};   ///< Whether back-facing triangles are dropped.
+  /// @brief Where the depth objects are tested against comes from.
+  OcclusionCulling occlusionCulling_{OcclusionCulling::Disabled};
+  HiZBuffer hiZ_;   ///< The depth objects are tested against in this frame.
+  bool hasHiZ_{};   ///< Whether hiZ_ was built for this frame.
+  bool hiddenLineRemoval_{}; ///< Whether edges behind faces are removed.
+  /// @brief The depth prepass edges are tested against in this frame.
+  HiddenLineBuffer hiddenLines_;
+  std::vector<Object *> objects_; ///< The objects of the frame being drawn.
+  /// @brief What every object of objects_ recorded, in the same order.
+  std::vector<DrawList> drawLists_;
+  /// @brief What queueGraph and drawMesh record into when called directly.
+  DrawList directList_;
+  /// @brief What direct calls recorded since the last frame was drawn, kept
+  /// out of the arena since it's reset before the frame is recorded.
+  CommandBuffer directCommands_;
+  std::vector<V3F> directFaces_; ///< Their prepass faces, three per face.
+  CommandBuffer commands_; ///< What the frame being drawn is made of.
+  size_t frameAllocations_{};  ///< What rendering the last frame allocated.
+  size_t updateAllocations_{}; ///< What its update allocated.
+  /// @brief What allocationCount() returned as the frame being drawn began.
+  size_t frameAllocationStart_{};
+  /// @brief What allocationCount() returned as its rendering began.
+  size_t renderAllocationStart_{};
+  /// @brief The counters of every thread of jobs_, written only by the
+  /// thread they belong to while recording.
+  mutable std::vector<ThreadStats> threadStats_;
+  FrameStats frameStats_; ///< What recording the last frame counted.
+  mutable std::mutex statsMutex_; ///< Guards statsHistory_.
+  RenderStatsHistory statsHistory_;
+  /// @brief How many more frames are drawn before frameAllocations_ is
+  /// checked, for the storage kept between frames to settle first. Frames
+  /// are presented up to pipelineDepth_ - 1 frames later, so it takes the
+  /// pipeline to fill and one more frame.
+  size_t warmupFrames_{2};
+  size_t pipelineDepth_{1}; ///< How many frames can be in flight at once.
+  /// @brief The latency of the last presented frame, in seconds.
+  std::atomic<float> frameLatency_{};
+  /// @brief The frames waiting to be presented, as a ring of
+  /// pipelineDepth_ - 1 slots starting at firstPipelined_.
+  std::vector<PipelinedFrame> pipeline_;
+  size_t firstPipelined_{}, pipelined_{};
+  std::mutex pipelineMutex_; ///< Guards the pipeline and the fields below.
+  std::condition_variable pipelineChanged_;
+  bool stopPresenting_{};
+  std::exception_ptr presentError_; ///< What presenting a frame threw.
+  /// @brief The depth of the last presented frame that kept it.
+  HiZBuffer presentedHiZ_;
+  bool hasPresentedHiZ_{};
+  /// @brief Where the presenting thread builds the depth it keeps.
+  HiZBuffer presenterHiZ_;
+  std::thread presenter_; ///< The thread presenting pipelined frames.
 };
 
+/// @brief Stands in for the types of the setup and loop functions of a
+/// BasicEngine, to make it keep them in std::functions; see Engine.
+struct TypeErased {};
+
+/// @tparam Setup The type of the setup function, or TypeErased.
+/// @tparam Loop The type of the loop function, or TypeErased.
+/// @class BasicEngine
+/// @brief An engine that runs setup and loop functions of the given types.
+///
+/// The functions are kept by value and called directly, so the compiler can
+/// inline the loop function into the frame loop and optimize them together.
+/// They're called with a pointer to the engine, which any function taking an
+/// EngineCore pointer (or a generic lambda) accepts. The types are usually
+/// deduced from the constructor's arguments:
+///
+/// @code
+/// BasicEngine engine{screen, [](EngineCore *) {}, [](auto *engine) {
+///   engine->camera().transform().rotateInPlace(0, 0.01f, 0);
+/// }, scene};
+/// @endcode
+///
+/// Engine is the BasicEngine whose functions can be of any type.
+template <typename Setup, typename Loop>
+class BasicEngine : public EngineCore {
+public:
+  /// @brief Alias for a function pointer used in setup and loop animations.
+  ///
+  /// An RenderFunc represents a function pointer that takes a pointer to
+  /// the engine as an argument. It is what the setup and loop functions of
+  /// an Engine are kept in, and the type of fixed updates.
+  using RenderFunc = std::function<void(BasicEngine *)>;
+
+  /// @brief The types the setup and loop functions are kept as.
+  using SetupFunc =
+      std::conditional_t<std::is_same_v<Setup, TypeErased>, RenderFunc, Setup>;
+  using LoopFunc =
+      std::conditional_t<std::is_same_v<Loop, TypeErased>, RenderFunc, Loop>;
+
+  /// @brief Constructs an Engine object with the given parameters.
+  ///
+  /// @param screen The reference to the Screen object where the animation will
+  /// be displayed.
+  /// @param setup The function to be executed once at the beginning of the
+  /// animation.
+  /// @param loop The function to be executed repeatedly during the animation
+  /// loop.
+  /// @param scene The initial scene to be displayed.
+  /// @param frameRate The desired frame rate for the animation (default
+  /// is 60.0).
+  /// @param threads How many threads process the scene, the one drawing
+  /// included; 0 means one per hardware thread.
+  BasicEngine(Screen &screen, SetupFunc setup, LoopFunc loop, Scene scene,
+              float frameRate = 60.0F, size_t threads = 0)
+      : EngineCore{screen, std::move(scene), frameRate, threads},
+        setup_{std::move(setup)}, loop_{std::move(loop)} {}
+
+  /// @brief Starts the animation loop and continues indefinitely until the
+  /// program terminates.
+  ///
+  /// This function will continuously execute the setup animation function once
+  /// and the loop animation function at the specified frame rate until the
+  /// program is terminated or an exception is thrown. Frames are paced with a
+  /// FrameLimiter; a frame rate of 0 runs them as fast as possible.
+  ///
+  /// @note This function does not return.
+  [[noreturn]] void run();
+
+  /// @brief Renders a fixed number of frames and returns, without pumping any
+  /// window messages.
+  ///
+  /// The setup function runs before the first frame ever rendered. This is
+  /// meant for headless screens, tools and benchmarks; frames are rendered as
+  /// fast as possible.
+  ///
+  /// @param frames The number of frames to render. They've all been presented
+  /// by the time this returns.
+  void runFrames(size_t frames);
+
+  /// @brief Sets a function to be run at a fixed rate, independently of the
+  /// frame rate, for simulations that need a constant timestep.
+  ///
+  /// Before the loop function of every frame, the update runs as many times
+  /// as fit in the time since the previous frame (up to 8; the rest of a
+  /// long stall is dropped). The time left over is reported by
+  /// interpolationAlpha, so the loop function can place objects between the
+  /// states of the last two updates.
+  ///
+  /// @param update The function to run every step, or an empty function to
+  /// stop.
+  /// @param rate How many steps to take per second.
+  void setFixedUpdate(RenderFunc update, double rate = 60.0);
+
+private:
+  /// @brief Runs the setup function if it hasn't run yet.
+  void runSetup_();
+
+  /// @brief Runs the loop function, draws the scene and presents it.
+  void renderFrame_();
+
+  /// @brief Runs the setup function, then renders frames at the frame rate
+  /// for good.
+  [[noreturn]] void renderForever_();
+
+  SetupFunc setup_;         ///< The setup animation function.
+  LoopFunc loop_;           ///< The loop animation function.
+  RenderFunc fixedUpdate_;  ///< The function run at a fixed rate.
+  bool isSetUp_{};          ///< Whether the setup function has run.
+};
+
+template <typename Setup, typename Loop>
+BasicEngine(Screen &, Setup, Loop, Scene) -> BasicEngine<Setup, Loop>;
+
+template <typename Setup, typename Loop>
+BasicEngine(Screen &, Setup, Loop, Scene, float) -> BasicEngine<Setup, Loop>;
+
+template <typename Setup, typename Loop>
+BasicEngine(Screen &, Setup, Loop, Scene, float, size_t)
+    -> BasicEngine<Setup, Loop>;
+
+/// @class Engine
+/// @brief The engine whose setup and loop functions can be of any type, kept
+/// in std::functions taking an Engine pointer.
+using Engine = BasicEngine<TypeErased, TypeErased>;
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::run() {
+#if defined(_WIN32)
+  std::thread renderThread{[this] { renderForever_(); }};
+  pumpWindowMessages_();
+  renderThread.join();
+#else
+  // there are no window messages to pump without a window
+  renderForever_();
+#endif
+}
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::runFrames(size_t frames) {
+  runSetup_();
+  for (size_t i{}; i < frames; ++i)
+    renderFrame_();
+  flush_();
+}
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::setFixedUpdate(RenderFunc update,
+                                              double rate) {
+  fixedUpdate_ = std::move(update);
+  setFixedRate_(rate);
+}
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::runSetup_() {
+  if (isSetUp_)
+    return;
+  isSetUp_ = true;
+  setup_(this);
+}
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::renderForever_() {
+  runSetup_();
+  while (true) {
+    waitForFrame_();
+    renderFrame_();
+  }
+}
+
+template <typename Setup, typename Loop>
+void BasicEngine<Setup, Loop>::renderFrame_() {
+  VBAG_PROFILE_FRAME();
+  const auto elapsed{beginFrame_()};
+  if (fixedUpdate_) {
+    VBAG_PROFILE_ZONE("fixedUpdate");
+    for (auto steps{fixedSteps_(elapsed)}; steps > 0; --steps)
+      fixedUpdate_(this);
+  }
+  updateBehaviors_(elapsed);
+  {
+    VBAG_PROFILE_ZONE("loop");
+    loop_(this);
+  }
+  endFrame_();
+}
+
 } // namespace vbag
 
 #endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_ANIMATION_ENGINE_HPP
@@ -0,0 +1,230 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_BEHAVIOR_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_BEHAVIOR_HPP
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace vbag {
+
+class BehaviorScheduler;
+
+/// @class Behavior
+/// @brief A coroutine giving an object a behavior that spans many frames.
+///
+/// A behavior is written as a function returning Behavior, which suspends
+/// itself with co_await nextFrame(), co_await seconds(t) or
+/// co_await until(condition) and carries on from there when the time comes.
+/// Nothing runs until it's handed to EngineCore::spawn:
+///
+/// @code
+/// Behavior blink(Object &lamp) {
+///   while (true) {
+///     lamp.transform().scale(2);
+///     co_await seconds(0.5);
+///     lamp.transform().scale(0.5f);
+///     co_await seconds(0.5);
+///   }
+/// }
+///
+/// engine.spawn(blink(lamp));
+/// @endcode
+///
+/// A behavior keeps its parameters, but a lambda's captures go with the
+/// lambda, which is usually gone by the time the behavior resumes; lambdas
+/// should take what they use as parameters instead.
+///
+/// Coroutine frames come out of a pool kept per thread, so spawning
+/// behaviors stops allocating once as many have finished as get spawned.
+class Behavior {
+public:
+  struct promise_type {
+    Behavior get_return_object();
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept;
+
+    static void *operator new(size_t size);
+    static void operator delete(void *frame, size_t size) noexcept;
+
+    BehaviorScheduler *scheduler{}; ///< The scheduler running it.
+    std::exception_ptr exception;   ///< What the behavior threw, if anything.
+    /// @brief The neighbours in the list of behaviors of the scheduler.
+    promise_type *previous{}, *next{};
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Behavior(Behavior &&other) noexcept;
+  Behavior &operator=(Behavior &&other) noexcept;
+
+  /// @brief Destroys the coroutine, unless it's been spawned.
+  ~Behavior();
+
+private:
+  friend class BehaviorScheduler;
+
+  explicit Behavior(Handle handle);
+
+  Handle handle_;
+};
+
+/// @class BehaviorScheduler
+/// @brief Runs behaviors, resuming each only in the frames it's due.
+///
+/// Sleeping behaviors are kept in a timer wheel of wheelSize slots, each
+/// tickLength long: a frame only looks at the slots of the ticks it went
+/// through, so behaviors sleeping for a while cost nothing until they're due
+/// (or once per turn of the wheel, if they sleep longer than a turn). Those
+/// waiting for the next frame are queued, and only those waiting on a
+/// condition have it checked every frame.
+///
+/// Time is the sum of the time given to update, so behaviors sleep in game
+/// time: they never resume early, and at most a tick late.
+class BehaviorScheduler {
+public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  /// @brief How many slots the timer wheel has.
+  static constexpr size_t wheelSize{1024};
+  /// @brief The time each slot of the timer wheel covers.
+  static constexpr Duration tickLength{std::chrono::milliseconds{1}};
+
+  BehaviorScheduler() = default;
+  BehaviorScheduler(const BehaviorScheduler &) = delete;
+  BehaviorScheduler &operator=(const BehaviorScheduler &) = delete;
+
+  /// @brief Destroys the behaviors still running.
+  ~BehaviorScheduler();
+
+  /// @brief Starts a behavior, running it up to its first co_await.
+  ///
+  /// @param behavior The behavior to run.
+  /// @throw What the behavior threw, if it threw before suspending.
+  void spawn(Behavior behavior);
+
+  /// @brief Moves time forward and resumes the behaviors that are due.
+  ///
+  /// Behaviors awaiting the next frame resume, then those whose sleep ended,
+  /// then those whose condition holds. What they await while resuming is
+  /// only looked at in the next update.
+  ///
+  /// @param elapsed The time since the last update.
+  /// @throw What a behavior threw. The behavior is gone, and those that
+  /// didn't get to resume do so in the next update.
+  void update(Duration elapsed);
+
+  /// @brief Returns how many behaviors are running.
+  [[nodiscard]] size_t size() const;
+
+  /// @brief Returns the time given to update so far.
+  [[nodiscard]] Duration time() const;
+
+  /// @brief Resumes a behavior in the next update; see nextFrame().
+  void resumeNextFrame(Behavior::Handle behavior);
+
+  /// @brief Resumes a behavior once some time has passed; see seconds().
+  void resumeAfter(Duration delay, Behavior::Handle behavior);
+
+  /// @brief Resumes a behavior in the first update where a condition holds;
+  /// see until().
+  ///
+  /// @param holds Checks the condition.
+  /// @param condition What holds is called with. It must outlive the wait.
+  void resumeWhen(bool (*holds)(void *), void *condition,
+                  Behavior::Handle behavior);
+
+private:
+  struct Timer {
+    Behavior::Handle behavior;
+    uint64_t dueTick; ///< The first tick it may resume at.
+  };
+
+  struct Waiter {
+    Behavior::Handle behavior;
+    bool (*holds)(void *);
+    void *condition;
+  };
+
+  /// @brief Resumes a behavior, and destroys it if it finished.
+  ///
+  /// @throw What the behavior threw.
+  void resume_(Behavior::Handle behavior);
+
+  /// @brief Collects the timers of the ticks since the last update into
+  /// due_.
+  void collectTimers_();
+
+  std::array<std::vector<Timer>, wheelSize> wheel_;
+  std::vector<Waiter> waiters_;
+  std::vector<Behavior::Handle> nextFrame_;
+  std::vector<Behavior::Handle> due_; ///< Resumed by the current update.
+  Duration time_{};
+  uint64_t tick_{}; ///< The last tick whose timers have been collected.
+  Behavior::promise_type *first_{}; ///< The list of running behaviors.
+  size_t size_{};
+};
+
+/// @brief What co_await nextFrame() suspends with.
+struct NextFrame {
+  [[nodiscard]] bool await_ready() const noexcept { return false; }
+  void await_suspend(Behavior::Handle behavior) const;
+  void await_resume() const noexcept {}
+};
+
+/// @brief What co_await seconds(t) suspends with.
+struct Sleep {
+  BehaviorScheduler::Duration duration;
+
+  [[nodiscard]] bool await_ready() const noexcept { return false; }
+  void await_suspend(Behavior::Handle behavior) const;
+  void await_resume() const noexcept {}
+};
+
+/// @tparam Condition A function taking nothing and returning bool.
+/// @brief What co_await until(condition) suspends with.
+template <typename Condition> struct Until {
+  Condition condition;
+
+  [[nodiscard]] bool await_ready() { return condition(); }
+  void await_suspend(Behavior::Handle behavior) {
+    behavior.promise().scheduler->resumeWhen(
+        [](void *condition) {
+          return bool((*static_cast<Condition *>(condition))());
+        },
+        &condition, behavior);
+  }
+  void await_resume() const noexcept {}
+};
+
+/// @brief Suspends a behavior until the next frame.
+[[nodiscard]] NextFrame nextFrame();
+
+/// @brief Suspends a behavior for some time.
+///
+/// It always resumes in a later frame, even after 0 seconds.
+///
+/// @param seconds How long to sleep.
+[[nodiscard]] Sleep seconds(double seconds);
+
+/// @brief Suspends a behavior until a condition holds, checked once per
+/// frame. If it already holds, the behavior carries on without suspending.
+///
+/// Every behavior waiting on a condition costs a call to it every frame;
+/// sleeping costs less, when the time something will happen is known.
+///
+/// @param condition The condition, which is kept until it holds.
+template <typename Condition>
+[[nodiscard]] Until<Condition> until(Condition condition) {
+  return {std::move(condition)};
+}
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_BEHAVIOR_HPP
@@ -0,0 +1,87 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_FRAME_PACING_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_FRAME_PACING_HPP
+
+#include <chrono>
+#include <cstddef>
+
+namespace vbag {
+
+/// @brief Blocks the calling thread until a point in time, more precisely
+/// than sleeping alone would.
+///
+/// The thread sleeps a millisecond at a time for as long as the time left is
+/// longer than a sleep has been seen to take, and spins through the rest. How
+/// long sleeps take is measured as it goes, per thread, so the spinning
+/// adapts to coarse system timers.
+///
+/// @param deadline When to return.
+void preciseSleepUntil(std::chrono::steady_clock::time_point deadline);
+
+/// @class FixedTimestep
+/// @brief Turns the variable time between frames into a whole number of
+/// fixed-length simulation steps.
+///
+/// Elapsed time is accumulated in clock ticks, so no time is lost to
+/// rounding however short the frames are. The time left over after the steps
+/// is what alpha() reports, for drawing states interpolated between the last
+/// two steps.
+class FixedTimestep {
+public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  /// @brief Constructs a timestep.
+  ///
+  /// @param rate How many steps to take per second.
+  /// @param maxSteps The most steps taken for a single frame. Time beyond
+  /// that is dropped, so a slow frame doesn't make the next ones slower
+  /// trying to catch up.
+  explicit FixedTimestep(double rate = 60.0, size_t maxSteps = 8);
+
+  /// @brief Accumulates the time a frame took.
+  ///
+  /// @param elapsed The time since the previous frame.
+  /// @return How many steps to take for this frame.
+  size_t advance(Duration elapsed);
+
+  /// @brief Returns the length of a step, in seconds.
+  [[nodiscard]] double step() const;
+
+  /// @brief Returns how far into the next step the accumulated time is, in
+  /// [0, 1).
+  [[nodiscard]] double alpha() const;
+
+private:
+  Duration step_;
+  Duration accumulated_{};
+  size_t maxSteps_;
+};
+
+/// @class FrameLimiter
+/// @brief Paces a loop at a fixed frame rate.
+///
+/// Every frame is due a period after the previous one was, rather than after
+/// it ended, so the rate holds on average whatever the frames take. A loop
+/// that falls more than a frame behind starts over from the current time
+/// instead of rushing through the frames it missed.
+class FrameLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// @brief Constructs a limiter.
+  ///
+  /// @param frameRate The target frames per second; 0 or less doesn't limit
+  /// anything.
+  explicit FrameLimiter(double frameRate);
+
+  /// @brief Waits until the next frame is due, with preciseSleepUntil.
+  void wait();
+
+private:
+  Clock::duration period_;
+  Clock::time_point next_{};
+  bool started_{};
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_FRAME_PACING_HPP
@@ -0,0 +1,85 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_RENDER_STATS_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_RENDER_STATS_HPP
+
+#include <array>
+#include <cstddef>
+
+namespace vbag {
+
+/// @brief How many objects of a type the engine went through for a frame.
+struct ObjectStats {
+  size_t visited{}; ///< Found in the scene.
+  size_t culled{};  ///< Skipped for being out of view or hidden.
+  size_t drawn{};   ///< Recorded into the frame.
+
+  ObjectStats &operator+=(const ObjectStats &other);
+  ObjectStats &operator-=(const ObjectStats &other);
+};
+
+/// @brief Counts what the engine did to render a frame.
+struct FrameStats {
+  ObjectStats graphs, triangleMeshes, quadMeshes;
+  /// @brief Objects that aren't drawn at all, like cameras and lights.
+  size_t otherObjects{};
+  /// @brief Vertices taken into clip space, occluders included.
+  size_t verticesTransformed{};
+  /// @brief Edges dropped for lying outside the view volume.
+  size_t linesClipped{};
+  /// @brief Triangles dropped for lying outside the view volume.
+  size_t trianglesClipped{};
+  /// @brief Triangles dropped by back-face culling.
+  size_t trianglesBackFacing{};
+  /// @brief What was handed to the screen, after merging and hidden line
+  /// removal. Clipped triangles and lines can be split in several.
+  size_t linesSubmitted{}, trianglesSubmitted{}, pointsSubmitted{};
+  /// @brief Calls made to the screen: draw calls, clear and present.
+  size_t backendCalls{};
+  /// @brief The size of the vertices, colors, lines and points handed to the
+  /// screen.
+  size_t bytesUploaded{};
+  /// @brief Heap allocations made rendering the frame; see
+  /// Engine::frameAllocations.
+  size_t allocations{};
+  /// @brief Heap allocations made by the update of the frame; see
+  /// Engine::updateAllocations.
+  size_t updateAllocations{};
+
+  FrameStats &operator+=(const FrameStats &other);
+  FrameStats &operator-=(const FrameStats &other);
+};
+
+/// @brief Frame statistics, for the last frame and summed over many.
+///
+/// Dividing a sum by its number of frames gives the average per frame.
+struct RenderStats {
+  /// @brief How many of the latest frames recent sums up.
+  static constexpr size_t windowSize{60};
+
+  FrameStats lastFrame; ///< The last frame presented.
+  FrameStats recent;    ///< Summed over the last recentFrames frames.
+  size_t recentFrames{};
+  FrameStats total;     ///< Summed over every frame presented.
+  size_t frames{};
+};
+
+/// @class RenderStatsHistory
+/// @brief Keeps the statistics of the frames presented so far, the rolling
+/// sums included, without allocating.
+class RenderStatsHistory {
+public:
+  /// @brief Adds a frame that has been presented.
+  void add(const FrameStats &frame);
+
+  /// @brief Returns the statistics of the frames added so far.
+  [[nodiscard]] const RenderStats &stats() const;
+
+private:
+  RenderStats stats_;
+  /// @brief The frames summed in stats_.recent, as a ring.
+  std::array<FrameStats, RenderStats::windowSize> window_{};
+  size_t next_{}; ///< Where the next frame goes in window_.
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_ANIMATION_RENDER_STATS_HPP
@@ -0,0 +1,53 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GEOMETRY_BOUNDS_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GEOMETRY_BOUNDS_HPP
+
+#include <span>
+
+#include "math/vector.hpp"
+
+namespace vbag {
+
+/// @struct Bounds
+/// @brief An axis-aligned bounding box.
+struct Bounds {
+  V3F min, max;
+};
+
+/// @brief Computes the bounding box of a set of points.
+///
+/// @param points The points; if there are none, min ends up above max.
+[[nodiscard]] Bounds boundsOf(std::span<const V3F> points);
+
+/// @class CachedBounds
+/// @brief The bounding box of the vertices of a mesh or graph, computed when
+/// it's first asked for and kept until they change.
+///
+/// Whatever holds the vertices invalidates the box whenever they may have
+/// changed. Asking for it is const but may write the cache, so a box that
+/// may be stale mustn't be asked for by several threads at once.
+class CachedBounds {
+public:
+  /// @brief Returns the bounding box of the points, computing it first if
+  /// it was invalidated since.
+  ///
+  /// @param points The points, the same ones every call until the next
+  /// invalidate.
+  [[nodiscard]] const Bounds &of(std::span<const V3F> points) const {
+    if (!valid_) {
+      bounds_ = boundsOf(points);
+      valid_ = true;
+    }
+    return bounds_;
+  }
+
+  /// @brief Marks the points as changed.
+  void invalidate() { valid_ = false; }
+
+private:
+  mutable Bounds bounds_{};
+  mutable bool valid_{};
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GEOMETRY_BOUNDS_HPP
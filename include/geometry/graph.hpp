@@ -6,6 +6,7 @@
 #include <list>
 #include <vector>
 
+#include "geometry/bounds.hpp"
 #include "geometry/object.hpp"
 #include "graphics/color.hpp"
 
@@ -20,6 +21,11 @@ namespace vbag {
 /// utility functions for working with graphs.
 template <typename T> class Graph : public Object {
 public:
+  /// @brief A triangle made of three vertices of the graph.
+  struct Face {
+    size_t v1, v2, v3;
+  };
+
   /// @brief Constructs a Graph object with the given name.
   ///
   /// @param name The name of the graph.
@@ -33,6 +39,7 @@ public:
   auto addVertex(const T &value) {
     vertices_.emplace_back(value);
     adjacencyLists_.emplace_back();
+    bounds_.invalidate();
   }
 
   /// @brief Adds a vertex to the graph using individual x, y, and z
@@ -58,6 +65,20 @@ public:
     adjacencyLists_[vertex2].push_back(vertex1);
   }
 
+  /// @brief Adds a triangular face to the graph.
+  ///
+  /// Faces aren't drawn; they only hide the edges behind them when the
+  /// engine removes hidden lines (see Engine::setHiddenLineRemoval).
+  ///
+  /// @param vertex1 The index of the first vertex.
+  /// @param vertex2 The index of the second vertex.
+  /// @param vertex3 The index of the third vertex.
+  auto addFace(size_t vertex1, size_t vertex2, size_t vertex3) {
+    assert(vertex1 < vertices_.size() && vertex2 < vertices_.size() &&
+           vertex3 < vertices_.size());
+    faces_.push_back({vertex1, vertex2, vertex3});
+  }
+
   /// @brief Returns a constant reference to the vertices of the graph.
   ///
   /// @return A constant reference to the vector of vertices.
@@ -67,8 +88,22 @@ public:
 
   /// @brief Returns a reference to the vertices of the graph.
   ///
+  /// Changing them through a reference kept from an earlier call leaves
+  /// bounds stale.
+  ///
   /// @return A reference to the vector of vertices.
-  auto &vertices() { return vertices_; }
+  auto &vertices() {
+    bounds_.invalidate();
+    return vertices_;
+  }
+
+  /// @brief Returns the bounding box of the vertices, in the space of the
+  /// graph, computed once after they change rather than every frame.
+  ///
+  /// This is only available for T = V3F.
+  ///
+  /// @return The bounding box.
+  [[nodiscard]] const Bounds &bounds() const { return bounds_.of(vertices_); }
 
   /// @brief Returns a constant reference to the edges of a specific vertex in
   /// the graph.
@@ -86,6 +121,16 @@ public:
   /// @return A reference to the list of edges for the specified vertex.
   auto &edges(size_t vertex) { return adjacencyLists_[vertex]; }
 
+  /// @brief Returns a constant reference to the faces of the graph.
+  ///
+  /// @return A constant reference to the vector of faces.
+  [[nodiscard]] const auto &faces() const { return faces_; }
+
+  /// @brief Returns a reference to the faces of the graph.
+  ///
+  /// @return A reference to the vector of faces.
+  auto &faces() { return faces_; }
+
   /// @brief Returns the order of the graph (the number of vertices).
   ///
   /// @return The number of vertices in the graph.
@@ -121,6 +166,18 @@ public:
     graph.addEdge(e, h);
     graph.addEdge(f, g);
     graph.addEdge(g, h);
+    graph.addFace(a, b, c);
+    graph.addFace(a, c, d);
+    graph.addFace(e, f, g);
+    graph.addFace(e, g, h);
+    graph.addFace(c, h, e);
+    graph.addFace(c, e, d);
+    graph.addFace(a, f, g);
+    graph.addFace(a, g, b);
+    graph.addFace(a, d, e);
+    graph.addFace(a, e, f);
+    graph.addFace(b, g, h);
+    graph.addFace(b, h, c);
     return graph;
   }
 
@@ -136,6 +193,8 @@ public:
     graph.addEdge(a, c);
     graph.addEdge(b, d);
     graph.addEdge(c, d);
+    graph.addFace(a, b, d);
+    graph.addFace(a, d, c);
     return graph;
   }
 
@@ -144,8 +203,10 @@ public:
 private:
   std::vector<T> vertices_; ///< The vertices of the graph.
   std::vector<std::list<size_t>>
-      adjacencyLists_; ///< The adjacency lists for each vertex.
+      adjacencyLists_;       ///< The adjacency lists for each vertex.
+  std::vector<Face> faces_; ///< The faces that hide edges behind them.
   RgbColor color_;
+  CachedBounds bounds_; ///< The bounding box of the vertices.
 };
 
 using GV3F = Graph<V3F>;
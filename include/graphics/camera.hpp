@@ -15,19 +15,24 @@ namespace vbag {
 /// transformation from world space to camera space.
 class Camera : public Object {
 public:
-  /// @brief Constructs a Camera object with the given name, field of view, and
-  /// aspect ratio.
+  /// @brief Constructs a Camera object with the given name, field of view,
+  /// aspect ratio and clipping planes.
   ///
   /// @param name The name of the camera.
   /// @param fovDeg The field of view angle in degrees.
   /// @param pixelAspectRatio_ The aspect ratio of the camera's view
   /// (width/height).
-  Camera(const std::string &name, float fovDeg, float pixelAspectRatio_);
+  /// @param nearPlane The distance to the near clipping plane.
+  /// @param farPlane The distance to the far clipping plane.
+  Camera(const std::string &name, float fovDeg, float pixelAspectRatio_,
+         float nearPlane = 0.1f, float farPlane = 1000.0f);
 
   /// @brief Returns the perspective projection matrix of the camera.
   ///
   /// The perspective projection matrix is used to convert 3D points from camera
-  /// space to clip space during rendering.
+  /// space to clip space during rendering. Points between the near and far
+  /// planes end up with 0 <= z <= w, which is what primitives are clipped
+  /// against.
   ///
   /// @return A constant reference to the perspective projection matrix.
   [[nodiscard]] const M4F &perspective() const;
@@ -40,6 +45,16 @@ public:
   /// @return A constant reference to the world-to-camera transformation matrix.
   [[nodiscard]] const M4F &worldToCamera() const;
 
+  /// @brief Returns the distance to the near clipping plane.
+  ///
+  /// @return The distance to the near clipping plane.
+  [[nodiscard]] float nearPlane() const;
+
+  /// @brief Returns the distance to the far clipping plane.
+  ///
+  /// @return The distance to the far clipping plane.
+  [[nodiscard]] float farPlane() const;
+
 private:
   friend Transform;
 
@@ -49,6 +64,9 @@ private:
 
   float fovDeg_;      ///< The field of view angle in degrees.
   float aspectRatio_; ///< The aspect ratio of the camera's view (width/height).
+  float nearPlane_;   ///< The distance to the near clipping plane.
+  float farPlane_;    ///< The distance to the far clipping plane.
+  M4F perspective_;   ///< The perspective projection matrix.
   M4F wtc_;           ///< The world-to-camera transformation matrix.
 };
 
@@ -0,0 +1,73 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_CLIPPING_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_CLIPPING_HPP
+
+#include <cstdint>
+
+#include "graphics/color.hpp"
+#include "math/vector.hpp"
+
+namespace vbag {
+
+/// @struct ClipVertex
+/// @brief A vertex in homogeneous clip space, before the perspective divide,
+/// along with its color.
+struct ClipVertex {
+  V4F position;   ///< The position in clip space.
+  D3DCOLOR color; ///< The color of the vertex.
+};
+
+/// @brief How far the guard band reaches, in multiples of w.
+///
+/// The visible range is -w <= x, y <= w. Primitives that poke out of it but
+/// stay inside the guard band are left for the rasterizer to scissor, so only
+/// the ones that reach really far out (or cross the near and far planes) are
+/// actually clipped.
+inline constexpr float guardBand{2.0f};
+
+/// @brief The most vertices a triangle can have after being clipped.
+inline constexpr size_t maxClippedVertices{9};
+
+/// @brief Computes which planes of the view volume a point is outside of.
+///
+/// The view volume is bounded by 0 <= z <= w (near and far) and by
+/// -w <= x, y <= w. If the outcodes of all vertices of a primitive share a
+/// bit, the primitive can't be visible.
+///
+/// @param position The point in clip space.
+/// @return A bitmask with one bit per plane the point is outside of.
+[[nodiscard]] uint8_t viewOutcode(const V4F &position);
+
+/// @brief Computes which clipping planes a point is outside of: the near and
+/// far planes and the sides of the guard band.
+///
+/// If the outcodes of all vertices of a primitive are 0, it can be drawn
+/// without clipping.
+///
+/// @param position The point in clip space.
+/// @return A bitmask with one bit per plane the point is outside of.
+[[nodiscard]] uint8_t clipOutcode(const V4F &position);
+
+/// @brief Clips a line segment against the near and far planes and the guard
+/// band.
+///
+/// @param a The first endpoint, updated in place.
+/// @param b The second endpoint, updated in place.
+/// @return False if nothing of the segment is left, true otherwise.
+bool clipLine(ClipVertex &a, ClipVertex &b);
+
+/// @brief Clips a triangle against the near and far planes and the guard
+/// band.
+///
+/// The result is a convex polygon with the same winding as the triangle,
+/// which can be drawn as a fan around its first vertex.
+///
+/// @param triangle The vertices of the triangle.
+/// @param out Where the vertices of the polygon are written. Must have room
+/// for maxClippedVertices vertices.
+/// @return The number of vertices of the polygon; less than 3 means nothing
+/// is left.
+size_t clipTriangle(const ClipVertex (&triangle)[3], ClipVertex *out);
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_CLIPPING_HPP
@@ -2,7 +2,21 @@
 #define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_COLOR_HPP
 
 #include <cmath>
+
+#if defined(_WIN32)
 #include <d3d9.h>
+#else
+#include <cstdint>
+
+// the same packed 0xAARRGGBB colors Direct3D uses, so everything that isn't a
+// D3d9Screen builds without the Windows headers
+using D3DCOLOR = uint32_t;
+
+#define D3DCOLOR_ARGB(a, r, g, b)                                              \
+  ((D3DCOLOR)((((a) & 0xff) << 24) | (((r) & 0xff) << 16) |                    \
+              (((g) & 0xff) << 8) | ((b) & 0xff)))
+#define D3DCOLOR_XRGB(r, g, b) D3DCOLOR_ARGB(0xff, r, g, b)
+#endif
 
 namespace vbag {
 
@@ -0,0 +1,83 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_HIDDEN_LINES_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_HIDDEN_LINES_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "geometry/graph.hpp"
+#include "graphics/triangle_mesh.hpp"
+#include "output/screen.hpp"
+#include "util/frame_arena.hpp"
+#include "util/job_system.hpp"
+
+namespace vbag {
+
+/// @class HiddenLineBuffer
+/// @brief Splits lines into the pieces that aren't hidden behind a set of
+/// faces, for drawing wireframes without the edges at their back.
+///
+/// Faces are rasterized into a depth buffer of the size of the screen, with
+/// nothing but depth written. Lines are then walked a pixel at a time and
+/// cut wherever they go from in front of the faces to behind them or back.
+///
+/// Edges lie right on the faces they bound, so a point of a line counts as
+/// visible unless it's behind the farthest depth around its pixel by more
+/// than a small tolerance, which grows with the distance like the spacing
+/// between depth values does.
+class HiddenLineBuffer {
+public:
+  /// @brief Sizes the buffer for a screen and clears it to the far plane.
+  ///
+  /// @param width The width of the screen, in pixels.
+  /// @param height The height of the screen, in pixels.
+  void reset(size_t width, size_t height);
+
+  /// @brief Draws a face into the depth buffer.
+  ///
+  /// @param triangle The vertices, in screen coordinates with z in [0, 1],
+  /// in either winding.
+  void drawFace(const V3F (&triangle)[3]);
+
+  /// @brief Appends the visible pieces of some lines to a list, in order.
+  ///
+  /// Pieces that are off the screen are dropped too. Long lists are split
+  /// into jobs, each splitting its lines into a list of its own drawn from
+  /// the arena.
+  ///
+  /// @param lines The lines, in screen coordinates.
+  /// @param visible The list the pieces are appended to.
+  /// @param jobs The job system long lists are split on.
+  /// @param arena The arena the lists of the jobs are drawn from, with a
+  /// sub-arena for every thread of the job system.
+  void appendVisible(std::span<const Line> lines, ArenaVector<Line> &visible,
+                     JobSystem &jobs, FrameArena &arena) const;
+
+private:
+  /// @brief Appends the visible pieces of a line to a list.
+  void appendVisible_(const Line &line, ArenaVector<Line> &visible) const;
+
+  /// @brief Checks whether a point in screen coordinates is in front of the
+  /// faces around it.
+  [[nodiscard]] bool isVisible_(float x, float y, float z) const;
+
+  size_t width_{}, height_{};
+  std::vector<float> depth_;
+};
+
+/// @brief Makes a graph out of the edges of a mesh, with its triangles as
+/// faces, so it can be drawn as a wireframe with hidden lines removed.
+///
+/// Edges shared by several triangles only show up once.
+///
+/// @param name The name of the graph.
+/// @param mesh The mesh.
+/// @param color The color of the edges.
+/// @return The wireframe of the mesh, without its transform.
+[[nodiscard]] GV3F toWireframe(const std::string &name,
+                               const TriangleMesh &mesh,
+                               const RgbColor &color = RgbColor::white());
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_HIDDEN_LINES_HPP
@@ -0,0 +1,69 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_IO_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_IO_HPP
+
+#include <string>
+
+#include "graphics/quad_mesh.hpp"
+#include "graphics/triangle_mesh.hpp"
+
+namespace vbag {
+
+/// @brief Loads a Wavefront OBJ or binary PLY file into a triangle mesh,
+/// replacing whatever geometry it had before.
+///
+/// The file is memory-mapped and parsed in parallel chunks: a first pass counts
+/// vertices and faces so the mesh's arrays are sized exactly once, and a
+/// second pass fills them in place. The format is picked by the file's
+/// extension. Quads and larger polygons are split into triangle fans.
+///
+/// Normals are only loaded when the file has exactly one per vertex and
+/// every face corner uses the normal with the index of its position, since
+/// meshes store normals per vertex rather than per face corner.
+///
+/// @param path The path of the .obj or .ply file.
+/// @param mesh The mesh to be filled.
+/// @throw CouldNotOpenFile if the file can't be opened.
+/// @throw UnsupportedMeshFormat if the file is not an OBJ or a binary PLY.
+/// @throw MalformedMeshFile if the file can't be parsed or references
+/// vertices that don't exist.
+void loadMesh(const std::string &path, TriangleMesh &mesh);
+
+/// @brief Loads a Wavefront OBJ or binary PLY file into a quad mesh, replacing
+/// whatever geometry it had before.
+///
+/// Works just like the TriangleMesh overload, except quads are kept as they
+/// are, while triangles (and the fans that polygons with more than four sides
+/// are split into) become degenerate quads whose last vertex repeats the first.
+///
+/// @param path The path of the .obj or .ply file.
+/// @param mesh The mesh to be filled.
+/// @throw CouldNotOpenFile if the file can't be opened.
+/// @throw UnsupportedMeshFormat if the file is not an OBJ or a binary PLY.
+/// @throw MalformedMeshFile if the file can't be parsed or references
+/// vertices that don't exist.
+void loadMesh(const std::string &path, QuadMesh &mesh);
+
+/// @brief Saves a triangle mesh as a Wavefront OBJ file.
+///
+/// Normals are written along with the vertices when there is one per vertex.
+///
+/// @param path The path of the .obj file.
+/// @param mesh The mesh to be saved.
+/// @throw UnsupportedMeshFormat if the path doesn't end in .obj.
+/// @throw CouldNotOpenFile if the file can't be written.
+void saveMesh(const std::string &path, const TriangleMesh &mesh);
+
+/// @brief Saves a quad mesh as a Wavefront OBJ file.
+///
+/// Degenerate quads whose last vertex repeats the first are written as
+/// triangles.
+///
+/// @param path The path of the .obj file.
+/// @param mesh The mesh to be saved.
+/// @throw UnsupportedMeshFormat if the path doesn't end in .obj.
+/// @throw CouldNotOpenFile if the file can't be written.
+void saveMesh(const std::string &path, const QuadMesh &mesh);
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_IO_HPP
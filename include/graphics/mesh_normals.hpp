@@ -0,0 +1,61 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_NORMALS_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_NORMALS_HPP
+
+#include "graphics/quad_mesh.hpp"
+#include "graphics/triangle_mesh.hpp"
+#include "util/job_system.hpp"
+
+namespace vbag {
+
+/// @enum NormalWeighting
+/// @brief How much each face contributes to the normals of its vertices.
+enum class NormalWeighting {
+  Area,  ///< Proportional to the area of the face. Cheapest.
+  Angle, ///< Proportional to the angle of the face at the vertex, which
+         ///< doesn't depend on how the surface around it is tessellated.
+};
+
+/// @brief Computes the face normals and smooth vertex normals of a mesh,
+/// replacing whatever normals it had before.
+///
+/// Every vertex normal is the weighted sum of the normals of the faces around
+/// it. When a crease angle below 180 degrees is given, faces only smooth
+/// with neighbours whose normals are within that angle of their own, and
+/// vertices shared by faces that end up with different normals are split, so
+/// the mesh may gain vertices and its faces may be re-indexed.
+///
+/// Faces and vertices are processed in parallel chunks, as jobs of a job
+/// system that's already running, so no threads are started. Each vertex
+/// sums its faces in the order they appear in the mesh, so the result is the
+/// same no matter how many threads run; this makes it cheap enough to
+/// recompute the normals of deforming meshes every frame (without creases,
+/// since split vertices stay split), on the jobs of the engine.
+///
+/// @param mesh The mesh whose normals should be computed.
+/// @param jobs The job system the chunks run on.
+/// @param weighting How faces are weighted.
+/// @param creaseAngle The largest angle, in degrees, between two faces that
+/// still get smoothed together.
+void computeNormals(TriangleMesh &mesh, JobSystem &jobs,
+                    NormalWeighting weighting = NormalWeighting::Angle,
+                    float creaseAngle = 180.0f);
+
+/// @brief Computes the face normals and smooth vertex normals of a quad mesh,
+/// just like the TriangleMesh overload does.
+///
+/// The normal of a quad is the cross product of its diagonals, which for
+/// non-planar quads is the average of the two triangles it would be split
+/// into. Degenerate quads are handled as the triangles they are.
+///
+/// @param mesh The mesh whose normals should be computed.
+/// @param jobs The job system the chunks run on.
+/// @param weighting How faces are weighted.
+/// @param creaseAngle The largest angle, in degrees, between two faces that
+/// still get smoothed together.
+void computeNormals(QuadMesh &mesh, JobSystem &jobs,
+                    NormalWeighting weighting = NormalWeighting::Angle,
+                    float creaseAngle = 180.0f);
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_NORMALS_HPP
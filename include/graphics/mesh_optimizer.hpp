@@ -0,0 +1,87 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_OPTIMIZER_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_OPTIMIZER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "graphics/triangle_mesh.hpp"
+#include "math/vector.hpp"
+
+namespace vbag {
+
+/// @struct Meshlet
+/// @brief A small cluster of triangles that can be culled and processed on
+/// its own.
+///
+/// A meshlet references a range of the vertex and triangle arrays of the
+/// MeshletSet it belongs to. Its triangles index into its own vertex range
+/// (local indices), which is why both counts fit in a byte.
+struct Meshlet {
+  uint32_t vertexOffset;   ///< First entry in MeshletSet::vertices.
+  uint32_t triangleOffset; ///< First entry in MeshletSet::triangles.
+  uint8_t vertexCount;     ///< Number of unique vertices in the meshlet.
+  uint8_t triangleCount;   ///< Number of triangles in the meshlet.
+  V3F center;              ///< Center of the bounding sphere.
+  float radius;            ///< Radius of the bounding sphere.
+  V3F coneAxis;            ///< Average facing direction of the triangles.
+  float coneCutoff; ///< Sine of the cone spread; > 1 if it can't be culled.
+};
+
+/// @struct MeshletSet
+/// @brief The result of splitting a TriangleMesh into meshlets.
+struct MeshletSet {
+  std::vector<Meshlet> meshlets; ///< The meshlets themselves.
+  std::vector<uint32_t> vertices; ///< Mesh vertex indices, per meshlet.
+  std::vector<uint8_t> triangles; ///< Local vertex indices, 3 per triangle.
+};
+
+/// @brief Reorders the triangles of a mesh to improve post-transform vertex
+/// cache reuse.
+///
+/// This is an implementation of Tipsify (Sander, Nehab and Barczak, 2007),
+/// which runs in linear time and gets close to Forsyth's results. Only the
+/// triangle order changes; vertices stay where they are.
+///
+/// @param mesh The mesh to be optimized in place.
+/// @param cacheSize The size of the vertex cache being targeted.
+void optimizeVertexCache(TriangleMesh &mesh, size_t cacheSize = 16);
+
+/// @brief Reorders the vertices of a mesh in the order they are first
+/// referenced by its triangles, improving memory locality when fetching them.
+///
+/// Per-vertex normals are reordered along with the vertices. Vertices that are
+/// not referenced by any triangle are moved to the end.
+///
+/// @param mesh The mesh to be optimized in place.
+void optimizeVertexFetch(TriangleMesh &mesh);
+
+/// @brief Runs optimizeVertexCache and then optimizeVertexFetch on a mesh.
+///
+/// @param mesh The mesh to be optimized in place.
+void optimizeMesh(TriangleMesh &mesh);
+
+/// @brief Splits a mesh into meshlets, following its current triangle order.
+///
+/// Running optimizeMesh first makes for fuller, tighter meshlets.
+///
+/// @param mesh The mesh to be split.
+/// @param maxVertices The maximum number of vertices per meshlet (up to 255).
+/// @param maxTriangles The maximum number of triangles per meshlet (up to
+/// 255).
+/// @return The meshlets along with their vertex and triangle data.
+[[nodiscard]] MeshletSet buildMeshlets(const TriangleMesh &mesh,
+                                       size_t maxVertices = 64,
+                                       size_t maxTriangles = 126);
+
+/// @brief Checks whether every triangle of a meshlet faces away from a given
+/// point, in which case the whole meshlet can be skipped.
+///
+/// @param meshlet The meshlet to be tested.
+/// @param cameraPosition The position of the camera, in the mesh's own space.
+/// @return True if the meshlet is guaranteed to be back-facing.
+[[nodiscard]] bool isMeshletBackfacing(const Meshlet &meshlet,
+                                       const V3F &cameraPosition);
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_OPTIMIZER_HPP
@@ -0,0 +1,67 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_SIMPLIFIER_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_SIMPLIFIER_HPP
+
+#include <limits>
+
+#include "graphics/quad_mesh.hpp"
+#include "graphics/triangle_mesh.hpp"
+
+namespace vbag {
+
+/// @struct SimplificationResult
+/// @brief What's left of a mesh after simplifying it, and how far it moved.
+struct SimplificationResult {
+  size_t faceCount; ///< The number of faces the mesh ended up with.
+  /// @brief The largest distance from a collapsed vertex to the planes of
+  /// the faces of the original mesh it replaced.
+  float error;
+};
+
+/// @brief Simplifies a mesh in place by collapsing edges until it reaches a
+/// target triangle count or until no collapse is left that stays within a
+/// maximum error, whichever comes first.
+///
+/// This is the quadric error metric method by Garland and Heckbert. Every
+/// vertex accumulates the planes of its triangles, and every edge is collapsed
+/// into the point that is closest to the planes of both of its vertices, in
+/// order of increasing error. Collapses that would move a vertex further than
+/// the maximum error from the planes of the original faces it replaces are
+/// skipped; so are those that would flip triangles or make the mesh
+/// non-manifold, until a collapse nearby changes their neighbourhood.
+/// Boundary edges get extra planes perpendicular to them so that open borders
+/// keep their shape.
+///
+/// Quadrics and initial edge costs are computed in parallel; the collapses
+/// themselves are sequential, since each one depends on the ones before.
+///
+/// @param mesh The mesh to be simplified.
+/// @param targetTriangles The number of triangles to stop at.
+/// @param maxError The largest distance a vertex may end up from the planes
+/// of the original faces it replaces, in the same units as the vertices.
+/// @param preserveBoundary Whether open borders should be kept in place.
+/// @return The resulting triangle count and the largest error introduced.
+SimplificationResult
+simplifyMesh(TriangleMesh &mesh, size_t targetTriangles,
+             float maxError = std::numeric_limits<float>::infinity(),
+             bool preserveBoundary = true);
+
+/// @brief Simplifies a quad mesh in place, just like the TriangleMesh
+/// overload does.
+///
+/// Quads are split in two before simplifying, and the resulting triangles are
+/// stored as degenerate quads whose last vertex repeats the first.
+///
+/// @param mesh The mesh to be simplified.
+/// @param targetFaces The number of faces to stop at.
+/// @param maxError The largest distance a vertex may end up from the planes
+/// of the original faces it replaces, in the same units as the vertices.
+/// @param preserveBoundary Whether open borders should be kept in place.
+/// @return The resulting face count and the largest error introduced.
+SimplificationResult
+simplifyMesh(QuadMesh &mesh, size_t targetFaces,
+             float maxError = std::numeric_limits<float>::infinity(),
+             bool preserveBoundary = true);
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_MESH_SIMPLIFIER_HPP
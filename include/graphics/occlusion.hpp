@@ -0,0 +1,104 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_OCCLUSION_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_OCCLUSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "geometry/bounds.hpp"
+#include "math/vector.hpp"
+
+namespace vbag {
+
+/// @brief Where the depth objects are tested against for occlusion culling
+/// comes from.
+enum class OcclusionCulling {
+  /// @brief Nothing is tested; everything in the view volume is drawn.
+  Disabled,
+  /// @brief The meshes marked as occluders, rasterized into a coarse depth
+  /// buffer before anything else is processed. Works on every screen.
+  Occluders,
+  /// @brief The depth buffer of the previous frame, on screens that keep one
+  /// in memory. Needs no setup, but objects that are uncovered by fast camera
+  /// motion may show up a frame late.
+  PreviousFrame
+};
+
+/// @class HiZBuffer
+/// @brief A hierarchical depth buffer, for rejecting whole objects hidden
+/// behind what's already known to be drawn.
+///
+/// The finest level has a texel for every blockSize x blockSize pixels of
+/// the screen and holds the farthest depth found in them; every level above
+/// halves the resolution and keeps the farthest depth of the four texels
+/// below. A rectangle is then tested against the level where it covers 4x4
+/// texels at most, so the cost of a test doesn't depend on its
+/// size. Depths are in screen space, in [0, 1] with 1 at the far plane.
+///
+/// Occluder triangles are drawn with the farthest depth of their vertices,
+/// and a texel only takes it once the centers of all pixels behind it are
+/// covered, either by a single triangle or by several adding up (like the
+/// two halves of a quad), so an object is only reported hidden if it really
+/// is.
+class HiZBuffer {
+public:
+  /// @brief The width and height of the block of pixels behind a texel of
+  /// the finest level. Its pixels make up the bits of a coverage mask.
+  static constexpr size_t blockSize{8};
+
+  /// @brief Sizes the buffer for a screen and clears it to the far plane.
+  ///
+  /// @param width The width of the screen, in pixels.
+  /// @param height The height of the screen, in pixels.
+  void reset(size_t width, size_t height);
+
+  /// @brief Makes the finest level out of a full resolution depth buffer of
+  /// the size given to reset().
+  ///
+  /// @param depth The depth buffer, row by row.
+  void loadDepth(const float *depth);
+
+  /// @brief Rasterizes an occluder triangle into the finest level.
+  ///
+  /// @param triangle The vertices, in screen coordinates, in either winding.
+  void drawOccluder(const V3F (&triangle)[3]);
+
+  /// @brief Builds the coarser levels out of the finest one. Must be called
+  /// after it's done being written and before testing anything.
+  void buildPyramid();
+
+  /// @brief Checks whether everything within a rectangle of the screen is
+  /// behind the depth in the buffer.
+  ///
+  /// @param x0 The left of the rectangle, in pixels.
+  /// @param y0 The top of the rectangle, in pixels.
+  /// @param x1 The right of the rectangle, in pixels.
+  /// @param y1 The bottom of the rectangle, in pixels.
+  /// @param depth The nearest depth of whatever is in the rectangle.
+  /// @return True if it's hidden; false if any part of it might be visible.
+  [[nodiscard]] bool isOccluded(float x0, float y0, float x1, float y1,
+                                float depth) const;
+
+private:
+  struct Level {
+    size_t width, height;
+    std::vector<float> depth;
+  };
+
+  /// @brief Returns the mask of the pixels of a block of the finest level
+  /// that are off the screen.
+  [[nodiscard]] uint64_t offscreen_(size_t x, size_t y) const;
+
+  size_t width_{}, height_{};
+  std::vector<Level> levels_;
+  /// @brief The pixels of every block of the finest level covered by
+  /// occluder triangles that didn't cover the whole block, one bit each.
+  std::vector<uint64_t> coverage_;
+  /// @brief The farthest depth of the triangles in coverage_.
+  std::vector<float> coveredDepth_;
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_OCCLUSION_HPP
@@ -23,9 +23,13 @@ public:
     for (const auto &triangle : triangleMesh.triangles())
       // HACK: a degenerate quad, this is ridiculous but 100% functional
       addQuad(triangle.v1, triangle.v2, triangle.v3, triangle.v1);
+    faceNormals_ = triangleMesh.faceNormals();
   }
 
-  void addVertex(V3F vertex) { vertices_.emplace_back(vertex); }
+  void addVertex(V3F vertex) {
+    vertices_.emplace_back(vertex);
+    bounds_.invalidate();
+  }
 
   void addVertex(float x, float y, float z) { addVertex({x, y, z}); }
 
@@ -40,9 +44,22 @@ public:
   }
 
   [[nodiscard]] const auto &vertices() const { return vertices_; }
+  /// @brief Returns the vertices, to be changed. Changing them through a
+  /// reference kept from an earlier call leaves bounds stale.
+  auto &vertices() {
+    bounds_.invalidate();
+    return vertices_;
+  }
   [[nodiscard]] const auto &normals() const { return normals_; }
   auto &normals() { return normals_; }
   [[nodiscard]] const auto &faces() const { return quads_; }
+  auto &faces() { return quads_; }
+  [[nodiscard]] const auto &faceNormals() const { return faceNormals_; }
+  auto &faceNormals() { return faceNormals_; }
+
+  /// @brief Returns the bounding box of the vertices, in the space of the
+  /// mesh, computed once after they change rather than every frame.
+  [[nodiscard]] const Bounds &bounds() const { return bounds_.of(vertices_); }
 
   [[nodiscard]] TriangleMesh asTriangleMesh() const {
     TriangleMesh triangleMesh{name_ + "_as_triangle_mesh"};
@@ -54,11 +71,16 @@ public:
       triangleMesh.addTriangle(quad.v1, quad.v2, quad.v3);
       triangleMesh.addTriangle(quad.v1, quad.v3, quad.v4);
     }
+    if (faceNormals_.size() == quads_.size())
+      for (const auto &normal : faceNormals_)
+        triangleMesh.faceNormals().insert(triangleMesh.faceNormals().end(), 2,
+                                          normal);
     return triangleMesh;
   }
 
 private:
-  std::vector<V3F> vertices_, normals_;
+  std::vector<V3F> vertices_, normals_, faceNormals_;
+  CachedBounds bounds_; ///< Of vertices_.
   std::vector<Quad> quads_;
 };
 
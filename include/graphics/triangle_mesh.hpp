@@ -1,6 +1,7 @@
 #ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_TRIANGLE_MESH_HPP
 #define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_GRAPHICS_TRIANGLE_MESH_HPP
 
+#include "geometry/bounds.hpp"
 #include "geometry/object.hpp"
 #include "math/vector.hpp"
 #include <vector>
@@ -15,7 +16,10 @@ public:
 
   explicit TriangleMesh(std::string name) : Object(std::move(name)) {}
 
-  void addVertex(V3F vertex) { vertices_.emplace_back(vertex); }
+  void addVertex(V3F vertex) {
+    vertices_.emplace_back(vertex);
+    bounds_.invalidate();
+  }
 
   void addVertex(float x, float y, float z) { addVertex({x, y, z}); }
 
@@ -30,13 +34,34 @@ public:
   }
 
   [[nodiscard]] const auto &vertices() const { return vertices_; }
+  /// @brief Returns the vertices, to be changed. Changing them through a
+  /// reference kept from an earlier call leaves bounds stale.
+  auto &vertices() {
+    bounds_.invalidate();
+    return vertices_;
+  }
   [[nodiscard]] const auto &normals() const { return normals_; }
   auto &normals() { return normals_; }
   [[nodiscard]] const auto &triangles() const { return triangles_; }
+  auto &triangles() { return triangles_; }
+  [[nodiscard]] const auto &faceNormals() const { return faceNormals_; }
+  auto &faceNormals() { return faceNormals_; }
+
+  /// @brief Returns the bounding box of the vertices, in the space of the
+  /// mesh, computed once after they change rather than every frame.
+  [[nodiscard]] const Bounds &bounds() const { return bounds_.of(vertices_); }
+
+  /// @brief Marks the mesh as an occluder, whose triangles hide what's
+  /// behind them from occlusion culling (see Engine::setOcclusionCulling).
+  /// Large, simple meshes like walls and terrain make the best occluders.
+  void setOccluder(bool occluder) { isOccluder_ = occluder; }
+  [[nodiscard]] bool isOccluder() const { return isOccluder_; }
 
 private:
-  std::vector<V3F> vertices_, normals_;
+  std::vector<V3F> vertices_, normals_, faceNormals_;
+  CachedBounds bounds_; ///< Of vertices_.
   std::vector<Triangle> triangles_;
+  bool isOccluder_{};
 };
 
 } // namespace vbag
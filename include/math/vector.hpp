@@ -197,6 +197,80 @@ template <> struct Vector<float, 3> {
 /// @brief Type alias for a 3D vector with elements of type float.
 using V3F = Vector<float, 3>;
 
+/// @brief Specialization of the Vector class for 4D vectors with float
+/// elements.
+///
+/// Mostly used for points in homogeneous clip space, where w has not been
+/// divided out yet, so only the operations needed to interpolate between such
+/// points are provided.
+template <> struct Vector<float, 4> {
+  /// @brief Computes the dot product between this vector and another vector.
+  ///
+  /// @param other The other vector for the dot product computation.
+  /// @return The dot product between this vector and the other vector.
+  [[nodiscard]] auto dot(const Vector &other) const {
+    return x * other.x + y * other.y + z * other.z + w * other.w;
+  }
+
+  /// @brief Adds another vector to this vector (element-wise addition).
+  ///
+  /// @param other The vector to add to this vector.
+  /// @return A new vector resulting from the element-wise addition.
+  [[nodiscard]] auto operator+(const Vector &other) const {
+    return Vector{x + other.x, y + other.y, z + other.z, w + other.w};
+  }
+
+  /// @brief Subtracts another vector from this vector (element-wise
+  /// subtraction).
+  ///
+  /// @param other The vector to subtract from this vector.
+  /// @return A new vector resulting from the element-wise subtraction.
+  [[nodiscard]] auto operator-(const Vector &other) const {
+    return Vector{x - other.x, y - other.y, z - other.z, w - other.w};
+  }
+
+  /// @brief Multiplies the vector by a scalar (element-wise scalar
+  /// multiplication).
+  ///
+  /// @param scalar The scalar value to multiply the vector by.
+  /// @return A new vector resulting from the element-wise scalar
+  /// multiplication.
+  [[nodiscard]] auto operator*(float scalar) const {
+    return Vector{scalar * x, scalar * y, scalar * z, scalar * w};
+  }
+
+  /// @brief Returns the 3D vector resulting from dividing x, y and z by w (the
+  /// perspective divide).
+  ///
+  /// If w is zero, x, y and z are returned as they are.
+  ///
+  /// @return The 3D vector after the division.
+  [[nodiscard]] auto projected() const {
+    const auto den{vbag::isZero(w) ? 1.0f : w};
+    return V3F{x / den, y / den, z / den};
+  }
+
+  float x, y, z, w; ///< The vector elements (x, y, z, w) for 4D vectors.
+};
+
+/// @brief Type alias for a 4D vector with elements of type float.
+using V4F = Vector<float, 4>;
+
+/// @brief Multiplies a 4x4 matrix by a 4D (column) vector.
+///
+/// @param matrix The matrix to multiply the vector by.
+/// @param vector The vector to be multiplied.
+/// @return The resulting 4D vector.
+[[nodiscard]] inline V4F operator*(const M4F &matrix, const V4F &vector) {
+  const auto *m{matrix.data};
+  return {m[0] * vector.x + m[1] * vector.y + m[2] * vector.z + m[3] * vector.w,
+          m[4] * vector.x + m[5] * vector.y + m[6] * vector.z + m[7] * vector.w,
+          m[8] * vector.x + m[9] * vector.y + m[10] * vector.z +
+              m[11] * vector.w,
+          m[12] * vector.x + m[13] * vector.y + m[14] * vector.z +
+              m[15] * vector.w};
+}
+
 } // namespace vbag
 
 #endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_VECTOR_HPP
@@ -0,0 +1,124 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_COMMAND_BUFFER_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_COMMAND_BUFFER_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "output/screen.hpp"
+
+namespace vbag {
+
+/// @class CommandBuffer
+/// @brief Records draw calls for a frame so they can be reordered and merged
+/// before they reach a Screen.
+///
+/// Every draw call becomes a packet with a 64-bit sort key made of, from the
+/// most significant bits down, the primitive type (triangles, then lines,
+/// then points), a state value chosen by whoever records it, and the depth of
+/// the packet's nearest vertex. execute() radix sorts the packets by key and
+/// hands them to the screen in a single pass, merging runs of packets with
+/// the same type and state into one batched call. Screens that keep a depth
+/// buffer (where Screen::depth isn't null) get nearer packets first, so they
+/// skip most of the hidden pixels. Other screens, like D3d9Screen, get
+/// farther packets first, so nearer ones paint over them.
+///
+/// The sort is stable, so packets with equal keys keep the order they were
+/// recorded in. Threads can record into command buffers of their own, which
+/// are then appended into one in a fixed order, so the result doesn't depend
+/// on how the threads were scheduled.
+class CommandBuffer {
+public:
+  /// @brief What execute() handed to a screen.
+  struct Submission {
+    size_t calls{}; ///< Draw calls made.
+    /// @brief Primitives drawn; vertices are three per triangle.
+    size_t triangles{}, lines{}, points{};
+    size_t bytes{}; ///< The size of the vertices, colors, lines and points.
+  };
+
+  /// @brief Constructs an empty command buffer with room for a small frame,
+  /// so frames whose size varies don't keep growing its storage.
+  CommandBuffer();
+
+  /// @brief Drops every recorded packet, keeping the storage for the next
+  /// frame.
+  void clear();
+
+  /// @brief Records a list of triangles, laid out like Screen::drawTriangles
+  /// takes them.
+  ///
+  /// @param vertices The vertices in screen coordinates, three per triangle.
+  /// @param colors The colors of the vertices.
+  /// @param state A value packets are grouped by; only packets with the same
+  /// state are merged.
+  void drawTriangles(std::span<const V3F> vertices,
+                     std::span<const D3DCOLOR> colors, uint16_t state = 0);
+
+  /// @brief Records a list of lines.
+  ///
+  /// @param lines The lines in screen coordinates.
+  /// @param state A value packets are grouped by.
+  void drawLines(std::span<const Line> lines, uint16_t state = 0);
+
+  /// @brief Records a list of points.
+  ///
+  /// @param points The points in screen coordinates.
+  /// @param state A value packets are grouped by.
+  void drawPoints(std::span<const V3F> points, uint16_t state = 0);
+
+  /// @brief Appends the packets of another command buffer after the ones
+  /// recorded here.
+  void append(const CommandBuffer &other);
+
+  /// @brief Sorts the packets and draws them on a screen, merging the ones
+  /// that can be drawn together.
+  ///
+  /// The packets stay recorded (in sorted order) until clear() is called.
+  ///
+  /// @return What was drawn, and with how many calls.
+  Submission execute(Screen &screen);
+
+  /// @brief Returns the number of recorded packets.
+  [[nodiscard]] size_t packetCount() const;
+
+  /// @brief Returns whether nothing has been recorded.
+  [[nodiscard]] bool empty() const;
+
+private:
+  enum class PrimitiveType : uint8_t { Triangles, Lines, Points };
+
+  /// @brief A recorded draw call: a range of the vertex (or line) storage of
+  /// its primitive type.
+  struct Packet {
+    uint64_t key;
+    uint32_t first, count;
+  };
+
+  [[nodiscard]] static uint64_t key_(PrimitiveType type, uint16_t state,
+                                     float depth);
+  [[nodiscard]] static PrimitiveType type_(uint64_t key);
+
+  /// @brief Sorts the packets by key with a stable LSD radix sort, a byte at
+  /// a time.
+  void sort_();
+
+  /// @brief Draws the packets [begin, end), which all have the same type and
+  /// state, with a single call.
+  void executeRun_(Screen &screen, size_t begin, size_t end);
+
+  std::vector<Packet> packets_, sortScratch_;
+  /// @brief The vertices and colors of triangle packets.
+  std::vector<V3F> vertices_;
+  std::vector<D3DCOLOR> colors_;
+  std::vector<Line> lines_;
+  std::vector<V3F> points_;
+  /// @brief Where merged runs of packets are gathered.
+  std::vector<V3F> vertexScratch_;
+  std::vector<D3DCOLOR> colorScratch_;
+  std::vector<Line> lineScratch_;
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_COMMAND_BUFFER_HPP
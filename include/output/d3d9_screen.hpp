@@ -1,42 +1,22 @@
-#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_SCREEN_HPP
-#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_SCREEN_HPP
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_D3D9_SCREEN_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_D3D9_SCREEN_HPP
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <d3d9.h>
+#include <span>
 #include <string>
+#include <vector>
 #include <windows.h>
 
 #include "graphics/color.hpp"
 #include "math/vector.hpp"
+#include "output/screen.hpp"
 
 namespace vbag {
 
-class D3d9Screen;
-class Engine;
-
-struct Line {
-  V3F start, end;
-  D3DCOLOR color;
-};
-
-class Screen {
-public:
-  virtual void clear() = 0;
-  [[nodiscard]] virtual size_t width() const = 0;
-  [[nodiscard]] virtual size_t height() const = 0;
-  virtual void drawLine(const Line &line) = 0;
-  virtual void drawLines(const Line *lines, size_t n) = 0;
-  virtual void drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1, D3DCOLOR c2,
-                            D3DCOLOR c3) = 0;
-  virtual void drawPoint(V3F p) = 0;
-  virtual void present() = 0;
-  virtual HWND window() = 0;
-
-protected:
-};
-
 class D3d9Screen : public Screen {
 private:
   class Error : public std::exception {
@@ -92,6 +72,11 @@ public:
     if (!device_)
       throw Error{"could not create D3D device"};
 
+    // how many primitives a single draw call may have
+    D3DCAPS9 caps{};
+    device_->GetDeviceCaps(&caps);
+    maxPrimitives_ = (std::max)(size_t(caps.MaxPrimitiveCount), size_t{1});
+
     ShowWindow(window_, SW_SHOWDEFAULT);
   }
 
@@ -136,34 +121,18 @@ public:
   }
 
   void drawLines(const Line *lines, size_t n) override {
-    struct Vertex {
-      float x, y, z, rhw;
-      D3DCOLOR diffuse;
-    };
-
     if (n == 0)
       return;
 
-    constexpr auto VertexType{D3DFVF_XYZRHW | D3DFVF_DIFFUSE};
-
-    std::vector<Vertex> vertices;
+    vertices_.clear();
     for (size_t i{}; i < n; ++i) {
       auto color{lines[i].color};
-      vertices.push_back(
+      vertices_.push_back(
           {lines[i].start.x, lines[i].start.y, lines[i].start.z, 1, color});
-      vertices.push_back(
+      vertices_.push_back(
           {lines[i].end.x, lines[i].end.y, lines[i].end.z, 1, color});
     }
-
-    device_->SetFVF(VertexType);
-
-    IDirect3DVertexBuffer9 *vertexBuffer;
-    device_->CreateVertexBuffer(2 * n * sizeof(Vertex), 0, VertexType,
-                                D3DPOOL_DEFAULT, &vertexBuffer, nullptr);
-    void *vertexBufferData;
-    vertexBuffer->Lock(0, 2 * n * sizeof(Vertex), &vertexBufferData, 0);
-    memcpy(vertexBufferData, vertices.data(), 2 * n * sizeof(Vertex));
-    vertexBuffer->Unlock();
+    auto vertexBuffer{createVertexBuffer_(vertices_)};
     device_->SetStreamSource(0, vertexBuffer, 0, sizeof(Vertex));
     device_->SetRenderState(D3DRS_FILLMODE, D3DFILL_WIREFRAME);
 
@@ -177,57 +146,91 @@ public:
 
   void drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1, D3DCOLOR c2,
                     D3DCOLOR c3) override {
-    struct Vertex {
-      float x, y, z, rhw;
-      D3DCOLOR diffuse;
-    };
+    const V3F vertices[3]{v1, v2, v3};
+    const D3DCOLOR colors[3]{c1, c2, c3};
+    drawTriangles(vertices, colors);
+  }
 
-    constexpr auto VertexType{D3DFVF_XYZRHW | D3DFVF_DIFFUSE};
-    const Vertex vertices[3]{{v1.x, v1.y, v1.z, 1, c1},
-                             {v2.x, v2.y, v2.z, 1, c2},
-                             {v3.x, v3.y, v3.z, 1, c3}};
-    device_->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE);
-    IDirect3DVertexBuffer9 *vertexBuffer;
-    device_->CreateVertexBuffer(3 * sizeof(Vertex), 0, VertexType,
-                                D3DPOOL_DEFAULT, &vertexBuffer, nullptr);
-    void *vertexBufferData;
-    vertexBuffer->Lock(0, 3 * sizeof(Vertex), &vertexBufferData, 0);
-    memcpy(vertexBufferData, vertices, 3 * sizeof(Vertex));
-    vertexBuffer->Unlock();
+  void drawPoint(V3F p) override { drawPoints({&p, 1}); }
+
+  void drawTriangles(std::span<const V3F> vertices,
+                     std::span<const D3DCOLOR> colors) override {
+    const auto triangles{vertices.size() / 3};
+    if (triangles == 0)
+      return;
+
+    vertices_.resize(3 * triangles);
+    for (size_t i{}; i < vertices_.size(); ++i)
+      vertices_[i] = {vertices[i].x, vertices[i].y, vertices[i].z, 1,
+                      colors[i]};
+    auto vertexBuffer{createVertexBuffer_(vertices_)};
     device_->SetStreamSource(0, vertexBuffer, 0, sizeof(Vertex));
     device_->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
 
     device_->BeginScene();
-    device_->DrawPrimitive(D3DPT_TRIANGLELIST, 0, 1);
+    for (size_t first{}; first < triangles; first += maxPrimitives_)
+      device_->DrawPrimitive(D3DPT_TRIANGLELIST, UINT(3 * first),
+                             UINT((std::min)(maxPrimitives_,
+                                             triangles - first)));
     device_->EndScene();
     vertexBuffer->Release();
   }
 
-  void drawPoint(V3F p) override {
-    struct Vertex {
-      float x, y, z, rhw;
-      D3DCOLOR diffuse;
-    };
+  void drawIndexedTriangles(std::span<const V3F> vertices,
+                            std::span<const D3DCOLOR> colors,
+                            std::span<const uint32_t> indices) override {
+    const auto triangles{indices.size() / 3};
+    if (triangles == 0 || vertices.empty())
+      return;
 
-    constexpr auto VertexType{D3DFVF_XYZRHW | D3DFVF_DIFFUSE};
+    vertices_.resize(vertices.size());
+    for (size_t i{}; i < vertices_.size(); ++i)
+      vertices_[i] = {vertices[i].x, vertices[i].y, vertices[i].z, 1,
+                      colors[i]};
+    auto vertexBuffer{createVertexBuffer_(vertices_)};
+
+    const auto indexBytes{UINT(3 * triangles * sizeof(uint32_t))};
+    IDirect3DIndexBuffer9 *indexBuffer;
+    device_->CreateIndexBuffer(indexBytes, D3DUSAGE_WRITEONLY, D3DFMT_INDEX32,
+                               D3DPOOL_DEFAULT, &indexBuffer, nullptr);
+    void *indexBufferData;
+    indexBuffer->Lock(0, indexBytes, &indexBufferData, 0);
+    memcpy(indexBufferData, indices.data(), indexBytes);
+    indexBuffer->Unlock();
 
-    const Vertex vertices[1]{{p.x, p.y, p.z, 1, D3DCOLOR_XRGB(255, 255, 255)}};
+    device_->SetStreamSource(0, vertexBuffer, 0, sizeof(Vertex));
+    device_->SetIndices(indexBuffer);
+    device_->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
 
-    device_->SetFVF(VertexType);
+    device_->BeginScene();
+    for (size_t first{}; first < triangles; first += maxPrimitives_)
+      device_->DrawIndexedPrimitive(
+          D3DPT_TRIANGLELIST, 0, 0, UINT(vertices_.size()), UINT(3 * first),
+          UINT((std::min)(maxPrimitives_, triangles - first)));
+    device_->EndScene();
+    indexBuffer->Release();
+    vertexBuffer->Release();
+  }
 
-    IDirect3DVertexBuffer9 *vertexBuffer;
-    device_->CreateVertexBuffer(sizeof(Vertex), 0, VertexType, D3DPOOL_DEFAULT,
-                                &vertexBuffer, nullptr);
-    void *vertexBufferData;
-    vertexBuffer->Lock(0, sizeof(Vertex), &vertexBufferData, 0);
-    memcpy(vertexBufferData, vertices, sizeof(Vertex));
-    vertexBuffer->Unlock();
+  void drawPoints(std::span<const V3F> points) override {
+    if (points.empty())
+      return;
+
+    vertices_.resize(points.size());
+    for (size_t i{}; i < vertices_.size(); ++i)
+      vertices_[i] = {points[i].x, points[i].y, points[i].z, 1,
+                      D3DCOLOR_XRGB(255, 255, 255)};
+    auto vertexBuffer{createVertexBuffer_(vertices_)};
     device_->SetStreamSource(0, vertexBuffer, 0, sizeof(Vertex));
     device_->SetRenderState(D3DRS_FILLMODE, D3DFILL_WIREFRAME);
     float pointScale{5};
     device_->SetRenderState(D3DRS_POINTSIZE, *(DWORD *)&pointScale);
+
     device_->BeginScene();
-    device_->DrawPrimitive(D3DPT_POINTLIST, 0, 1);
+    for (size_t first{}; first < points.size(); first += maxPrimitives_)
+      device_->DrawPrimitive(
+          D3DPT_POINTLIST, UINT(first),
+          UINT((std::min)(maxPrimitives_, points.size() - first)));
     device_->EndScene();
     device_->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
     vertexBuffer->Release();
@@ -261,6 +264,31 @@ private:
     }
   }
 
+  /// @brief The vertices the batched draw calls upload: already transformed,
+  /// with a diffuse color.
+  struct Vertex {
+    float x, y, z, rhw;
+    D3DCOLOR diffuse;
+  };
+
+  static constexpr DWORD vertexType_{D3DFVF_XYZRHW | D3DFVF_DIFFUSE};
+
+  /// @brief Uploads vertices into a new vertex buffer and sets the vertex
+  /// format to match. The caller releases the buffer.
+  IDirect3DVertexBuffer9 *
+  createVertexBuffer_(const std::vector<Vertex> &data) {
+    const auto bytes{UINT(data.size() * sizeof(Vertex))};
+    device_->SetFVF(vertexType_);
+    IDirect3DVertexBuffer9 *vertexBuffer;
+    device_->CreateVertexBuffer(bytes, D3DUSAGE_WRITEONLY, vertexType_,
+                                D3DPOOL_DEFAULT, &vertexBuffer, nullptr);
+    void *vertexBufferData;
+    vertexBuffer->Lock(0, bytes, &vertexBufferData, 0);
+    memcpy(vertexBufferData, data.data(), bytes);
+    vertexBuffer->Unlock();
+    return vertexBuffer;
+  }
+
   static constexpr auto windowClassName_{"d3d9_window_class"};
 
   HINSTANCE instance_;
@@ -268,8 +296,12 @@ private:
   LPDIRECT3D9 d3d_;
   LPDIRECT3DDEVICE9 device_{};
   size_t width_, height_;
+  size_t maxPrimitives_{};
+  /// @brief Where the draw calls convert their vertices before uploading
+  /// them, kept between calls so the storage is reused.
+  std::vector<Vertex> vertices_;
 };
 
 } // namespace vbag
 
-#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_SCREEN_HPP
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_D3D9_SCREEN_HPP
@@ -0,0 +1,120 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_FRAME_CAPTURE_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_FRAME_CAPTURE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vbag {
+
+/// @brief Saves a frame as an image, in the format its extension names:
+/// binary PPM (.ppm) or PNG (.png).
+///
+/// PNGs are written uncompressed (with stored deflate blocks), which is fast
+/// and still readable by everything. The alpha channel is dropped.
+///
+/// @param path The path of the image.
+/// @param pixels The pixels of the frame, row by row, packed as 0xAABBGGRR
+/// like SoftwareScreen::pixels() returns them.
+/// @param width The width of the frame, in pixels.
+/// @param height The height of the frame, in pixels.
+/// @throw RuntimeError<UnsupportedImageFormat> If the extension is neither
+/// .ppm nor .png.
+/// @throw RuntimeError<CouldNotOpenFile> If the file can't be written.
+void saveImage(const std::string &path, const uint32_t *pixels, size_t width,
+               size_t height);
+
+/// @brief The formats a FrameRecorder can stream.
+enum class VideoFormat {
+  /// @brief YUV4MPEG2 with 4:2:0 full range chroma, which encoders like
+  /// ffmpeg read as is.
+  Y4m,
+  /// @brief Headerless 8-bit RGB frames, one after the other.
+  RawRgb
+};
+
+/// @class FrameRecorder
+/// @brief Streams frames to a video file or a pipe from a thread of its own.
+///
+/// push() copies a frame into one of a fixed number of buffers and returns;
+/// the writer thread converts and writes the queued frames in order. When
+/// every buffer is queued, push() either waits for the writer or drops the
+/// frame, so memory use is bounded either way.
+///
+/// Frames can be recorded from a SoftwareScreen (or anything deriving from
+/// it) with SoftwareScreen::setRecorder, which pushes every presented frame.
+class FrameRecorder {
+public:
+  /// @brief Opens the output and starts the writer thread.
+  ///
+  /// @param path Where the stream goes: a file, "-" for the standard output,
+  /// or "|" followed by a command whose standard input it's piped into.
+  /// @param width The width of the frames, in pixels.
+  /// @param height The height of the frames, in pixels.
+  /// @param format The format of the stream.
+  /// @param frameRate The frame rate written in the Y4M header.
+  /// @param queueDepth How many frames may wait to be written.
+  /// @param dropWhenFull Whether frames pushed while the queue is full are
+  /// dropped rather than waited for.
+  /// @throw RuntimeError<CouldNotOpenFile> If the output can't be opened.
+  FrameRecorder(const std::string &path, size_t width, size_t height,
+                VideoFormat format = VideoFormat::Y4m, float frameRate = 60,
+                size_t queueDepth = 4, bool dropWhenFull = false);
+
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  /// @brief Writes the frames still queued and closes the output.
+  ~FrameRecorder();
+
+  /// @brief Queues a frame to be written.
+  ///
+  /// @param pixels The pixels of the frame, packed as 0xAABBGGRR, with the
+  /// size given to the constructor.
+  void push(const uint32_t *pixels);
+
+  /// @brief Returns how many frames have been written so far.
+  [[nodiscard]] size_t framesWritten() const;
+
+  /// @brief Returns how many frames were dropped because the queue was full.
+  [[nodiscard]] size_t framesDropped() const;
+
+  /// @brief Returns whether writing to the output has failed, after which
+  /// frames are discarded.
+  [[nodiscard]] bool failed() const;
+
+private:
+  /// @brief What the writer thread runs: writes queued frames until the
+  /// recorder is destroyed.
+  void write_();
+
+  /// @brief Converts a frame to the output format, into encoded_.
+  void encode_(const std::vector<uint32_t> &frame);
+
+  size_t width_, height_;
+  VideoFormat format_;
+  bool dropWhenFull_;
+  std::FILE *file_;
+  bool isPipe_{};
+
+  mutable std::mutex mutex_;
+  std::condition_variable frameQueued_, bufferFreed_;
+  std::deque<std::vector<uint32_t>> queue_;
+  std::vector<std::vector<uint32_t>> freeBuffers_;
+  size_t written_{}, dropped_{};
+  bool stopping_{}, failed_{};
+
+  /// @brief The bytes of the frame being written; only the writer thread
+  /// touches it.
+  std::vector<uint8_t> encoded_;
+  std::thread writer_;
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_FRAME_CAPTURE_HPP
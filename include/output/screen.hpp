@@ -0,0 +1,93 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SCREEN_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SCREEN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "graphics/color.hpp"
+#include "math/vector.hpp"
+
+namespace vbag {
+
+struct Line {
+  V3F start, end;
+  D3DCOLOR color;
+};
+
+class Screen {
+public:
+  virtual ~Screen() = default;
+
+  virtual void clear() = 0;
+  [[nodiscard]] virtual size_t width() const = 0;
+  [[nodiscard]] virtual size_t height() const = 0;
+  virtual void drawLine(const Line &line) = 0;
+  virtual void drawLines(const Line *lines, size_t n) = 0;
+  virtual void drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1, D3DCOLOR c2,
+                            D3DCOLOR c3) = 0;
+  virtual void drawPoint(V3F p) = 0;
+
+  /// @brief Draws a list of triangles in a single submission.
+  ///
+  /// Every three consecutive vertices make a triangle, in the same order
+  /// drawTriangle takes them, and each vertex is colored by the color at the
+  /// same position. Screens that can do better than one drawTriangle call per
+  /// triangle should override this.
+  ///
+  /// @param vertices The vertices, three per triangle.
+  /// @param colors The colors of the vertices; at least as many as vertices.
+  virtual void drawTriangles(std::span<const V3F> vertices,
+                             std::span<const D3DCOLOR> colors) {
+    for (size_t i{}; i + 2 < vertices.size(); i += 3)
+      drawTriangle(vertices[i], vertices[i + 1], vertices[i + 2], colors[i],
+                   colors[i + 1], colors[i + 2]);
+  }
+
+  /// @brief Draws a list of triangles that share vertices in a single
+  /// submission.
+  ///
+  /// Works like drawTriangles, except that every three consecutive indices
+  /// make a triangle out of the vertices (and colors) they point to.
+  ///
+  /// @param vertices The vertices the triangles are made of.
+  /// @param colors The colors of the vertices; at least as many as vertices.
+  /// @param indices The indices of the vertices, three per triangle.
+  virtual void drawIndexedTriangles(std::span<const V3F> vertices,
+                                    std::span<const D3DCOLOR> colors,
+                                    std::span<const uint32_t> indices) {
+    for (size_t i{}; i + 2 < indices.size(); i += 3)
+      drawTriangle(vertices[indices[i]], vertices[indices[i + 1]],
+                   vertices[indices[i + 2]], colors[indices[i]],
+                   colors[indices[i + 1]], colors[indices[i + 2]]);
+  }
+
+  /// @brief Draws a list of points in a single submission, like drawPoint
+  /// does.
+  virtual void drawPoints(std::span<const V3F> points) {
+    for (const auto &point : points)
+      drawPoint(point);
+  }
+
+  virtual void present() = 0;
+
+  /// @brief Returns the depth buffer of the last frame drawn, row by row,
+  /// with depths in [0, 1] and 1 at the far plane, or nullptr if the screen
+  /// doesn't keep one in memory.
+  [[nodiscard]] virtual const float *depth() const { return nullptr; }
+#if defined(_WIN32)
+  /// @brief Returns the window the screen presents to, or nullptr if it
+  /// doesn't have one.
+  [[nodiscard]] virtual HWND window() { return nullptr; }
+#endif
+
+protected:
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SCREEN_HPP
@@ -0,0 +1,155 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SOFTWARE_SCREEN_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SOFTWARE_SCREEN_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "output/screen.hpp"
+#include "util/job_system.hpp"
+
+namespace vbag {
+
+class FrameRecorder;
+
+/// @class SoftwareScreen
+/// @brief A Screen that rasterizes everything on the CPU into memory, without
+/// a window or any platform dependencies.
+///
+/// Drawing goes to a back buffer with a depth buffer attached, and present()
+/// swaps it with the front buffer, which is what pixels() returns. Pixels are
+/// RGBA with 8 bits per channel, packed as 0xAABBGGRR so the bytes come out
+/// in R, G, B, A order on little-endian machines.
+///
+/// Vertices are expected in screen coordinates, with x and y in pixels (y
+/// growing downwards) and z in [0, 1]. Fragments pass the depth test if they
+/// are closer than what was drawn there before. Triangles of either winding
+/// are drawn, since culling is up to whoever submits them.
+///
+/// Draw calls are only recorded; they are rasterized by flush() (which
+/// present() calls). The screen is split into tiles of tileSize x tileSize
+/// pixels, every primitive is binned to the tiles it touches, and then the
+/// tiles are rasterized in parallel, on a job system the screen keeps for
+/// good, so presenting doesn't start threads. Every tile belongs to a single
+/// thread, so the buffers need no locks, and its primitives are drawn in the
+/// order they were submitted.
+class SoftwareScreen : public Screen {
+public:
+  /// @brief The width and height of the tiles the screen is split into.
+  static constexpr size_t tileSize{64};
+
+  /// @brief Constructs a screen with buffers of the given size.
+  ///
+  /// @param width The width of the screen, in pixels.
+  /// @param height The height of the screen, in pixels.
+  /// @param threads How many threads rasterize tiles, the one presenting
+  /// included; 0 means one per hardware thread. They are the screen's own,
+  /// apart from the engine's: with a pipeline depth above 1, the engine
+  /// records a frame while the screen rasterizes the one before, so the two
+  /// should split the hardware threads between them rather than both take
+  /// all of them.
+  SoftwareScreen(size_t width, size_t height, size_t threads = 0);
+
+  /// @brief Clears the back buffer to black and the depth buffer to the far
+  /// plane.
+  void clear() override;
+
+  /// @brief Clears the back buffer to a color and the depth buffer to the far
+  /// plane.
+  void fill(uint8_t r, uint8_t g, uint8_t b);
+
+  [[nodiscard]] size_t width() const override;
+  [[nodiscard]] size_t height() const override;
+
+  void drawLine(const Line &line) override;
+  void drawLines(const Line *lines, size_t n) override;
+
+  /// @brief Draws a triangle, interpolating the colors of its vertices across
+  /// it (Gouraud shading).
+  void drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1, D3DCOLOR c2,
+                    D3DCOLOR c3) override;
+
+  /// @brief Draws a white 5x5 pixel square centered at a point.
+  void drawPoint(V3F p) override;
+
+  void drawTriangles(std::span<const V3F> vertices,
+                     std::span<const D3DCOLOR> colors) override;
+  void drawIndexedTriangles(std::span<const V3F> vertices,
+                            std::span<const D3DCOLOR> colors,
+                            std::span<const uint32_t> indices) override;
+  void drawPoints(std::span<const V3F> points) override;
+
+  /// @brief Rasterizes everything drawn so far into the back buffer.
+  void flush();
+
+  /// @brief Rasterizes everything drawn so far and swaps the back buffer with
+  /// the front buffer.
+  void present() override;
+
+  /// @brief Returns the pixels of the last presented frame, row by row.
+  [[nodiscard]] const uint32_t *pixels() const;
+
+  /// @brief Returns the depth buffer as of the last flush, row by row.
+  [[nodiscard]] const float *depth() const override;
+
+  /// @brief Returns how many frames have been presented so far.
+  [[nodiscard]] size_t frameCount() const;
+
+  /// @brief Makes present() push every frame to a recorder, until it's set
+  /// back to nullptr.
+  ///
+  /// @param recorder The recorder, which must have the size of the screen
+  /// and outlive its use here.
+  void setRecorder(FrameRecorder *recorder);
+
+private:
+  enum class PrimitiveType : uint8_t { Clear, Triangle, Line, Point };
+
+  /// @brief A recorded draw call. Lines only use the first two vertices and
+  /// colors, points and clears only the first ones.
+  struct Primitive {
+    PrimitiveType type{};
+    V3F vertices[3]{};
+    uint32_t colors[3]{};
+  };
+
+  /// @brief A rectangle of pixels, from (x0, y0) inclusive to (x1, y1)
+  /// exclusive.
+  struct Rect {
+    long long x0, y0, x1, y1;
+  };
+
+  /// @brief Adds a primitive to the bins of the tiles it touches.
+  void bin_(uint32_t index, std::vector<uint32_t> *bins);
+
+  /// @brief Draws the binned primitives of a tile, in submission order.
+  void rasterizeTile_(size_t tile, size_t binChunks);
+
+  void clearRect_(const Rect &rect, uint32_t color);
+  void drawTriangle_(const Primitive &triangle, const Rect &rect);
+  void drawLine_(const Primitive &line, const Rect &rect);
+  void drawPoint_(const Primitive &point, const Rect &rect);
+
+  /// @brief Writes a pixel if it's inside a rectangle and passes the depth
+  /// test.
+  void plot_(long long x, long long y, float z, uint32_t color,
+             const Rect &rect);
+
+  [[nodiscard]] Rect tileRect_(size_t tile) const;
+
+  size_t width_, height_;
+  size_t tilesX_, tilesY_;
+  JobSystem jobs_; ///< Bins and rasterizes the tiles.
+  std::vector<uint32_t> backBuffer_, frontBuffer_;
+  std::vector<float> depthBuffer_;
+  std::vector<Primitive> primitives_;
+  /// @brief The primitive indices of every tile, one list per tile for each
+  /// chunk of primitives binned in parallel (chunk-major). They are kept
+  /// between frames so their storage is reused.
+  std::vector<std::vector<uint32_t>> bins_;
+  size_t frameCount_{};
+  FrameRecorder *recorder_{};
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_SOFTWARE_SCREEN_HPP
@@ -0,0 +1,101 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TERMINAL_SCREEN_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TERMINAL_SCREEN_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "output/software_screen.hpp"
+
+namespace vbag {
+
+/// @brief How a TerminalScreen turns pixels into characters.
+enum class TerminalGlyphs {
+  /// @brief Upper half blocks, whose foreground and background colors are the
+  /// top and bottom halves of the cell: two colored pixels per cell.
+  HalfBlocks,
+  /// @brief Braille patterns, with a dot for every lit pixel of a 2x4 block
+  /// and the brightest color of the block: eight one-color pixels per cell.
+  Braille
+};
+
+/// @class TerminalScreen
+/// @brief A Screen that draws to a terminal with ANSI escape sequences and
+/// 24-bit colors.
+///
+/// Frames are rasterized like on a SoftwareScreen, at 2x4 pixels per
+/// character cell, and downsampled into cells according to the glyphs in use
+/// (half blocks average each half of the cell). present() then writes only
+/// the cells that changed since the previous frame: runs of changed cells
+/// share a single cursor movement, colors are only set when they change, and
+/// the whole frame goes out in a single write to the file descriptor.
+///
+/// The cursor is hidden while the screen is alive, and the terminal's colors
+/// and cursor are restored when it's destroyed.
+class TerminalScreen : public SoftwareScreen {
+public:
+  /// @brief The width and height of the block of pixels behind a cell.
+  static constexpr size_t cellWidth{2}, cellHeight{4};
+
+  /// @brief Constructs a screen covering a number of character cells.
+  ///
+  /// @param columns The width of the screen, in cells.
+  /// @param rows The height of the screen, in cells.
+  /// @param glyphs The characters the cells are drawn with.
+  /// @param fd The file descriptor the frames are written to.
+  /// @param threads How many threads rasterize tiles; 0 means one per
+  /// hardware thread.
+  TerminalScreen(size_t columns, size_t rows,
+                 TerminalGlyphs glyphs = TerminalGlyphs::HalfBlocks,
+                 int fd = 1, size_t threads = 0);
+
+  TerminalScreen(const TerminalScreen &) = delete;
+  TerminalScreen &operator=(const TerminalScreen &) = delete;
+
+  ~TerminalScreen() override;
+
+  /// @brief Rasterizes the frame and writes the cells that changed to the
+  /// terminal.
+  void present() override;
+
+  /// @brief Returns how many bytes the last presented frame took.
+  [[nodiscard]] size_t lastFrameBytes() const;
+
+private:
+  /// @brief A character cell: a code point and the colors it's drawn with,
+  /// as 0xRRGGBB.
+  struct Cell {
+    uint32_t glyph, foreground, background;
+
+    bool operator==(const Cell &) const = default;
+  };
+
+  /// @brief Turns the pixels of the presented frame into cells.
+  void downsample_();
+
+  /// @brief Makes a half block cell out of the averages of its halves, as
+  /// pixels. Cells of a single color become spaces, which don't need a
+  /// foreground color.
+  [[nodiscard]] static Cell halfBlock_(uint32_t top, uint32_t bottom);
+
+  /// @brief Downsamples the cell at (column, row) one pixel at a time.
+  [[nodiscard]] Cell cell_(size_t column, size_t row) const;
+
+  /// @brief Appends the escape sequences that turn the previous frame into
+  /// the current one to the output.
+  void encode_();
+
+  /// @brief Writes the whole output to the file descriptor.
+  void write_(const std::string &bytes) const;
+
+  size_t columns_, rows_;
+  TerminalGlyphs glyphs_;
+  int fd_;
+  std::vector<Cell> cells_, previousCells_;
+  std::string output_;
+  bool hasPresented_{};
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TERMINAL_SCREEN_HPP
@@ -0,0 +1,144 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRACING_SCREEN_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRACING_SCREEN_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "output/screen.hpp"
+#include "util/mapped_file.hpp"
+
+namespace vbag {
+
+/// @brief The commands a render trace is made of, one byte each, followed by
+/// their arguments.
+///
+/// Every argument is stored as it's laid out in memory: floats, colors and
+/// indices take 4 bytes, vertices 12 and lines 28. Lists are preceded by
+/// their length as a 4-byte count. A trace starts with the 8 bytes
+/// "VBAGTRC1" and the width and height of the screen, as 4 bytes each.
+enum class TraceCommand : uint8_t {
+  Clear,                ///< No arguments.
+  DrawLine,             ///< A line.
+  DrawLines,            ///< A count and that many lines.
+  DrawTriangle,         ///< Three vertices and three colors.
+  DrawPoint,            ///< A vertex.
+  DrawTriangles,        ///< A count, that many vertices and as many colors.
+  DrawIndexedTriangles, ///< A vertex count, an index count, the vertices,
+                        ///< their colors and the indices.
+  DrawPoints,           ///< A count and that many vertices.
+  Present               ///< No arguments; ends a frame.
+};
+
+/// @class TracingScreen
+/// @brief A Screen that records every call made to it into a trace file and
+/// passes it on to another screen.
+///
+/// The trace of a frame is kept in memory and written out when the frame is
+/// presented, so tracing costs a copy of the draw calls and a write per
+/// frame. TraceReplayer reads the trace back into any screen, which is how
+/// screens can be benchmarked on their own, without the scene being
+/// processed.
+class TracingScreen : public Screen {
+public:
+  /// @brief Starts recording the calls made to a screen.
+  ///
+  /// @param screen The screen calls are passed on to; it must outlive the
+  /// tracing screen.
+  /// @param path Where the trace is written.
+  /// @throw RuntimeError<CouldNotOpenFile> If the trace can't be created.
+  TracingScreen(Screen &screen, const std::string &path);
+
+  TracingScreen(const TracingScreen &) = delete;
+  TracingScreen &operator=(const TracingScreen &) = delete;
+
+  /// @brief Writes what's left of the trace and closes it.
+  ~TracingScreen() override;
+
+  void clear() override;
+  [[nodiscard]] size_t width() const override;
+  [[nodiscard]] size_t height() const override;
+  void drawLine(const Line &line) override;
+  void drawLines(const Line *lines, size_t n) override;
+  void drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1, D3DCOLOR c2,
+                    D3DCOLOR c3) override;
+  void drawPoint(V3F p) override;
+  void drawTriangles(std::span<const V3F> vertices,
+                     std::span<const D3DCOLOR> colors) override;
+  void drawIndexedTriangles(std::span<const V3F> vertices,
+                            std::span<const D3DCOLOR> colors,
+                            std::span<const uint32_t> indices) override;
+  void drawPoints(std::span<const V3F> points) override;
+
+  /// @brief Presents the frame on the traced screen and writes its trace.
+  ///
+  /// @throw RuntimeError<CouldNotOpenFile> If the trace can't be written.
+  void present() override;
+
+  [[nodiscard]] const float *depth() const override;
+#if defined(_WIN32)
+  [[nodiscard]] HWND window() override;
+#endif
+
+private:
+  void write_(TraceCommand command);
+  void write_(const void *data, size_t size);
+  void writeCount_(size_t count);
+
+  Screen &screen_;
+  std::FILE *file_;
+  std::vector<uint8_t> buffer_;
+};
+
+/// @class TraceReplayer
+/// @brief Plays a trace recorded by a TracingScreen back into a screen, one
+/// frame at a time.
+class TraceReplayer {
+public:
+  /// @brief Opens a trace and finds where each of its frames starts.
+  ///
+  /// @param path The path of the trace.
+  /// @throw RuntimeError<CouldNotOpenFile> If the trace can't be read.
+  /// @throw RuntimeError<MalformedTraceFile> If it isn't a valid trace, cut
+  /// short or with indices past the vertices of their draw call.
+  explicit TraceReplayer(const std::string &path);
+
+  /// @brief Returns the width of the screen the trace was recorded on.
+  [[nodiscard]] size_t width() const;
+
+  /// @brief Returns the height of the screen the trace was recorded on.
+  [[nodiscard]] size_t height() const;
+
+  /// @brief Returns the number of frames in the trace. Calls after the last
+  /// present, if any, aren't part of a frame.
+  [[nodiscard]] size_t frameCount() const;
+
+  /// @brief Makes the calls of a frame on a screen, present included.
+  ///
+  /// @param frame The index of the frame.
+  /// @param screen The screen. It should have the size of the one the trace
+  /// was recorded on, since vertices are in its screen coordinates.
+  void replay(size_t frame, Screen &screen);
+
+private:
+  /// @brief Copies the next bytes of the trace into an object.
+  void read_(const char *&cursor, void *data, size_t size) const;
+
+  /// @brief Reads a count and makes room for that many elements.
+  template <typename T>
+  void readList_(const char *&cursor, std::vector<T> &list) const;
+
+  MappedFile file_;
+  size_t width_{}, height_{};
+  /// @brief Where every frame starts, plus where the last one ends.
+  std::vector<size_t> frames_;
+  std::vector<Line> lines_;
+  std::vector<V3F> vertices_;
+  std::vector<D3DCOLOR> colors_;
+  std::vector<uint32_t> indices_;
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRACING_SCREEN_HPP
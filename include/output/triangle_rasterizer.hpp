@@ -0,0 +1,58 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRIANGLE_RASTERIZER_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRIANGLE_RASTERIZER_HPP
+
+#include <cstdint>
+
+#include "math/vector.hpp"
+
+namespace vbag {
+
+/// @struct RasterTarget
+/// @brief The part of a color and depth buffer pair a triangle may be drawn
+/// into.
+struct RasterTarget {
+  uint32_t *color; ///< The color buffer, row by row, or nullptr to only
+                   ///< draw depth.
+  float *depth;    ///< The depth buffer, laid out like the color buffer.
+  size_t stride;   ///< The number of pixels from one row to the next.
+  long long x0, y0; ///< The first column and row that may be drawn into.
+  long long x1, y1; ///< One past the last column and row that may be drawn
+                    ///< into.
+};
+
+/// @brief The largest distance from the origin, in pixels, that triangle
+/// vertices may have; coordinates are converted to fixed point, which has to
+/// fit in 32-bit integers.
+inline constexpr float maxRasterCoordinate{16384.0f};
+
+/// @brief Draws a Gouraud-shaded triangle with depth testing.
+///
+/// This is a half-space rasterizer. Vertices are snapped to 1/16th of a pixel
+/// and the edge functions are evaluated exactly in integers, following the
+/// top-left fill rule, so triangles that share an edge never overlap nor leave
+/// gaps. The bounding box is walked in blocks of 8 rows (and 8 or 16 columns),
+/// which are skipped when they are outside of an edge and drawn without edge
+/// tests when they are inside of all three. Within a block, as many pixels as
+/// the widest available SIMD registers hold (AVX-512, AVX2, SSE2 or one at a
+/// time) go through coverage, depth and color interpolation, the depth test
+/// and the writes together.
+///
+/// Fragments are drawn if their depth is in [0, 1] and smaller than what the
+/// depth buffer holds.
+///
+/// @param target Where the triangle is drawn. The first column must be a
+/// multiple of 16 and the first row a multiple of 8.
+/// @param vertices The vertices in screen coordinates, x and y in pixels
+/// (y growing downwards) and z in [0, 1]. Their coordinates must not exceed
+/// maxRasterCoordinate. Either winding is fine.
+/// @param colors The colors of the vertices, packed as 0xAABBGGRR.
+void rasterizeTriangle(const RasterTarget &target, const V3F (&vertices)[3],
+                       const uint32_t (&colors)[3]);
+
+/// @brief Returns the name of the instruction set rasterizeTriangle was built
+/// for: "AVX-512", "AVX2", "SSE2" or "scalar".
+[[nodiscard]] const char *rasterizerInstructionSet();
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_OUTPUT_TRIANGLE_RASTERIZER_HPP
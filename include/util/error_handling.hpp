@@ -18,6 +18,11 @@ enum ErrorType {
   ChildIsSameAsParent,              ///< Child is the same as parent.
   ObjectWithSameNameAlreadyInScene, ///< Object with same name already in scene.
   ChildHasSameNameAsParent,         ///< Child has the same name as parent.
+  CouldNotOpenFile,                 ///< Could not open file.
+  UnsupportedMeshFormat,            ///< Unsupported mesh file format.
+  MalformedMeshFile,                ///< Malformed mesh file.
+  UnsupportedImageFormat,           ///< Unsupported image file format.
+  MalformedTraceFile,               ///< Malformed render trace file.
 };
 
 /// @brief Array containing error messages corresponding to ErrorType values.
@@ -32,6 +37,11 @@ static const char *errorMessages[]{
     "Child is same as parent.",
     "Object with same name already in scene.",
     "Child has same name as parent.",
+    "Could not open file.",
+    "Unsupported mesh file format.",
+    "Malformed mesh file.",
+    "Unsupported image file format.",
+    "Malformed render trace file.",
 };
 
 /// @tparam errorType The specific ErrorType value that this RuntimeError
@@ -0,0 +1,141 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_FRAME_ARENA_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_FRAME_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace vbag {
+
+/// @class FrameArena
+/// @brief A linear allocator for data that only lives for a frame.
+///
+/// Allocating bumps a pointer, freeing does nothing, and reset() drops
+/// everything at once. Every thread allocates from a sub-arena of its own, so
+/// threads never contend. A sub-arena that runs out of room takes another
+/// chunk of a block shared by all of them, or allocates one on the heap once
+/// the shared block is used up; on reset, a shared block that was too small
+/// is replaced by one twice as large as the frame wanted. So frames like the
+/// last one fit without touching the heap, however their work is spread over
+/// the threads, while the arena holds room for a frame once rather than once
+/// per thread.
+class FrameArena {
+public:
+  /// @brief Constructs an arena.
+  ///
+  /// @param threads How many sub-arenas there are, one per thread allocating.
+  /// @param blockSize The smallest chunk a sub-arena takes, in bytes.
+  explicit FrameArena(size_t threads = 1, size_t blockSize = 1 << 16);
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /// @brief Drops everything allocated since the last reset.
+  void reset();
+
+  /// @brief Allocates memory from a sub-arena.
+  ///
+  /// @param thread The index of the sub-arena, which no other thread may be
+  /// allocating from.
+  /// @param size The size of the allocation, in bytes.
+  /// @param alignment The alignment of the allocation, a power of two.
+  /// @return The memory, valid until the next reset.
+  [[nodiscard]] void *allocate(size_t thread, size_t size, size_t alignment);
+
+  /// @brief Returns how many sub-arenas there are.
+  [[nodiscard]] size_t threadCount() const;
+
+  /// @brief Returns how many bytes have been allocated since the last reset.
+  [[nodiscard]] size_t bytesUsed() const;
+
+private:
+  /// @brief The chunk a thread allocates from, on a cache line of its own.
+  struct alignas(64) SubArena {
+    std::byte *chunk{};
+    size_t chunkSize{};
+    size_t offset{}; ///< How much of the chunk is used.
+    size_t used{};   ///< How much of the chunks before it is used.
+    /// @brief Chunks that didn't fit in the shared block.
+    std::vector<std::unique_ptr<std::byte[]>> overflow;
+  };
+
+  size_t blockSize_;
+  std::vector<SubArena> subArenas_;
+  std::unique_ptr<std::byte[]> shared_; ///< Where the chunks come from.
+  size_t sharedSize_;
+  std::atomic<size_t> sharedUsed_{}; ///< How much of it was handed out.
+};
+
+/// @tparam T The type of the objects allocated.
+/// @class ArenaAllocator
+/// @brief A standard allocator drawing from a sub-arena of a FrameArena, so
+/// standard containers can hold per-frame data.
+///
+/// A default-constructed allocator uses the heap instead, so containers can
+/// be declared before there's an arena to give them.
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() = default;
+
+  /// @brief Constructs an allocator drawing from a sub-arena.
+  ///
+  /// @param arena The arena.
+  /// @param thread The index of the sub-arena of the thread the container is
+  /// filled on.
+  ArenaAllocator(FrameArena &arena, size_t thread)
+      : arena_{&arena}, thread_{thread} {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other)
+      : arena_{other.arena_}, thread_{other.thread_} {}
+
+  [[nodiscard]] T *allocate(size_t n) {
+    if (!arena_)
+      return std::allocator<T>{}.allocate(n);
+    return static_cast<T *>(arena_->allocate(thread_, n * sizeof(T),
+                                             alignof(T)));
+  }
+
+  void deallocate(T *p, size_t n) {
+    // arena memory is only ever freed by resetting the arena
+    if (!arena_)
+      std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena_ && thread_ == other.thread_;
+  }
+
+private:
+  template <typename U> friend class ArenaAllocator;
+
+  FrameArena *arena_{};
+  size_t thread_{};
+};
+
+/// @brief A vector whose storage comes from a frame arena.
+///
+/// Its storage goes away when the arena is reset, so after that it may only
+/// be destroyed or assigned a new vector.
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/// @brief Returns how many times the global operator new has been called.
+///
+/// Allocations are only counted when the library is built with
+/// VBAG_COUNT_ALLOCATIONS defined, which replaces the global operator new and
+/// delete of the program; otherwise this is always 0.
+///
+/// @return The number of allocations made so far, by every thread.
+[[nodiscard]] size_t allocationCount();
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_FRAME_ARENA_HPP
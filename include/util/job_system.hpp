@@ -0,0 +1,270 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_JOB_SYSTEM_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "util/parallel.hpp"
+
+namespace vbag {
+
+class JobSystem;
+
+/// @class JobCounter
+/// @brief Counts the jobs of a batch that haven't finished yet, so they can
+/// be waited for, or jobs can be made to start after them.
+///
+/// A counter can be reused once it has been waited for. It must outlive the
+/// jobs counted on it and the ones depending on it.
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  /// @brief Returns whether every job counted on the counter has finished.
+  [[nodiscard]] bool done() const;
+
+private:
+  friend class JobSystem;
+
+  struct Job;
+
+  std::atomic<size_t> pending_{};
+  /// @brief Guards the fields below, and the last decrement of pending_, so
+  /// nothing touches the counter once a wait on it has returned.
+  std::mutex mutex_;
+  /// @brief The jobs that start once every job counted here has finished.
+  std::vector<Job *> dependents_;
+  /// @brief The first exception a counted job threw.
+  std::exception_ptr error_;
+};
+
+/// @class JobSystem
+/// @brief A fixed pool of worker threads that run small jobs, balancing them
+/// by work stealing.
+///
+/// Every worker has a deque of its own: it pushes and pops jobs at the
+/// bottom, most recent first, while idle workers steal from the top, so
+/// nested jobs stay on the thread that spawned them until another runs out
+/// of work. Threads that aren't workers submit through a shared queue. Jobs
+/// can be made to wait for the jobs of a counter, and waiting on a counter
+/// runs other jobs in the meantime, so jobs can spawn and wait for jobs of
+/// their own.
+class JobSystem {
+public:
+  /// @brief Starts the worker threads.
+  ///
+  /// @param threads How many threads run jobs, the ones waiting for them
+  /// included; the pool has one fewer workers. 0 means one per hardware
+  /// thread.
+  explicit JobSystem(size_t threads = 0);
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  /// @brief Stops the workers. Jobs that haven't started by then never do,
+  /// so every counter should be waited for first.
+  ~JobSystem();
+
+  /// @brief Returns how many threads run jobs, the waiting one included.
+  [[nodiscard]] size_t threadCount() const;
+
+  /// @brief Returns the index of the calling thread among the ones running
+  /// jobs, for keeping data per thread.
+  ///
+  /// @return The index of the worker plus 1, or 0 for threads that aren't
+  /// workers.
+  [[nodiscard]] size_t threadIndex() const;
+
+  /// @brief Queues a job.
+  ///
+  /// @param job The job.
+  /// @param counter The counter the job is counted on until it finishes.
+  void run(std::function<void()> job, JobCounter &counter);
+
+  /// @brief Queues a job that starts once every job of another counter has
+  /// finished.
+  ///
+  /// @param job The job.
+  /// @param counter The counter the job is counted on until it finishes.
+  /// @param dependency The counter whose jobs have to finish first.
+  void run(std::function<void()> job, JobCounter &counter,
+           JobCounter &dependency);
+
+  /// @brief Runs jobs until every job counted on a counter has finished.
+  ///
+  /// @param counter The counter.
+  /// @throw The first exception a counted job threw, if any.
+  void wait(JobCounter &counter);
+
+  /// @brief Returns how many chunks a workload should be split into, so
+  /// there are a few per thread to balance, without making chunks smaller
+  /// than a minimum size.
+  ///
+  /// @param items The number of items in the workload.
+  /// @param minChunkSize The smallest amount of items worth a chunk of its
+  /// own.
+  /// @return The number of chunks, at least 1.
+  [[nodiscard]] size_t chunkCount(size_t items, size_t minChunkSize = 1) const;
+
+  /// @tparam F The type of the callable, taking the index of a chunk.
+  /// @brief Calls a function once for every chunk index, as jobs, and waits
+  /// for all of them to finish.
+  ///
+  /// The first chunk runs on the calling thread. If any call throws, the
+  /// exception of the first chunk is rethrown once they are all done, or else
+  /// the first one thrown.
+  ///
+  /// @param chunks The number of chunks.
+  /// @param body The function to be called for each chunk index.
+  template <typename F> void parallelFor(size_t chunks, F &&body);
+
+  /// @brief Allocates jobs for the pool until there are as many as were
+  /// queued since the last call.
+  ///
+  /// How many jobs are pooled otherwise depends on how many happened to be
+  /// running at once; called after every frame, it makes a frame like the
+  /// last one never allocate jobs, however they get scheduled.
+  void reserveJobs();
+
+  /// @tparam T The type of the items.
+  /// @tparam F The type of the callable, taking a chunk of the items and the
+  /// index of its first item.
+  /// @brief Splits a span into contiguous chunks and calls a function on each
+  /// of them, as jobs, and waits for all of them to finish.
+  ///
+  /// @param items The items.
+  /// @param minChunkSize The smallest amount of items worth a chunk of its
+  /// own.
+  /// @param body The function to be called for each chunk.
+  template <typename T, typename F>
+  void parallelFor(std::span<T> items, size_t minChunkSize, F &&body);
+
+private:
+  using Job = JobCounter::Job;
+
+  /// @brief A fixed-size Chase-Lev deque of jobs.
+  class WorkDeque {
+  public:
+    /// @brief Pushes a job at the bottom. Only the owner may push.
+    ///
+    /// @return False if the deque is full.
+    bool push(Job *job);
+
+    /// @brief Pops the job at the bottom. Only the owner may pop.
+    Job *pop();
+
+    /// @brief Takes the job at the top, from any thread.
+    Job *steal();
+
+  private:
+    static constexpr int64_t capacity_{4096};
+
+    std::atomic<int64_t> top_{}, bottom_{};
+    std::unique_ptr<std::atomic<Job *>[]> jobs_{
+        new std::atomic<Job *>[capacity_]};
+  };
+
+  struct Worker {
+    JobSystem *system;
+    size_t index;
+    WorkDeque deque;
+  };
+
+  /// @brief Takes a job from the pool of finished ones, or allocates one if
+  /// there's none.
+  Job *acquire_(std::function<void()> body, JobCounter &counter);
+
+  /// @brief Returns a finished job to the pool, so steady workloads don't
+  /// allocate.
+  void release_(Job *job);
+
+  /// @brief Queues a job whose dependencies have finished.
+  void push_(Job *job);
+
+  /// @brief Takes a job from the deque of the calling thread, the shared
+  /// queue or another worker, in that order.
+  Job *find_();
+
+  /// @brief Runs a job, counts it as finished and releases its dependents.
+  void execute_(Job *job);
+
+  void workerLoop_(Worker &worker);
+
+  /// @brief Returns the worker the calling thread is, if it's one of ours.
+  Worker *currentWorker_() const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  /// @brief The jobs submitted by threads that aren't workers, or that didn't
+  /// fit in a deque, as a linked list so queueing them never allocates.
+  Job *sharedFront_{}, *sharedBack_{};
+  std::mutex sharedMutex_;
+  /// @brief How many jobs are queued, for workers to know when to sleep.
+  std::atomic<size_t> queued_{};
+  std::atomic<size_t> sleeping_{};
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> stopping_{};
+  Job *freeJobs_{}; ///< The pool of finished jobs, as a linked list.
+  size_t jobCount_{};   ///< How many jobs have been allocated.
+  size_t jobsQueued_{}; ///< How many were queued since the last reserveJobs.
+  std::mutex freeJobsMutex_; ///< Guards the pool and its counts.
+};
+
+struct JobCounter::Job {
+  std::function<void()> body;
+  JobCounter *counter;
+  Job *next; ///< The next job in the shared queue or the pool.
+};
+
+template <typename F> void JobSystem::parallelFor(size_t chunks, F &&body) {
+  if (chunks == 0)
+    return;
+  if (chunks == 1) {
+    body(size_t{0});
+    return;
+  }
+  JobCounter counter;
+  for (size_t chunk{1}; chunk < chunks; ++chunk)
+    run([&body, chunk] { body(chunk); }, counter);
+  std::exception_ptr error;
+  try {
+    body(size_t{0});
+  } catch (...) {
+    error = std::current_exception();
+  }
+  // the other chunks still refer to the body, so they're waited for either way
+  try {
+    wait(counter);
+  } catch (...) {
+    if (!error)
+      error = std::current_exception();
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+template <typename T, typename F>
+void JobSystem::parallelFor(std::span<T> items, size_t minChunkSize,
+                            F &&body) {
+  const auto chunks{chunkCount(items.size(), minChunkSize)};
+  parallelFor(chunks, [&](size_t chunk) {
+    const auto [begin, end]{chunkRange(items.size(), chunks, chunk)};
+    body(items.subspan(begin, end - begin), begin);
+  });
+}
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_JOB_SYSTEM_HPP
@@ -0,0 +1,50 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_MAPPED_FILE_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace vbag {
+
+/// @class MappedFile
+/// @brief A read-only view of a whole file mapped into memory.
+///
+/// The file is mapped with mmap on POSIX systems and with a file mapping on
+/// Windows, so its contents are paged in on demand instead of being copied
+/// into a buffer up front.
+class MappedFile {
+public:
+  /// @brief Maps the file at the given path.
+  ///
+  /// @param path The path of the file to be mapped.
+  /// @throw CouldNotOpenFile if the file can't be opened or mapped.
+  explicit MappedFile(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// @brief Unmaps the file.
+  ~MappedFile();
+
+  /// @brief Returns a pointer to the first byte of the file.
+  ///
+  /// @return A pointer to the contents, or null for an empty file.
+  [[nodiscard]] const char *data() const { return data_; }
+
+  /// @brief Returns the size of the file in bytes.
+  ///
+  /// @return The size of the file.
+  [[nodiscard]] size_t size() const { return size_; }
+
+private:
+  const char *data_{}; ///< The start of the mapping.
+  size_t size_{};      ///< The size of the mapping.
+#if defined(_WIN32)
+  void *file_{};    ///< The handle of the file.
+  void *mapping_{}; ///< The handle of the file mapping.
+#endif
+};
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_MAPPED_FILE_HPP
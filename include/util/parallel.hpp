@@ -0,0 +1,73 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PARALLEL_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PARALLEL_HPP
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vbag {
+
+/// @brief Returns how many chunks a workload of the given size should be split
+/// into so that every hardware thread gets one, without making chunks smaller
+/// than a minimum size.
+///
+/// @param items The number of items in the workload.
+/// @param minChunkSize The smallest amount of items worth a chunk of its own.
+/// @return The number of chunks, at least 1.
+inline size_t chunkCount(size_t items, size_t minChunkSize = 1) {
+  const size_t threads{(std::max)(1u, std::thread::hardware_concurrency())};
+  minChunkSize = (std::max)(minChunkSize, size_t{1});
+  const auto chunks{(items + minChunkSize - 1) / minChunkSize};
+  return (std::max)(size_t{1}, (std::min)(threads, chunks));
+}
+
+/// @brief Returns the range of items covered by one chunk of a workload split
+/// into contiguous, nearly equal chunks.
+///
+/// @param items The number of items in the workload.
+/// @param chunks The number of chunks the workload is split into.
+/// @param chunk The index of the chunk.
+/// @return The [begin, end) range of the chunk.
+inline std::pair<size_t, size_t> chunkRange(size_t items, size_t chunks,
+                                            size_t chunk) {
+  return {items * chunk / chunks, items * (chunk + 1) / chunks};
+}
+
+/// @tparam F The type of the callable, taking the index of a chunk.
+/// @brief Calls a function once for every chunk index, each call on its own
+/// thread, and waits for all of them to finish.
+///
+/// The first chunk runs on the calling thread. If any call throws, the
+/// exception of the lowest-indexed chunk that threw is rethrown once they are
+/// all done.
+///
+/// @param chunks The number of chunks.
+/// @param body The function to be called for each chunk index.
+template <typename F> void parallelFor(size_t chunks, F &&body) {
+  if (chunks == 0)
+    return;
+  std::vector<std::exception_ptr> errors(chunks);
+  auto run{[&](size_t chunk) {
+    try {
+      body(chunk);
+    } catch (...) {
+      errors[chunk] = std::current_exception();
+    }
+  }};
+  std::vector<std::thread> threads;
+  threads.reserve(chunks - 1);
+  for (size_t chunk{1}; chunk < chunks; ++chunk)
+    threads.emplace_back(run, chunk);
+  run(0);
+  for (auto &thread : threads)
+    thread.join();
+  for (auto &error : errors)
+    if (error)
+      std::rethrow_exception(error);
+}
+
+} // namespace vbag
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PARALLEL_HPP
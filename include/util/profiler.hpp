@@ -0,0 +1,199 @@
+#ifndef VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PROFILER_HPP
+#define VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define VBAG_PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VBAG_PROFILER_RDTSC
+#endif
+
+namespace vbag {
+
+/// @class Profiler
+/// @brief Collects timed zones from every thread, to find out where the time
+/// of a frame goes.
+///
+/// Zones are recorded when they end, into a ring buffer of the thread they
+/// ran on, without taking any locks; once a ring is full, its oldest zones
+/// are overwritten. Timestamps come from the time stamp counter on x86 and
+/// from steady_clock elsewhere. What was recorded can be written out as a
+/// Chrome trace, for chrome://tracing or Perfetto, or summed up for the last
+/// frame.
+///
+/// Zones are placed with VBAG_PROFILE_ZONE and frames are marked with
+/// VBAG_PROFILE_FRAME, both of which compile to nothing unless VBAG_PROFILE
+/// is defined.
+class Profiler {
+public:
+  /// @brief A zone that has ended.
+  struct Zone {
+    const char *name;
+    uint64_t start, end; ///< In nanoseconds since the profiler started.
+    uint32_t thread;     ///< The order the thread first recorded a zone in.
+    uint32_t depth;      ///< How many zones of the thread it's nested in.
+  };
+
+  /// @brief How many zones every thread keeps.
+  static constexpr size_t capacity{1 << 16};
+
+  /// @brief The name of the zones that span whole frames.
+  static constexpr const char *frameName{"frame"};
+
+  /// @brief Returns the profiler of the program.
+  static Profiler &instance();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  /// @brief Returns the current timestamp, in ticks of the profiler's clock.
+  [[nodiscard]] static uint64_t now() {
+#if defined(VBAG_PROFILER_RDTSC)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+#endif
+  }
+
+  /// @brief Records a zone that has ended on the calling thread.
+  ///
+  /// @param name The name of the zone, which must outlive the profiler; a
+  /// string literal, usually.
+  /// @param start When the zone started, as returned by now().
+  /// @param end When the zone ended, as returned by now().
+  /// @param depth How many zones of the thread it's nested in.
+  void record(const char *name, uint64_t start, uint64_t end,
+              uint32_t depth) {
+    auto &ring{ring_()};
+    const auto head{ring.head.load(std::memory_order_relaxed)};
+    auto &slot{ring.slots[head & (capacity - 1)]};
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.depth.store(depth, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+  }
+
+  /// @brief Ends the current frame and starts the next one, recording the
+  /// one that ended as a zone named frameName.
+  void markFrame();
+
+  /// @brief Returns the zones every thread still keeps, by start time.
+  ///
+  /// Threads can keep recording meanwhile; zones they overwrite while being
+  /// read are left out.
+  [[nodiscard]] std::vector<Zone> zones() const;
+
+  /// @brief Writes the zones every thread still keeps as a Chrome trace, in
+  /// the trace_event JSON format.
+  ///
+  /// @param path Where the trace is written.
+  /// @throw RuntimeError<CouldNotOpenFile> If the file can't be written.
+  void writeChromeTrace(const std::string &path) const;
+
+  /// @brief Sums up the zones of the last frame that ended, for every name:
+  /// how many times it ran, on any thread, and for how long.
+  ///
+  /// @return A table, one line per name, sorted by total time; empty if no
+  /// frame has ended yet.
+  [[nodiscard]] std::string frameSummary() const;
+
+private:
+  Profiler();
+
+  /// @brief A zone in a ring; atomic, so it can be read while overwritten.
+  struct Slot {
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> start, end;
+    std::atomic<uint32_t> depth;
+  };
+
+  /// @brief The zones of a thread. Only the thread writes to it.
+  struct Ring {
+    uint32_t thread;
+    std::atomic<uint64_t> head; ///< How many zones were ever recorded.
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  /// @brief Returns the ring of the calling thread, creating it first if
+  /// this is the first zone of the thread.
+  Ring &ring_() {
+    thread_local Ring *ring{};
+    if (!ring)
+      ring = &addRing_();
+    return *ring;
+  }
+
+  Ring &addRing_();
+
+  /// @brief Converts a timestamp into nanoseconds since the profiler
+  /// started.
+  [[nodiscard]] uint64_t toNanoseconds_(uint64_t ticks,
+                                        double ticksPerNanosecond) const;
+
+  /// @brief Measures how fast the profiler's clock ticks.
+  [[nodiscard]] double ticksPerNanosecond_() const;
+
+  uint64_t startTicks_;
+  std::chrono::steady_clock::time_point startTime_;
+  std::atomic<uint64_t> frameStart_{}; ///< When the current frame started.
+  mutable std::mutex ringsMutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+/// @class ProfileZone
+/// @brief Times the scope it's declared in, as a zone of the profiler.
+class ProfileZone {
+public:
+  /// @brief Starts the zone.
+  ///
+  /// @param name The name of the zone; a string literal, usually.
+  explicit ProfileZone(const char *name)
+      : name_{name}, depth_{openZones_++}, start_{Profiler::now()} {}
+
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+
+  /// @brief Ends the zone and records it.
+  ~ProfileZone() {
+    Profiler::instance().record(name_, start_, Profiler::now(), depth_);
+    --openZones_;
+  }
+
+private:
+  /// @brief How many zones are open on the calling thread.
+  static inline thread_local uint32_t openZones_{};
+
+  const char *name_;
+  uint32_t depth_;
+  uint64_t start_;
+};
+
+} // namespace vbag
+
+#define VBAG_PROFILE_CONCAT_(a, b) a##b
+#define VBAG_PROFILE_CONCAT(a, b) VBAG_PROFILE_CONCAT_(a, b)
+
+#if defined(VBAG_PROFILE)
+/// @brief Times the rest of the enclosing scope as a zone of the profiler.
+#define VBAG_PROFILE_ZONE(name)                                                \
+  ::vbag::ProfileZone VBAG_PROFILE_CONCAT(vbagProfileZone, __LINE__) { name }
+/// @brief Ends the current frame of the profiler and starts the next one.
+#define VBAG_PROFILE_FRAME() ::vbag::Profiler::instance().markFrame()
+#else
+#define VBAG_PROFILE_ZONE(name) static_cast<void>(0)
+#define VBAG_PROFILE_FRAME() static_cast<void>(0)
+#endif
+
+#endif // VERY_BASIC_ASCII_GRAPHICS_API_INCLUDE_UTIL_PROFILER_HPP
@@ -1,14 +1,24 @@
 #include "animation/animation_engine.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <chrono>
+#include <thread>
 #include <utility>
 
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "graphics/clipping.hpp"
 #include "graphics/light.hpp"
 #include "graphics/triangle_mesh.hpp"
 #include "util/math.hpp"
+#include "util/profiler.hpp"
 
 namespace vbag {
 
+#if defined(ENABLE_LIGHTING)
 static auto operator*(const M4F &matrix, const V3F &vector) {
   Matrix<float, 4, 1> extended{vector.x, vector.y, vector.z, 1};
   auto result{matrix * extended};
@@ -17,56 +27,141 @@ static auto operator*(const M4F &matrix, const V3F &vector) {
     den = 1.0f;
   return V3F{result.data[0], result.data[1], result.data[2]} / den;
 }
+#endif
+
+namespace {
+
+/// @brief The fewest vertices worth transforming in a job of their own.
+constexpr size_t minVertexChunkSize{8192};
+
+/// @brief The fewest triangles worth clipping in a job of their own.
+constexpr size_t minTriangleChunkSize{4096};
+
+} // namespace
+
+EngineCore::EngineCore(Screen &screen, Scene scene, float frameRate,
+                       size_t threads)
+    : screen_{screen}, scene_{std::move(scene)}, frameRate_{frameRate},
+      jobs_{threads}, arena_{jobs_.threadCount()}, limiter_{frameRate},
+      threadStats_(jobs_.threadCount()) {}
+
+EngineCore::~EngineCore() {
+  {
+    std::lock_guard lock{pipelineMutex_};
+    stopPresenting_ = true;
+  }
+  pipelineChanged_.notify_all();
+  if (presenter_.joinable())
+    presenter_.join();
+}
 
-Engine::Engine(Screen &screen, RenderFunc setup, RenderFunc loop, Scene scene,
-               float frameRate)
-    : screen_{screen}, scene_{std::move(scene)}, setup_{std::move(setup)},
-      loop_{std::move(loop)}, frameRate_{frameRate} {}
+void EngineCore::MeshChunk::reset(
+    const ArenaAllocator<std::byte> &allocator) {
+  // the old storage went with the last reset of the arena, so the vectors
+  // are replaced rather than cleared
+  vertices = ArenaVector<V3F>{allocator};
+  colors = ArenaVector<D3DCOLOR>{allocator};
+}
 
-void Engine::queueGraph(const GV3F *g, std::vector<Line> &dst) {
+void EngineCore::DrawList::reset(const ArenaAllocator<std::byte> &allocator) {
+  lines = ArenaVector<Line>{allocator};
+  faces = ArenaVector<V3F>{allocator};
+  clipped = ArenaVector<V4F>{allocator};
+  outcodes = ArenaVector<uint8_t>{allocator};
+  triangles.reset(allocator);
+}
+
+void EngineCore::queueGraph(const GV3F *g, std::vector<Line> &dst) {
+  directList_.reset(frameAllocator_());
+  queueGraph_(g, directList_);
+  dst.insert(dst.end(), directList_.lines.begin(), directList_.lines.end());
+  keepDirect_();
+}
+
+void EngineCore::queueGraph_(const GV3F *g, DrawList &list) const {
+  VBAG_PROFILE_ZONE("queueGraph");
   auto mainCamera{scene_.mainCamera()};
   if (!mainCamera)
     throw RuntimeError<SceneHasNoMainCameraSelected>{};
   const auto mvp{mainCamera->perspective() * mainCamera->worldToCamera() *
                  g->transform()};
+  const D3DCOLOR color{g->color()};
+  auto &clipped{list.clipped};
+  clipped.resize(g->order());
+  for (size_t i{}; i < g->order(); ++i)
+    clipped[i] = toClipSpace_(mvp, g->vertices()[i]);
+  size_t dropped{};
+  if (hiddenLineRemoval_) {
+    for (const auto &face : g->faces()) {
+      const ClipVertex corners[3]{{clipped[face.v1], color},
+                                  {clipped[face.v2], color},
+                                  {clipped[face.v3], color}};
+      clipHiddenLineFace_(corners, list.faces);
+    }
+  }
   for (size_t i{}; i < g->order(); ++i) {
-    auto a = mvp * g->vertices()[i];
     for (auto elem : g->edges(i)) {
-      auto aa{a}, b = mvp * g->vertices()[elem];
-      aa.x *= float(screen_.width());
-      aa.y *= float(screen_.height());
-      b.x *= float(screen_.width());
-      b.y *= float(screen_.height());
-
-      aa.x += float(screen_.width()) / 2;
-      aa.y = float(screen_.height()) / 2 - aa.y;
-      b.x += float(screen_.width()) / 2;
-      b.y = float(screen_.height()) / 2 - b.y;
-
-      if (aa.z <= 0 && b.z <= 0) // for clipping. this is ridiculous
-        dst.push_back({aa, b, g->color()});
+      // edges are stored in the adjacency lists of both of their vertices
+      if (elem < i)
+        continue;
+      ClipVertex a{clipped[i], color}, b{clipped[elem], color};
+      if (!(viewOutcode(a.position) & viewOutcode(b.position)) &&
+          clipLine(a, b))
+        list.lines.push_back(
+            {toScreen_(a.position), toScreen_(b.position), color});
+      else
+        ++dropped;
     }
   }
+  auto &stats{counters_()};
+  stats.verticesTransformed += g->order();
+  stats.linesClipped += dropped;
+}
+
+void EngineCore::drawMesh(const TriangleMesh *mesh) {
+  directList_.reset(frameAllocator_());
+  drawMesh_(viewOf_(mesh), directList_);
+  keepDirect_();
+}
+
+ArenaAllocator<std::byte> EngineCore::frameAllocator_() {
+  return {arena_, jobs_.threadIndex()};
+}
+
+EngineCore::MeshView EngineCore::viewOf_(const TriangleMesh *mesh) {
+  return {mesh, mesh->vertices(), mesh->normals(), mesh->triangles()};
+}
+
+EngineCore::MeshView
+EngineCore::triangulate_(const QuadMesh *mesh,
+                     ArenaVector<TriangleMesh::Triangle> &triangles) {
+  triangles.reserve(2 * mesh->faces().size());
+  for (const auto &quad : mesh->faces()) {
+    triangles.push_back({quad.v1, quad.v2, quad.v3});
+    triangles.push_back({quad.v1, quad.v3, quad.v4});
+  }
+  return {mesh, mesh->vertices(), mesh->normals(), triangles};
 }
 
-void Engine::drawMesh(const TriangleMesh *mesh) {
+void EngineCore::drawMesh_(const MeshView &mesh, DrawList &list) {
+  VBAG_PROFILE_ZONE("drawMesh");
   auto mainCamera{scene_.mainCamera()};
   if (!mainCamera)
     throw RuntimeError<SceneHasNoMainCameraSelected>{};
   const auto mvp{mainCamera->perspective() * mainCamera->worldToCamera() *
-                 mesh->transform()};
+                 mesh.object->transform()};
+  ArenaVector<D3DCOLOR> colors{frameAllocator_()};
   // FIXME: something's wrong with the lighting
 #if defined(ENABLE_LIGHTING)
-  std::vector<D3DCOLOR> colors;
-  for (size_t i{}; i < mesh->vertices().size(); ++i) {
+  for (size_t i{}; i < mesh.vertices.size(); ++i) {
     float finalIntensity{};
     for (auto &[_, object] : scene_) {
       auto lightPointer{dynamic_cast<PointLight *>(object)};
       if (!lightPointer)
         continue;
       auto lightPos{mvp * lightPointer->transform().translation()},
-          vertexPos{mvp * mesh->vertices()[i]},
-          vertexNormal{mvp.transposeOfInverse() * mesh->normals()[i]};
+          vertexPos{mvp * mesh.vertices[i]},
+          vertexNormal{mvp.transposeOfInverse() * mesh.normals[i]};
       auto dot{(vertexPos - lightPos).dot(vertexNormal)};
       finalIntensity += 255.0f * lightPointer->intensity() * fabsf(dot);
     }
@@ -75,98 +170,599 @@ void Engine::drawMesh(const TriangleMesh *mesh) {
     colors.emplace_back(D3DCOLOR_XRGB(intEnsity, intEnsity, intEnsity));
   }
 #endif
-  for (auto triangle : mesh->triangles()) {
-    auto v1{mvp * mesh->vertices()[triangle.v1]},
-        v2{mvp * mesh->vertices()[triangle.v2]},
-        v3{mvp * mesh->vertices()[triangle.v3]};
-    // TODO: actually learn shaders and let the GPU do this
-    v1.x *= float(screen_.width());
-    v1.y *= float(screen_.height());
-    v2.x *= float(screen_.width());
-    v2.y *= float(screen_.height());
-    v3.x *= float(screen_.width());
-    v3.y *= float(screen_.height());
+  // every vertex is shared by several triangles, so they're all transformed
+  // up front instead of once per triangle
+  counters_().verticesTransformed += mesh.vertices.size();
+  list.clipped.resize(mesh.vertices.size());
+  list.outcodes.resize(list.clipped.size());
+  jobs_.parallelFor(mesh.vertices, minVertexChunkSize,
+                    [&](std::span<const V3F> vertices, size_t first) {
+                      for (size_t i{}; i < vertices.size(); ++i) {
+                        list.clipped[first + i] =
+                            toClipSpace_(mvp, vertices[i]);
+                        list.outcodes[first + i] =
+                            viewOutcode(list.clipped[first + i]);
+                      }
+                    });
+  auto &triangles{list.triangles};
+  const auto triangleCount{mesh.triangles.size()};
+  const auto chunks{jobs_.chunkCount(triangleCount, minTriangleChunkSize)};
+  if (chunks == 1) {
+    emitTriangles_(mesh, list, 0, triangleCount, colors, triangles);
+  } else {
+    // every chunk emits into a list of its own, which are then joined in
+    // order, so the packet is the same however the chunks were scheduled
+    if (list.chunks.size() < chunks)
+      list.chunks.resize(chunks);
+    jobs_.parallelFor(chunks, [&](size_t chunk) {
+      const auto [begin, end]{chunkRange(triangleCount, chunks, chunk)};
+      auto &out{list.chunks[chunk]};
+      out.reset(frameAllocator_());
+      emitTriangles_(mesh, list, begin, end, colors, out);
+    });
+    for (size_t chunk{}; chunk < chunks; ++chunk) {
+      const auto &out{list.chunks[chunk]};
+      triangles.vertices.insert(triangles.vertices.end(),
+                                out.vertices.begin(), out.vertices.end());
+      triangles.colors.insert(triangles.colors.end(), out.colors.begin(),
+                              out.colors.end());
+    }
+  }
+  if (hiddenLineRemoval_)
+    list.faces.insert(list.faces.end(), triangles.vertices.begin(),
+                      triangles.vertices.end());
+}
+
+void EngineCore::emitTriangles_(
+    const MeshView &mesh, const DrawList &list, size_t begin, size_t end,
+    [[maybe_unused]] std::span<const D3DCOLOR> vertexColors,
+    MeshChunk &out) const {
+  const auto &clipped{list.clipped};
+  const auto &outcodes{list.outcodes};
+  size_t dropped{}, backFacing{};
+  for (auto i{begin}; i < end; ++i) {
+    const auto &triangle{mesh.triangles[i]};
+    if (outcodes[triangle.v1] & outcodes[triangle.v2] &
+        outcodes[triangle.v3]) {
+      ++dropped;
+      continue;
+    }
 #if defined(ENABLE_LIGHTING)
-    auto c1{colors[triangle.v1]}, c2{colors[triangle.v2]},
-        c3{colors[triangle.v3]};
+    auto c1{vertexColors[triangle.v1]}, c2{vertexColors[triangle.v2]},
+        c3{vertexColors[triangle.v3]};
 #else
     auto c1{D3DCOLOR_XRGB(255, 0, 0)}, c2{D3DCOLOR_XRGB(0, 255, 0)},
         c3{D3DCOLOR_XRGB(0, 0, 255)};
 #endif
-    v1.x += float(screen_.width()) / 2;
-    v1.y = float(screen_.height()) / 2 - v1.y;
-    v2.x += float(screen_.width()) / 2;
-    v2.y = float(screen_.height()) / 2 - v2.y;
-    v3.x += float(screen_.width()) / 2;
-    v3.y = float(screen_.height()) / 2 - v3.y;
-    // when the y coords are flipped, the normal is also flipped, so we just
-    // change the order in which we pass them ahead and we're good (could also
-    // use a D3DRS_CULLMODE to change the backface culling method to CCW)
-    if (v1.z <= 0 && v2.z <= 0 && v3.z <= 0) // for clipping. this is ridiculous
-      screen_.drawTriangle(v3, v2, v1, c3, c2, c1);
-  }
-}
-
-void Engine::drawQuadMesh(const QuadMesh *mesh) {
-  auto triangleMesh{mesh->asTriangleMesh()};
-  drawMesh(&triangleMesh);
-}
-
-void Engine::draw() {
-  std::vector<Line> lines;
-  for (auto &[_, object] : scene_) {
-    // cameras and lights are not drawn, so checking them here is dumb
-    if (auto graphPointer{dynamic_cast<GV3F *>(object)}) {
-      queueGraph(graphPointer, lines);
+    const ClipVertex corners[3]{{clipped[triangle.v1], c1},
+                                {clipped[triangle.v2], c2},
+                                {clipped[triangle.v3], c3}};
+    ClipVertex polygon[maxClippedVertices];
+    const auto count{clipTriangle(corners, polygon)};
+    if (count < 3) {
+      ++dropped;
       continue;
     }
-    if (auto triangleMeshPointer{dynamic_cast<TriangleMesh *>(object)}) {
-      drawMesh(triangleMeshPointer);
+    V3F screenPolygon[maxClippedVertices];
+    for (size_t j{}; j < count; ++j)
+      screenPolygon[j] = toScreen_(polygon[j].position);
+    // the polygon is convex and planar, so all of its fan triangles face the
+    // same way
+    if (backfaceCulling_ && !isFrontFacing_(screenPolygon, count)) {
+      ++backFacing;
       continue;
     }
-    if (auto quadMeshPointer{dynamic_cast<QuadMesh *>(object)}) {
-      drawQuadMesh(quadMeshPointer);
+    for (size_t j{1}; j + 1 < count; ++j) {
+      const auto &v1{screenPolygon[0]}, &v2{screenPolygon[j]},
+          &v3{screenPolygon[j + 1]};
+      // when the y coords are flipped, the normal is also flipped, so we just
+      // change the order in which we pass them ahead and we're good (could
+      // also use a D3DRS_CULLMODE to change the backface culling method to
+      // CCW)
+      out.vertices.insert(out.vertices.end(), {v3, v2, v1});
+      out.colors.insert(out.colors.end(), {polygon[j + 1].color,
+                                           polygon[j].color,
+                                           polygon[0].color});
+    }
+  }
+  auto &stats{counters_()};
+  stats.trianglesClipped += dropped;
+  stats.trianglesBackFacing += backFacing;
+}
+
+void EngineCore::drawQuadMesh(const QuadMesh *mesh) {
+  directList_.reset(frameAllocator_());
+  ArenaVector<TriangleMesh::Triangle> triangles{frameAllocator_()};
+  drawMesh_(triangulate_(mesh, triangles), directList_);
+  keepDirect_();
+}
+
+void EngineCore::drawObject_(Object *object, DrawList &list) {
+  list.reset(frameAllocator_());
+  auto &stats{counters_()};
+  // counts the object as visited, and as either culled or drawn
+  const auto count{[](ObjectStats &objects, bool culled) {
+    ++objects.visited;
+    ++(culled ? objects.culled : objects.drawn);
+    return !culled;
+  }};
+  // cameras and lights are not drawn, so checking them here is dumb
+  // through const pointers, so looking at the vertices doesn't throw away
+  // the bounds they have cached
+  if (auto graphPointer{dynamic_cast<const GV3F *>(object)}) {
+    if (count(stats.graphs,
+              isCulled_(graphPointer, graphPointer->bounds())))
+      queueGraph_(graphPointer, list);
+    return;
+  }
+  if (auto triangleMeshPointer{dynamic_cast<const TriangleMesh *>(object)}) {
+    if (count(stats.triangleMeshes,
+              isCulled_(triangleMeshPointer, triangleMeshPointer->bounds())))
+      drawMesh_(viewOf_(triangleMeshPointer), list);
+    return;
+  }
+  if (auto quadMeshPointer{dynamic_cast<const QuadMesh *>(object)}) {
+    if (count(stats.quadMeshes,
+              isCulled_(quadMeshPointer, quadMeshPointer->bounds()))) {
+      ArenaVector<TriangleMesh::Triangle> triangles{frameAllocator_()};
+      drawMesh_(triangulate_(quadMeshPointer, triangles), list);
+    }
+    return;
+  }
+  ++stats.otherObjects;
+}
+
+void EngineCore::draw() {
+  // recording rewrites frameStats_, so it has to be done before it's copied
+  const auto submission{draw_()};
+  addFrameStats_(frameStats_, submission);
+}
+
+CommandBuffer::Submission EngineCore::draw_() {
+  VBAG_PROFILE_ZONE("draw");
+  flush_();
+  record_();
+  VBAG_PROFILE_ZONE("execute");
+  return commands_.execute(screen_);
+}
+
+void EngineCore::record_() {
+  VBAG_PROFILE_ZONE("record");
+  arena_.reset();
+  commands_.clear();
+  // what setup and loop functions drew directly goes first
+  commands_.append(directCommands_);
+  directCommands_.clear();
+  buildOcclusion_();
+  if (hiddenLineRemoval_) {
+    hiddenLines_.reset(screen_.width(), screen_.height());
+    for (size_t i{}; i + 2 < directFaces_.size(); i += 3)
+      hiddenLines_.drawFace(
+          {directFaces_[i], directFaces_[i + 1], directFaces_[i + 2]});
+  }
+  directFaces_.clear();
+  objects_.clear();
+  for (auto &[_, object] : scene_)
+    objects_.push_back(object);
+  if (drawLists_.size() < objects_.size())
+    drawLists_.resize(objects_.size());
+  jobs_.parallelFor(std::span{objects_}, 1,
+                    [&](std::span<Object *> objects, size_t first) {
+                      for (size_t i{}; i < objects.size(); ++i)
+                        drawObject_(objects[i], drawLists_[first + i]);
+                    });
+  ArenaVector<Line> lines{frameAllocator_()};
+  for (size_t i{}; i < objects_.size(); ++i) {
+    const auto &list{drawLists_[i]};
+    lines.insert(lines.end(), list.lines.begin(), list.lines.end());
+    mergeList_(list);
+  }
+  if (hiddenLineRemoval_) {
+    // every face is in the prepass by now
+    ArenaVector<Line> visible{frameAllocator_()};
+    hiddenLines_.appendVisible(lines, visible, jobs_, arena_);
+    lines.swap(visible);
+  }
+  commands_.drawLines(lines);
+  jobs_.reserveJobs();
+  frameStats_ = {};
+  // the counters start over here rather than as recording starts, so what
+  // direct calls counted since then goes to this frame
+  for (auto &threadStats : threadStats_)
+    frameStats_ += std::exchange(threadStats.stats, {});
+}
+
+void EngineCore::countFrameAllocations_() {
+  frameAllocations_ = allocationCount() - renderAllocationStart_;
+  frameStats_.allocations = frameAllocations_;
+  frameStats_.updateAllocations = updateAllocations_;
+#if defined(VBAG_COUNT_ALLOCATIONS) && !defined(NDEBUG)
+  // once the storage kept between frames has settled, whatever rendering the
+  // frame allocates should have come from the arena; the update runs code
+  // of the user's, which allocates as it likes
+  assert(frameAllocations_ == 0 || warmupFrames_ > 0);
+#endif
+  if (warmupFrames_ > 0)
+    --warmupFrames_;
+}
+
+void EngineCore::setBackfaceCulling(bool enabled) {
+  backfaceCulling_ = enabled;
+}
+
+bool EngineCore::backfaceCulling() const { return backfaceCulling_; }
+
+void EngineCore::setOcclusionCulling(OcclusionCulling mode) {
+  occlusionCulling_ = mode;
+  warmupFrames_ = pipelineDepth_ + 1;
+}
+
+OcclusionCulling EngineCore::occlusionCulling() const {
+  return occlusionCulling_;
+}
+
+void EngineCore::setPipelineDepth(size_t depth) {
+  depth = std::clamp(depth, size_t{1}, size_t{3});
+  flush_();
+  std::lock_guard lock{pipelineMutex_};
+  pipelineDepth_ = depth;
+  warmupFrames_ = pipelineDepth_ + 1;
+  pipeline_.resize(depth - 1);
+  firstPipelined_ = 0;
+  hasPresentedHiZ_ = false;
+}
+
+size_t EngineCore::pipelineDepth() const { return pipelineDepth_; }
+
+float EngineCore::frameLatency() const { return frameLatency_; }
+
+size_t EngineCore::frameAllocations() const { return frameAllocations_; }
+
+size_t EngineCore::updateAllocations() const { return updateAllocations_; }
+
+RenderStats EngineCore::stats() const {
+  std::lock_guard lock{statsMutex_};
+  return statsHistory_.stats();
+}
+
+FrameStats &EngineCore::counters_() const {
+  return threadStats_[jobs_.threadIndex()].stats;
+}
+
+void EngineCore::addFrameStats_(FrameStats stats,
+                            const CommandBuffer::Submission &submission) {
+  stats.linesSubmitted = submission.lines;
+  stats.trianglesSubmitted = submission.triangles;
+  stats.pointsSubmitted = submission.points;
+  // the clear and the present of the frame, besides its draw calls
+  stats.backendCalls = submission.calls + 2;
+  stats.bytesUploaded = submission.bytes;
+  std::lock_guard lock{statsMutex_};
+  statsHistory_.add(stats);
+}
+
+void EngineCore::setHiddenLineRemoval(bool enabled) {
+  hiddenLineRemoval_ = enabled;
+  warmupFrames_ = pipelineDepth_ + 1;
+}
+
+bool EngineCore::hiddenLineRemoval() const { return hiddenLineRemoval_; }
+
+void EngineCore::clipHiddenLineFace_(const ClipVertex (&face)[3],
+                                 ArenaVector<V3F> &faces) const {
+  if (viewOutcode(face[0].position) & viewOutcode(face[1].position) &
+      viewOutcode(face[2].position))
+    return;
+  ClipVertex polygon[maxClippedVertices];
+  const auto count{clipTriangle(face, polygon)};
+  for (size_t i{1}; i + 1 < count; ++i)
+    faces.insert(faces.end(), {toScreen_(polygon[0].position),
+                               toScreen_(polygon[i].position),
+                               toScreen_(polygon[i + 1].position)});
+}
+
+void EngineCore::mergeList_(const DrawList &list) {
+  // the whole mesh is a single packet
+  commands_.drawTriangles(list.triangles.vertices, list.triangles.colors);
+  // the prepass is drawn in order, after the jobs, since faces overlap
+  for (size_t i{}; i + 2 < list.faces.size(); i += 3)
+    hiddenLines_.drawFace(
+        {list.faces[i], list.faces[i + 1], list.faces[i + 2]});
+}
+
+void EngineCore::keepDirect_() {
+  directCommands_.drawTriangles(directList_.triangles.vertices,
+                                directList_.triangles.colors);
+  directFaces_.insert(directFaces_.end(), directList_.faces.begin(),
+                      directList_.faces.end());
+}
+
+void EngineCore::buildOcclusion_() {
+  hasHiZ_ = false;
+  if (occlusionCulling_ == OcclusionCulling::Disabled || !scene_.mainCamera())
+    return;
+  if (occlusionCulling_ == OcclusionCulling::PreviousFrame &&
+      pipelineDepth_ > 1) {
+    // the screen belongs to the presenting thread, which kept the depth of
+    // the last frame it presented
+    std::lock_guard lock{pipelineMutex_};
+    if (hasPresentedHiZ_) {
+      hiZ_ = presentedHiZ_;
+      hasHiZ_ = true;
+    }
+    return;
+  }
+  hiZ_.reset(screen_.width(), screen_.height());
+  if (occlusionCulling_ == OcclusionCulling::PreviousFrame) {
+    const auto *depth{screen_.depth()};
+    if (!depth)
+      return;
+    hiZ_.loadDepth(depth);
+  } else {
+    for (auto &[_, object] : scene_) {
+      const auto *mesh{dynamic_cast<const TriangleMesh *>(object)};
+      if (mesh && mesh->isOccluder() && !isCulled_(mesh, mesh->bounds()))
+        drawOccluder_(mesh);
+    }
+  }
+  hiZ_.buildPyramid();
+  hasHiZ_ = true;
+}
+
+void EngineCore::drawOccluder_(const TriangleMesh *mesh) {
+  const auto &camera{*scene_.mainCamera()};
+  const auto mvp{camera.perspective() * camera.worldToCamera() *
+                 mesh->transform()};
+  ArenaVector<V4F> clipped(mesh->vertices().size(), frameAllocator_());
+  counters_().verticesTransformed += clipped.size();
+  for (size_t i{}; i < clipped.size(); ++i)
+    clipped[i] = toClipSpace_(mvp, mesh->vertices()[i]);
+  // only whole triangles are drawn, since clipping an occluder would only
+  // make it smaller anyway
+  const auto inDepthRange{[](const V4F &position) {
+    return position.w > 0 && position.z >= 0 && position.z <= position.w;
+  }};
+  for (const auto &triangle : mesh->triangles()) {
+    const auto &a{clipped[triangle.v1]}, &b{clipped[triangle.v2]},
+        &c{clipped[triangle.v3]};
+    if (inDepthRange(a) && inDepthRange(b) && inDepthRange(c))
+      hiZ_.drawOccluder({toScreen_(a), toScreen_(b), toScreen_(c)});
+  }
+}
+
+bool EngineCore::isCulled_(const Object *object,
+                           const Bounds &bounds) const {
+  const auto *mainCamera{scene_.mainCamera()};
+  if (!mainCamera)
+    return false;
+  // without vertices, min is above max
+  if (bounds.min.x > bounds.max.x)
+    return true;
+  const auto mvp{mainCamera->perspective() * mainCamera->worldToCamera() *
+                 object->transform()};
+  uint8_t sharedOutcode{0xFF};
+  auto crossesNearPlane{false};
+  float x0{float(screen_.width())}, y0{float(screen_.height())}, x1{}, y1{},
+      nearest{1};
+  for (unsigned i{}; i < 8; ++i) {
+    const V3F corner{i & 1 ? bounds.max.x : bounds.min.x,
+                     i & 2 ? bounds.max.y : bounds.min.y,
+                     i & 4 ? bounds.max.z : bounds.min.z};
+    const auto clip{toClipSpace_(mvp, corner)};
+    sharedOutcode &= viewOutcode(clip);
+    // corners in front of the near plane don't project anywhere meaningful
+    if (!(clip.w > 0 && clip.z >= 0)) {
+      crossesNearPlane = true;
       continue;
     }
+    const auto screen{toScreen_(clip)};
+    x0 = (std::min)(x0, screen.x), x1 = (std::max)(x1, screen.x);
+    y0 = (std::min)(y0, screen.y), y1 = (std::max)(y1, screen.y);
+    nearest = (std::min)(nearest, screen.z);
   }
-  screen_.drawLines(lines.data(), lines.size());
-}
-
-void Engine::run() {
-  auto renderThread{std::thread{[&]() {
-    using namespace std::chrono;
-    setup_(this);
-    while (true) {
-      auto start{steady_clock::now()};
-      loop_(this);
-      screen_.clear();
-      draw();
-      screen_.present();
-      auto end{steady_clock::now()};
-      auto elapsedMs{duration_cast<milliseconds>(end - start)};
-      deltaTime_ = float(elapsedMs.count()) / 1e3f;
+  if (sharedOutcode)
+    return true;
+  return hasHiZ_ && !crossesNearPlane &&
+         hiZ_.isOccluded(x0, y0, x1, y1, nearest);
+}
+
+V4F EngineCore::toClipSpace_(const M4F &mvp, const V3F &vertex) {
+  return mvp * V4F{vertex.x, vertex.y, vertex.z, 1};
+}
+
+V3F EngineCore::toScreen_(const V4F &clipSpace) const {
+  const auto ndc{clipSpace.projected()};
+  const auto width{float(screen_.width())}, height{float(screen_.height())};
+  return {(ndc.x + 1) * width / 2, (1 - ndc.y) * height / 2, ndc.z};
+}
+
+bool EngineCore::isFrontFacing_(const V3F *polygon, size_t count) {
+  // twice the signed area of the polygon. y grows downwards on the screen, so
+  // counter-clockwise polygons (the front faces) come out negative
+  float area{};
+  for (size_t i{}, j{count - 1}; i < count; j = i++)
+    area += (polygon[j].x - polygon[i].x) * (polygon[j].y + polygon[i].y);
+  return area < 0;
+}
+
+std::chrono::steady_clock::duration EngineCore::beginFrame_() {
+  using namespace std::chrono;
+  auto start{steady_clock::now()};
+  const auto elapsed{hasFrameStart_ ? start - frameStart_
+                                    : steady_clock::duration{}};
+  deltaTime_ = duration<double>{elapsed}.count();
+  frameStart_ = start;
+  hasFrameStart_ = true;
+  frameAllocationStart_ = allocationCount();
+  return elapsed;
+}
+
+size_t EngineCore::fixedSteps_(std::chrono::steady_clock::duration elapsed) {
+  return fixedTimestep_.advance(elapsed);
+}
+
+void EngineCore::setFixedRate_(double rate) {
+  fixedTimestep_ = FixedTimestep{rate};
+}
+
+void EngineCore::updateBehaviors_(
+    std::chrono::steady_clock::duration elapsed) {
+  VBAG_PROFILE_ZONE("behaviors");
+  behaviors_.update(elapsed);
+}
+
+void EngineCore::endFrame_() {
+  using namespace std::chrono;
+  renderAllocationStart_ = allocationCount();
+  updateAllocations_ = renderAllocationStart_ - frameAllocationStart_;
+  if (pipelineDepth_ > 1) {
+    record_();
+    // waits for the oldest frame to be presented if the pipeline is full
+    VBAG_PROFILE_ZONE("submit");
+    submitFrame_(frameStart_);
+  } else {
+    clear_();
+    const auto submission{draw_()};
+    present_();
+    frameLatency_ =
+        duration<float>{steady_clock::now() - frameStart_}.count();
+    countFrameAllocations_();
+    addFrameStats_(frameStats_, submission);
+  }
+}
+
+void EngineCore::waitForFrame_() { limiter_.wait(); }
+
+void EngineCore::clear_() {
+  VBAG_PROFILE_ZONE("clear");
+  screen_.clear();
+}
+
+void EngineCore::present_() {
+  VBAG_PROFILE_ZONE("present");
+  screen_.present();
+}
+
+void EngineCore::submitFrame_(std::chrono::steady_clock::time_point start) {
+  std::unique_lock lock{pipelineMutex_};
+  if (!presenter_.joinable())
+    presenter_ = std::thread{[this] { presentFrames_(); }};
+  pipelineChanged_.wait(lock, [&] {
+    return pipelined_ < pipeline_.size() || presentError_;
+  });
+  if (presentError_)
+    std::rethrow_exception(std::exchange(presentError_, nullptr));
+  // the frame ends here rather than when it's presented, which happens
+  // while later frames are updated and counted
+  countFrameAllocations_();
+  auto &frame{pipeline_[(firstPipelined_ + pipelined_) % pipeline_.size()]};
+  // the buffers are swapped, so both keep their storage for later frames
+  std::swap(frame.commands, commands_);
+  frame.start = start;
+  frame.stats = frameStats_;
+  frame.keepsDepth = occlusionCulling_ == OcclusionCulling::PreviousFrame;
+  ++pipelined_;
+  lock.unlock();
+  pipelineChanged_.notify_all();
+}
+
+void EngineCore::flush_() {
+  std::unique_lock lock{pipelineMutex_};
+  pipelineChanged_.wait(lock, [&] { return pipelined_ == 0; });
+  if (presentError_)
+    std::rethrow_exception(std::exchange(presentError_, nullptr));
+}
+
+void EngineCore::presentFrames_() {
+  using namespace std::chrono;
+  for (;;) {
+    std::unique_lock lock{pipelineMutex_};
+    pipelineChanged_.wait(lock,
+                          [&] { return pipelined_ != 0 || stopPresenting_; });
+    if (pipelined_ == 0)
+      return;
+    auto &frame{pipeline_[firstPipelined_]};
+    lock.unlock();
+
+    auto keptDepth{false};
+    try {
+      clear_();
+      CommandBuffer::Submission submission;
+      {
+        VBAG_PROFILE_ZONE("execute");
+        submission = frame.commands.execute(screen_);
+      }
+      present_();
+      addFrameStats_(frame.stats, submission);
+      const auto *depth{screen_.depth()};
+      if (frame.keepsDepth && depth) {
+        presenterHiZ_.reset(screen_.width(), screen_.height());
+        presenterHiZ_.loadDepth(depth);
+        presenterHiZ_.buildPyramid();
+        keptDepth = true;
+      }
+    } catch (...) {
+      lock.lock();
+      if (!presentError_)
+        presentError_ = std::current_exception();
+      lock.unlock();
     }
-  }}};
+    frameLatency_ = duration<float>{steady_clock::now() - frame.start}.count();
 
+    lock.lock();
+    if (keptDepth) {
+      std::swap(presentedHiZ_, presenterHiZ_);
+      hasPresentedHiZ_ = true;
+    }
+    firstPipelined_ = (firstPipelined_ + 1) % pipeline_.size();
+    --pipelined_;
+    lock.unlock();
+    pipelineChanged_.notify_all();
+  }
+}
+
+void EngineCore::pumpWindowMessages_() {
+#if defined(_WIN32)
   MSG msg{};
   while (GetMessage(&msg, nullptr, 0, 0) > 0) {
     TranslateMessage(&msg);
     DispatchMessage(&msg);
   }
+#endif
+}
+
+[[nodiscard]] float EngineCore::frameRate() const { return frameRate_; }
 
-  renderThread.join();
+[[nodiscard]] float EngineCore::frameTime() const {
+  return 1000.0F / frameRate();
 }
 
-[[nodiscard]] inline float Engine::frameRate() const { return frameRate_; }
+Screen &EngineCore::screen() { return screen_; }
+
+Camera &EngineCore::camera() { return *scene_.mainCamera(); }
+
+JobSystem &EngineCore::jobs() { return jobs_; }
 
-[[nodiscard]] float Engine::frameTime() const { return 1000.0F / frameRate(); }
+void EngineCore::delay(float milliseconds) {
+  using namespace std::chrono;
+  preciseSleepUntil(
+      steady_clock::now() +
+      duration_cast<steady_clock::duration>(
+          duration<double, std::milli>{double(milliseconds)}));
+}
+
+float EngineCore::deltaTime() const { return float(deltaTime_); }
 
-Screen &Engine::screen() { return screen_; }
+void EngineCore::spawn(Behavior behavior) {
+  behaviors_.spawn(std::move(behavior));
+}
 
-Camera &Engine::camera() { return *scene_.mainCamera(); }
+BehaviorScheduler &EngineCore::behaviors() { return behaviors_; }
 
-void Engine::delay(float milliseconds) { Sleep(DWORD(milliseconds)); }
+double EngineCore::fixedDeltaTime() const { return fixedTimestep_.step(); }
 
-float Engine::deltaTime() const { return deltaTime_; }
+double EngineCore::interpolationAlpha() const {
+  return fixedTimestep_.alpha();
+}
 
 } // namespace vbag
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "animation/behavior.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace vbag {
+
+namespace {
+
+/// @brief Coroutine frames are pooled in sizes rounded up to a multiple of
+/// this.
+constexpr size_t frameGranularity{64};
+
+/// @brief Frames larger than this aren't pooled.
+constexpr size_t maxPooledFrame{4096};
+
+/// @brief Set once the pool of the thread is gone, so frames freed later
+/// (by static objects destroyed at exit) go straight back to the heap.
+thread_local bool isFramePoolGone{};
+
+/// @class FramePool
+/// @brief Coroutine frames freed on a thread, kept for reuse by size.
+class FramePool {
+public:
+  FramePool() = default;
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  ~FramePool() {
+    for (auto *frame : free_)
+      while (frame)
+        ::operator delete(std::exchange(frame, frame->next));
+    isFramePoolGone = true;
+  }
+
+  void *allocate(size_t size) {
+    if (size > maxPooledFrame)
+      return ::operator new(size);
+    auto &frame{free_[sizeClass_(size)]};
+    if (!frame)
+      return ::operator new((sizeClass_(size) + 1) * frameGranularity);
+    return std::exchange(frame, frame->next);
+  }
+
+  void deallocate(void *memory, size_t size) noexcept {
+    if (size > maxPooledFrame) {
+      ::operator delete(memory);
+      return;
+    }
+    auto &first{free_[sizeClass_(size)]};
+    first = new (memory) FreeFrame{first};
+  }
+
+private:
+  struct FreeFrame {
+    FreeFrame *next;
+  };
+
+  /// @brief Coroutine frames are never empty, since they hold the promise.
+  static size_t sizeClass_(size_t size) {
+    return (size - 1) / frameGranularity;
+  }
+
+  std::array<FreeFrame *, maxPooledFrame / frameGranularity> free_{};
+};
+
+thread_local FramePool framePool;
+
+} // namespace
+
+Behavior Behavior::promise_type::get_return_object() {
+  return Behavior{Handle::from_promise(*this)};
+}
+
+void Behavior::promise_type::unhandled_exception() noexcept {
+  exception = std::current_exception();
+}
+
+void *Behavior::promise_type::operator new(size_t size) {
+  if (isFramePoolGone)
+    return ::operator new(size);
+  return framePool.allocate(size);
+}
+
+void Behavior::promise_type::operator delete(void *frame,
+                                             size_t size) noexcept {
+  if (isFramePoolGone)
+    ::operator delete(frame);
+  else
+    framePool.deallocate(frame, size);
+}
+
+Behavior::Behavior(Handle handle) : handle_{handle} {}
+
+Behavior::Behavior(Behavior &&other) noexcept
+    : handle_{std::exchange(other.handle_, nullptr)} {}
+
+Behavior &Behavior::operator=(Behavior &&other) noexcept {
+  if (this != &other) {
+    if (handle_)
+      handle_.destroy();
+    handle_ = std::exchange(other.handle_, nullptr);
+  }
+  return *this;
+}
+
+Behavior::~Behavior() {
+  if (handle_)
+    handle_.destroy();
+}
+
+BehaviorScheduler::~BehaviorScheduler() {
+  while (first_) {
+    auto *promise{std::exchange(first_, first_->next)};
+    Behavior::Handle::from_promise(*promise).destroy();
+  }
+}
+
+void BehaviorScheduler::spawn(Behavior behavior) {
+  const auto handle{std::exchange(behavior.handle_, nullptr)};
+  auto &promise{handle.promise()};
+  promise.scheduler = this;
+  promise.next = first_;
+  if (first_)
+    first_->previous = &promise;
+  first_ = &promise;
+  ++size_;
+  resume_(handle);
+}
+
+void BehaviorScheduler::update(Duration elapsed) {
+  time_ += elapsed;
+  // the behaviors queued for this frame become due, and those awaiting the
+  // next frame while resuming queue up in the emptied vector
+  std::swap(due_, nextFrame_);
+  collectTimers_();
+  for (size_t i{}; i < waiters_.size();) {
+    if (waiters_[i].holds(waiters_[i].condition)) {
+      due_.push_back(waiters_[i].behavior);
+      waiters_[i] = waiters_.back();
+      waiters_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+
+  for (size_t i{}; i < due_.size(); ++i) {
+    try {
+      resume_(due_[i]);
+    } catch (...) {
+      nextFrame_.insert(nextFrame_.end(), due_.begin() + i + 1, due_.end());
+      due_.clear();
+      throw;
+    }
+  }
+  due_.clear();
+}
+
+void BehaviorScheduler::collectTimers_() {
+  const auto now{uint64_t(time_ / tickLength)};
+  if (now == tick_)
+    return;
+  // going round the wheel once visits every slot, however many ticks passed
+  const auto ticks{(std::min)(now - tick_, uint64_t{wheelSize})};
+  for (uint64_t i{1}; i <= ticks; ++i) {
+    auto &slot{wheel_[(tick_ + i) % wheelSize]};
+    for (size_t j{}; j < slot.size();) {
+      // the others are due in a later turn of the wheel
+      if (slot[j].dueTick <= now) {
+        due_.push_back(slot[j].behavior);
+        slot[j] = slot.back();
+        slot.pop_back();
+      } else {
+        ++j;
+      }
+    }
+  }
+  tick_ = now;
+}
+
+void BehaviorScheduler::resume_(Behavior::Handle behavior) {
+  behavior.resume();
+  if (!behavior.done())
+    return;
+  auto &promise{behavior.promise()};
+  if (promise.previous)
+    promise.previous->next = promise.next;
+  else
+    first_ = promise.next;
+  if (promise.next)
+    promise.next->previous = promise.previous;
+  --size_;
+  const auto exception{std::move(promise.exception)};
+  behavior.destroy();
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
+size_t BehaviorScheduler::size() const { return size_; }
+
+BehaviorScheduler::Duration BehaviorScheduler::time() const { return time_; }
+
+void BehaviorScheduler::resumeNextFrame(Behavior::Handle behavior) {
+  nextFrame_.push_back(behavior);
+}
+
+void BehaviorScheduler::resumeAfter(Duration delay, Behavior::Handle behavior) {
+  // rounded up, so it never resumes early
+  const auto due{time_ + (std::max)(delay, Duration{})};
+  const auto dueTick{uint64_t((due + tickLength - Duration{1}) / tickLength)};
+  // the slot of a tick already collected would only come up a turn later
+  if (dueTick <= tick_)
+    resumeNextFrame(behavior);
+  else
+    wheel_[dueTick % wheelSize].push_back({behavior, dueTick});
+}
+
+void BehaviorScheduler::resumeWhen(bool (*holds)(void *), void *condition,
+                                   Behavior::Handle behavior) {
+  waiters_.push_back({behavior, holds, condition});
+}
+
+void NextFrame::await_suspend(Behavior::Handle behavior) const {
+  behavior.promise().scheduler->resumeNextFrame(behavior);
+}
+
+void Sleep::await_suspend(Behavior::Handle behavior) const {
+  behavior.promise().scheduler->resumeAfter(duration, behavior);
+}
+
+NextFrame nextFrame() { return {}; }
+
+Sleep seconds(double seconds) {
+  using namespace std::chrono;
+  return {ceil<BehaviorScheduler::Duration>(duration<double>{seconds})};
+}
+
+} // namespace vbag
@@ -0,0 +1,93 @@
+#include "animation/frame_pacing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace vbag {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Converts seconds into clock ticks, at least one.
+Clock::duration toTicks(double seconds) {
+  return (std::max)(
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>{seconds}),
+      Clock::duration{1});
+}
+
+/// @brief The running mean and variance of how long a 1 ms sleep takes, by
+/// Welford's method, in seconds.
+struct SleepStats {
+  double mean{2e-3}, m2{}, count{1};
+
+  /// @brief Returns a pessimistic guess of how long the next sleep takes.
+  [[nodiscard]] double estimate() const {
+    return mean + std::sqrt(m2 / count);
+  }
+
+  void add(double observed) {
+    ++count;
+    const auto delta{observed - mean};
+    mean += delta / count;
+    m2 += delta * (observed - mean);
+  }
+};
+
+} // namespace
+
+void preciseSleepUntil(Clock::time_point deadline) {
+  thread_local SleepStats stats;
+  for (;;) {
+    const auto start{Clock::now()};
+    const auto remaining{
+        std::chrono::duration<double>{deadline - start}.count()};
+    if (remaining <= stats.estimate())
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    stats.add(std::chrono::duration<double>{Clock::now() - start}.count());
+  }
+  while (Clock::now() < deadline)
+    std::this_thread::yield();
+}
+
+FixedTimestep::FixedTimestep(double rate, size_t maxSteps)
+    : step_{toTicks(1 / rate)}, maxSteps_{(std::max)(maxSteps, size_t{1})} {}
+
+size_t FixedTimestep::advance(Duration elapsed) {
+  accumulated_ += (std::max)(elapsed, Duration::zero());
+  auto steps{size_t(accumulated_ / step_)};
+  accumulated_ -= step_ * steps;
+  if (steps > maxSteps_)
+    steps = maxSteps_;
+  return steps;
+}
+
+double FixedTimestep::step() const {
+  return std::chrono::duration<double>{step_}.count();
+}
+
+double FixedTimestep::alpha() const {
+  return double(accumulated_.count()) / double(step_.count());
+}
+
+FrameLimiter::FrameLimiter(double frameRate)
+    : period_{frameRate > 0 ? toTicks(1 / frameRate) : Clock::duration{}} {}
+
+void FrameLimiter::wait() {
+  if (period_ == Clock::duration{})
+    return;
+  const auto now{Clock::now()};
+  if (!started_ || now > next_ + period_) {
+    // the first frame, or one too late to catch up with, is due right away
+    started_ = true;
+    next_ = now + period_;
+    return;
+  }
+  preciseSleepUntil(next_);
+  next_ += period_;
+}
+
+} // namespace vbag
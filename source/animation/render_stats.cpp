@@ -0,0 +1,73 @@
+#include "animation/render_stats.hpp"
+
+namespace vbag {
+
+ObjectStats &ObjectStats::operator+=(const ObjectStats &other) {
+  visited += other.visited;
+  culled += other.culled;
+  drawn += other.drawn;
+  return *this;
+}
+
+ObjectStats &ObjectStats::operator-=(const ObjectStats &other) {
+  visited -= other.visited;
+  culled -= other.culled;
+  drawn -= other.drawn;
+  return *this;
+}
+
+FrameStats &FrameStats::operator+=(const FrameStats &other) {
+  graphs += other.graphs;
+  triangleMeshes += other.triangleMeshes;
+  quadMeshes += other.quadMeshes;
+  otherObjects += other.otherObjects;
+  verticesTransformed += other.verticesTransformed;
+  linesClipped += other.linesClipped;
+  trianglesClipped += other.trianglesClipped;
+  trianglesBackFacing += other.trianglesBackFacing;
+  linesSubmitted += other.linesSubmitted;
+  trianglesSubmitted += other.trianglesSubmitted;
+  pointsSubmitted += other.pointsSubmitted;
+  backendCalls += other.backendCalls;
+  bytesUploaded += other.bytesUploaded;
+  allocations += other.allocations;
+  updateAllocations += other.updateAllocations;
+  return *this;
+}
+
+FrameStats &FrameStats::operator-=(const FrameStats &other) {
+  graphs -= other.graphs;
+  triangleMeshes -= other.triangleMeshes;
+  quadMeshes -= other.quadMeshes;
+  otherObjects -= other.otherObjects;
+  verticesTransformed -= other.verticesTransformed;
+  linesClipped -= other.linesClipped;
+  trianglesClipped -= other.trianglesClipped;
+  trianglesBackFacing -= other.trianglesBackFacing;
+  linesSubmitted -= other.linesSubmitted;
+  trianglesSubmitted -= other.trianglesSubmitted;
+  pointsSubmitted -= other.pointsSubmitted;
+  backendCalls -= other.backendCalls;
+  bytesUploaded -= other.bytesUploaded;
+  allocations -= other.allocations;
+  updateAllocations -= other.updateAllocations;
+  return *this;
+}
+
+void RenderStatsHistory::add(const FrameStats &frame) {
+  stats_.lastFrame = frame;
+  stats_.total += frame;
+  ++stats_.frames;
+  // the frame that falls out of the window is swapped for the new one
+  if (stats_.recentFrames == RenderStats::windowSize)
+    stats_.recent -= window_[next_];
+  else
+    ++stats_.recentFrames;
+  stats_.recent += frame;
+  window_[next_] = frame;
+  next_ = (next_ + 1) % RenderStats::windowSize;
+}
+
+const RenderStats &RenderStatsHistory::stats() const { return stats_; }
+
+} // namespace vbag
@@ -0,0 +1,23 @@
+#include "geometry/bounds.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace vbag {
+
+Bounds boundsOf(std::span<const V3F> points) {
+  constexpr auto infinity{std::numeric_limits<float>::infinity()};
+  Bounds bounds{{infinity, infinity, infinity}, {-infinity, -infinity,
+                                                 -infinity}};
+  for (const auto &point : points) {
+    bounds.min.x = (std::min)(bounds.min.x, point.x);
+    bounds.min.y = (std::min)(bounds.min.y, point.y);
+    bounds.min.z = (std::min)(bounds.min.z, point.z);
+    bounds.max.x = (std::max)(bounds.max.x, point.x);
+    bounds.max.y = (std::max)(bounds.max.y, point.y);
+    bounds.max.z = (std::max)(bounds.max.z, point.z);
+  }
+  return bounds;
+}
+
+} // namespace vbag
@@ -3,25 +3,30 @@
 
 namespace vbag {
 
-Camera::Camera(const std::string &name, float fovDeg, float pixelAspectRatio_)
-    : Object(name), fovDeg_{fovDeg}, aspectRatio_{pixelAspectRatio_} {
+Camera::Camera(const std::string &name, float fovDeg, float pixelAspectRatio_,
+               float nearPlane, float farPlane)
+    : Object(name), fovDeg_{fovDeg}, aspectRatio_{pixelAspectRatio_},
+      nearPlane_{nearPlane}, farPlane_{farPlane} {
+  const auto fovRad{fovDeg_ * (std::numbers::pi_v<float> / 180.0f)};
+  // the factor of 2 keeps the framing the engine has always had, from back
+  // when the visible range was [-0.5, 0.5] instead of [-1, 1]
+  const auto xFactor{2.0f * aspectRatio_ / std::tan(fovRad / 2.0f)},
+      yFactor{2.0f / std::tan(fovRad / 2.0f)};
+  // direct3d style projection: z goes from 0 at the near plane to w at the far
+  // plane, and w is the distance in front of the camera
+  const auto zScale{farPlane_ / (nearPlane_ - farPlane_)};
+  perspective_ = {xFactor, 0,       0,      0,                   //
+                  0,       yFactor, 0,      0,                   //
+                  0,       0,       zScale, nearPlane_ * zScale, //
+                  0,       0,       -1,     0};
   updateWTC_();
 }
 
-[[nodiscard]] const M4F &Camera::perspective() const {
-  static auto fovRad{fovDeg_ * (std::numbers::pi_v<float> / 180.0f)};
-  static auto xFactor{aspectRatio_ / std::tan(fovRad / 2.0f)},
-      yFactor{1.0f / std::tan(fovRad / 2.0f)};
-  // perspective projection matrix stolen
-  // and adapted from https://ogldev.org/www/tutorial12/tutorial12.html
-  // HACK: notice the -1e9 there. I have some idea why this prevents things that
-  // are behind the camera from being drawn. keep it as high as possible.
-  static M4F perspectiveMatrix{xFactor, 0,       0,  0,    //
-                               0,       yFactor, 0,  0,    //
-                               0,       0,       1,  -1e9, //
-                               0,       0,       -1, 1};
-  return perspectiveMatrix;
-}
+[[nodiscard]] const M4F &Camera::perspective() const { return perspective_; }
+
+float Camera::nearPlane() const { return nearPlane_; }
+
+float Camera::farPlane() const { return farPlane_; }
 
 [[nodiscard]] const M4F &Camera::worldToCamera() const { return wtc_; }
 
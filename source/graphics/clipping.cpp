@@ -0,0 +1,135 @@
+#include "graphics/clipping.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace vbag {
+
+namespace {
+
+/// @brief The planes primitives are clipped against, in outcode bit order.
+enum ClipPlane : uint8_t {
+  NearPlane,
+  FarPlane,
+  LeftPlane,
+  RightPlane,
+  BottomPlane,
+  TopPlane,
+  ClipPlaneCount,
+};
+
+/// @brief Signed distance (times w) of a point to one of the planes, which
+/// is negative outside of it.
+float distance(const V4F &p, uint8_t plane, float extent) {
+  switch (plane) {
+  case NearPlane:
+    return p.z;
+  case FarPlane:
+    return p.w - p.z;
+  case LeftPlane:
+    return p.x + extent * p.w;
+  case RightPlane:
+    return extent * p.w - p.x;
+  case BottomPlane:
+    return p.y + extent * p.w;
+  default:
+    return extent * p.w - p.y;
+  }
+}
+
+uint8_t outcode(const V4F &p, float extent) {
+  uint8_t code{};
+  for (uint8_t plane{}; plane < ClipPlaneCount; ++plane)
+    if (distance(p, plane, extent) < 0)
+      code |= uint8_t(1u << plane);
+  return code;
+}
+
+uint8_t lerpChannel(D3DCOLOR a, D3DCOLOR b, unsigned shift, float t) {
+  const auto ca{float((a >> shift) & 0xFF)}, cb{float((b >> shift) & 0xFF)};
+  return uint8_t(ca + (cb - ca) * t + 0.5f);
+}
+
+ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+  return {a.position + (b.position - a.position) * t,
+          D3DCOLOR(lerpChannel(a.color, b.color, 24, t)) << 24 |
+              D3DCOLOR(lerpChannel(a.color, b.color, 16, t)) << 16 |
+              D3DCOLOR(lerpChannel(a.color, b.color, 8, t)) << 8 |
+              D3DCOLOR(lerpChannel(a.color, b.color, 0, t))};
+}
+
+} // namespace
+
+uint8_t viewOutcode(const V4F &position) { return outcode(position, 1.0f); }
+
+uint8_t clipOutcode(const V4F &position) {
+  return outcode(position, guardBand);
+}
+
+bool clipLine(ClipVertex &a, ClipVertex &b) {
+  const auto codeA{clipOutcode(a.position)}, codeB{clipOutcode(b.position)};
+  if (codeA & codeB)
+    return false;
+  if (!(codeA | codeB))
+    return true;
+  // liang-barsky, but in homogeneous coordinates
+  float enter{0}, exit{1};
+  for (uint8_t plane{}; plane < ClipPlaneCount; ++plane) {
+    if (!((codeA | codeB) & (1u << plane)))
+      continue;
+    const auto da{distance(a.position, plane, guardBand)},
+        db{distance(b.position, plane, guardBand)};
+    const auto t{da / (da - db)};
+    if (da < 0)
+      enter = (std::max)(enter, t);
+    else
+      exit = (std::min)(exit, t);
+  }
+  if (enter >= exit)
+    return false;
+  const auto original{a};
+  if (enter > 0)
+    a = lerp(original, b, enter);
+  if (exit < 1)
+    b = lerp(original, b, exit);
+  return true;
+}
+
+size_t clipTriangle(const ClipVertex (&triangle)[3], ClipVertex *out) {
+  uint8_t codes[3];
+  for (size_t i{}; i < 3; ++i)
+    codes[i] = clipOutcode(triangle[i].position);
+  if (codes[0] & codes[1] & codes[2])
+    return 0;
+  std::copy(triangle, triangle + 3, out);
+  const auto crossed{codes[0] | codes[1] | codes[2]};
+  if (!crossed)
+    return 3;
+
+  // sutherland-hodgman, only against the planes some vertex is outside of.
+  // every plane adds at most one vertex, hence maxClippedVertices
+  ClipVertex buffer[maxClippedVertices];
+  auto *input{out}, *output{buffer};
+  size_t count{3};
+  for (uint8_t plane{}; plane < ClipPlaneCount && count >= 3; ++plane) {
+    if (!(crossed & (1u << plane)))
+      continue;
+    size_t kept{};
+    for (size_t i{}; i < count; ++i) {
+      const auto &current{input[i]}, &next{input[(i + 1) % count]};
+      const auto dc{distance(current.position, plane, guardBand)},
+          dn{distance(next.position, plane, guardBand)};
+      if (dc >= 0)
+        output[kept++] = current;
+      if ((dc >= 0) != (dn >= 0))
+        output[kept++] = lerp(current, next, dc / (dc - dn));
+    }
+    count = kept;
+    std::swap(input, output);
+  }
+  if (input != out)
+    std::copy(input, input + count, out);
+  return count;
+}
+
+} // namespace vbag
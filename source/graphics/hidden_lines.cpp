@@ -0,0 +1,157 @@
+#include "graphics/hidden_lines.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "output/triangle_rasterizer.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief The fewest lines worth splitting in a job of their own.
+constexpr size_t minLineChunkSize{2048};
+
+/// @brief How far behind the faces a point may be and still be visible, as a
+/// fraction of how far the faces are from the far plane in depth. With
+/// perspective depth, that's about a thousandth of their distance.
+constexpr float relativeTolerance{1e-3f};
+
+/// @brief The least tolerance, for faces right at the far plane.
+constexpr float minTolerance{1e-7f};
+
+V3F lerp(const V3F &a, const V3F &b, float t) { return a + (b - a) * t; }
+
+} // namespace
+
+void HiddenLineBuffer::reset(size_t width, size_t height) {
+  width_ = width;
+  height_ = height;
+  depth_.assign(width * height, 1.0f);
+}
+
+void HiddenLineBuffer::drawFace(const V3F (&triangle)[3]) {
+  for (const auto &vertex : triangle)
+    if (!(std::fabs(vertex.x) <= maxRasterCoordinate &&
+          std::fabs(vertex.y) <= maxRasterCoordinate))
+      return;
+  const RasterTarget target{nullptr, depth_.data(), width_, 0, 0,
+                            (long long)(width_), (long long)(height_)};
+  rasterizeTriangle(target, triangle, {0, 0, 0});
+}
+
+void HiddenLineBuffer::appendVisible(std::span<const Line> lines,
+                                     ArenaVector<Line> &visible,
+                                     JobSystem &jobs,
+                                     FrameArena &arena) const {
+  const auto chunks{jobs.chunkCount(lines.size(), minLineChunkSize)};
+  if (chunks == 1) {
+    for (const auto &line : lines)
+      appendVisible_(line, visible);
+    return;
+  }
+  ArenaVector<ArenaVector<Line>> pieces(
+      chunks, ArenaAllocator<Line>{arena, jobs.threadIndex()});
+  jobs.parallelFor(chunks, [&](size_t chunk) {
+    const auto [begin, end]{chunkRange(lines.size(), chunks, chunk)};
+    auto &piece{pieces[chunk]};
+    // every thread fills its lists from its own sub-arena
+    piece = ArenaVector<Line>{ArenaAllocator<Line>{arena, jobs.threadIndex()}};
+    for (auto i{begin}; i < end; ++i)
+      appendVisible_(lines[i], piece);
+  });
+  for (const auto &chunk : pieces)
+    visible.insert(visible.end(), chunk.begin(), chunk.end());
+}
+
+void HiddenLineBuffer::appendVisible_(const Line &line,
+                                      ArenaVector<Line> &visible) const {
+  // clips the line to the screen, as a range of the parameter along it
+  const auto delta{line.end - line.start};
+  auto t0{0.0f}, t1{1.0f};
+  const float directions[4]{-delta.x, delta.x, -delta.y, delta.y},
+      distances[4]{line.start.x, float(width_) - line.start.x, line.start.y,
+                   float(height_) - line.start.y};
+  for (size_t i{}; i < 4; ++i) {
+    if (directions[i] == 0) {
+      if (distances[i] < 0)
+        return;
+      continue;
+    }
+    const auto t{distances[i] / directions[i]};
+    if (directions[i] < 0)
+      t0 = (std::max)(t0, t);
+    else
+      t1 = (std::min)(t1, t);
+  }
+  if (!(t0 < t1))
+    return;
+
+  // a sample in the middle of every pixel-sized step
+  const auto length{(std::max)(std::fabs(delta.x), std::fabs(delta.y)) *
+                    (t1 - t0)};
+  const auto steps{(std::max)(size_t(std::ceil(length)), size_t{1})};
+  const auto step{(t1 - t0) / float(steps)};
+  const auto emit{[&](size_t first, size_t last) {
+    visible.push_back({lerp(line.start, line.end, t0 + step * float(first)),
+                       lerp(line.start, line.end, t0 + step * float(last)),
+                       line.color});
+  }};
+  size_t runStart{};
+  auto inRun{false};
+  for (size_t i{}; i < steps; ++i) {
+    const auto point{
+        lerp(line.start, line.end, t0 + step * (float(i) + 0.5f))};
+    const auto isVisible{isVisible_(point.x, point.y, point.z)};
+    if (isVisible && !inRun)
+      runStart = i, inRun = true;
+    else if (!isVisible && inRun)
+      emit(runStart, i), inRun = false;
+  }
+  if (inRun)
+    emit(runStart, steps);
+}
+
+bool HiddenLineBuffer::isVisible_(float x, float y, float z) const {
+  const auto clampPixel{[](float value, size_t size) {
+    return size_t(std::clamp(value, 0.0f, float(size - 1)));
+  }};
+  const auto px{clampPixel(std::floor(x), width_)},
+      py{clampPixel(std::floor(y), height_)};
+  // the farthest depth of the pixel and its neighbors, since the pixel
+  // centers the faces were sampled at aren't on the line
+  auto farthest{0.0f};
+  for (auto row{py ? py - 1 : py}; row <= (std::min)(py + 1, height_ - 1);
+       ++row)
+    for (auto column{px ? px - 1 : px};
+         column <= (std::min)(px + 1, width_ - 1); ++column)
+      farthest = (std::max)(farthest, depth_[row * width_ + column]);
+  return z <= farthest + (std::max)((1 - farthest) * relativeTolerance,
+                                    minTolerance);
+}
+
+GV3F toWireframe(const std::string &name, const TriangleMesh &mesh,
+                 const RgbColor &color) {
+  GV3F graph{name, color};
+  for (const auto &vertex : mesh.vertices())
+    graph.addVertex(vertex);
+  std::vector<std::pair<size_t, size_t>> edges;
+  edges.reserve(mesh.triangles().size() * 3);
+  for (const auto &triangle : mesh.triangles()) {
+    const size_t corners[3]{triangle.v1, triangle.v2, triangle.v3};
+    for (size_t i{}; i < 3; ++i) {
+      const auto a{corners[i]}, b{corners[(i + 1) % 3]};
+      if (a != b)
+        edges.emplace_back((std::min)(a, b), (std::max)(a, b));
+    }
+    graph.addFace(triangle.v1, triangle.v2, triangle.v3);
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  for (const auto &[a, b] : edges)
+    graph.addEdge(a, b);
+  return graph;
+}
+
+} // namespace vbag
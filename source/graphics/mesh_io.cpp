@@ -0,0 +1,731 @@
+#include "graphics/mesh_io.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "util/error_handling.hpp"
+#include "util/mapped_file.hpp"
+#include "util/parallel.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief Splits polygons into triangles for a TriangleMesh.
+struct TriangleFaces {
+  using Face = TriangleMesh::Triangle;
+
+  static size_t facesFor(size_t corners) {
+    return corners < 3 ? 0 : corners - 2;
+  }
+
+  static Face *emit(Face *out, const size_t *corners, size_t n) {
+    for (size_t i{1}; i + 1 < n; ++i)
+      *out++ = {corners[0], corners[i], corners[i + 1]};
+    return out;
+  }
+
+  static auto &of(TriangleMesh &mesh) { return mesh.triangles(); }
+};
+
+/// @brief Splits polygons into quads for a QuadMesh.
+struct QuadFaces {
+  using Face = QuadMesh::Quad;
+
+  static size_t facesFor(size_t corners) {
+    return corners < 3 ? 0 : corners == 4 ? 1 : corners - 2;
+  }
+
+  static Face *emit(Face *out, const size_t *corners, size_t n) {
+    if (n == 4) {
+      *out++ = {corners[0], corners[1], corners[2], corners[3]};
+      return out;
+    }
+    // same degenerate quads as QuadMesh's TriangleMesh constructor makes
+    for (size_t i{1}; i + 1 < n; ++i)
+      *out++ = {corners[0], corners[i], corners[i + 1], corners[0]};
+    return out;
+  }
+
+  static auto &of(QuadMesh &mesh) { return mesh.faces(); }
+};
+
+[[noreturn]] void malformed() { throw RuntimeError<MalformedMeshFile>{}; }
+
+bool hasExtension(const std::string &path, const char *extension) {
+  const auto length{std::strlen(extension)};
+  if (path.size() < length)
+    return false;
+  return std::equal(path.end() - long(length), path.end(), extension,
+                    [](char a, char b) { return std::tolower(a) == b; });
+}
+
+/// @brief Replaces the geometry of a mesh with arrays of the given sizes.
+template <typename Mesh, typename Faces>
+void resizeMesh(Mesh &mesh, size_t vertices, size_t normals, size_t faces) {
+  // swapping with empty vectors first frees the old storage, so resizing
+  // allocates exactly what is needed
+  std::vector<V3F>{}.swap(mesh.vertices());
+  std::vector<V3F>{}.swap(mesh.normals());
+  std::vector<V3F>{}.swap(mesh.faceNormals());
+  std::vector<typename Faces::Face>{}.swap(Faces::of(mesh));
+  mesh.vertices().resize(vertices);
+  mesh.normals().resize(normals);
+  Faces::of(mesh).resize(faces);
+}
+
+// ---------------------------------------------------------------------------
+// OBJ
+// ---------------------------------------------------------------------------
+
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *skipBlanks(const char *p, const char *end) {
+  while (p < end && isBlank(*p))
+    ++p;
+  return p;
+}
+
+const char *skipToken(const char *p, const char *end) {
+  while (p < end && !isBlank(*p) && *p != '\n')
+    ++p;
+  return p;
+}
+
+const char *nextLine(const char *p, const char *end) {
+  auto newline{static_cast<const char *>(std::memchr(p, '\n', end - p))};
+  return newline ? newline + 1 : end;
+}
+
+float parseFloat(const char *&p, const char *end) {
+  p = skipBlanks(p, end);
+  if (p < end && *p == '+')
+    ++p;
+  float value{};
+  auto [next, error]{std::from_chars(p, end, value)};
+  if (error != std::errc{})
+    malformed();
+  p = next;
+  return value;
+}
+
+enum class ObjLine { Position, Normal, Face, Other };
+
+ObjLine classify(const char *&p, const char *end) {
+  p = skipBlanks(p, end);
+  if (end - p < 2)
+    return ObjLine::Other;
+  if (p[0] == 'v' && isBlank(p[1])) {
+    p += 2;
+    return ObjLine::Position;
+  }
+  if (p[0] == 'f' && isBlank(p[1])) {
+    p += 2;
+    return ObjLine::Face;
+  }
+  if (end - p > 2 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+    p += 3;
+    return ObjLine::Normal;
+  }
+  return ObjLine::Other;
+}
+
+/// @brief Parses the normal index of a face corner, given the rest of the
+/// corner after its position index (like "/2/3" or "//3").
+///
+/// @return The index, counted from 0, or -1 if the corner has none.
+long long normalIndex(const char *p, const char *end, size_t normalsSoFar) {
+  const auto *tokenEnd{skipToken(p, end)};
+  const auto *slash{std::find(p, tokenEnd, '/')};
+  if (slash != tokenEnd)
+    slash = std::find(slash + 1, tokenEnd, '/');
+  long long index{};
+  if (slash == tokenEnd ||
+      std::from_chars(slash + 1, tokenEnd, index).ec != std::errc{} ||
+      index == 0)
+    return -1;
+  return index > 0 ? index - 1 : (long long)(normalsSoFar) + index;
+}
+
+struct ObjChunk {
+  const char *begin, *end;
+  size_t positions{}, normals{}, faces{};
+};
+
+template <typename Faces>
+void countObjChunk(ObjChunk &chunk) {
+  for (auto p{chunk.begin}; p < chunk.end; p = nextLine(p, chunk.end)) {
+    switch (classify(p, chunk.end)) {
+    case ObjLine::Position:
+      ++chunk.positions;
+      break;
+    case ObjLine::Normal:
+      ++chunk.normals;
+      break;
+    case ObjLine::Face: {
+      size_t corners{};
+      for (p = skipBlanks(p, chunk.end); p < chunk.end && *p != '\n';
+           p = skipBlanks(skipToken(p, chunk.end), chunk.end))
+        ++corners;
+      chunk.faces += Faces::facesFor(corners);
+      break;
+    }
+    case ObjLine::Other:
+      break;
+    }
+  }
+}
+
+/// @brief Parses a chunk into the arrays counted for it.
+///
+/// @return Whether every corner uses the normal with the index of its
+/// position, which is the only way normals can be kept per vertex.
+template <typename Faces>
+bool parseObjChunk(const ObjChunk &chunk, const ObjChunk &offsets,
+                   size_t totalPositions, V3F *positions, V3F *normals,
+                   typename Faces::Face *faces) {
+  positions += offsets.positions;
+  faces += offsets.faces;
+  if (normals)
+    normals += offsets.normals;
+  // OBJ indices may be relative to the vertices defined so far
+  auto positionsSoFar{offsets.positions};
+  auto normalsSoFar{offsets.normals};
+  auto normalsMatch{true};
+  std::vector<size_t> corners;
+  for (auto p{chunk.begin}; p < chunk.end; p = nextLine(p, chunk.end)) {
+    switch (classify(p, chunk.end)) {
+    case ObjLine::Position:
+      positions->x = parseFloat(p, chunk.end);
+      positions->y = parseFloat(p, chunk.end);
+      positions->z = parseFloat(p, chunk.end);
+      ++positions;
+      ++positionsSoFar;
+      break;
+    case ObjLine::Normal:
+      ++normalsSoFar;
+      if (!normals)
+        break;
+      normals->x = parseFloat(p, chunk.end);
+      normals->y = parseFloat(p, chunk.end);
+      normals->z = parseFloat(p, chunk.end);
+      normals->normalize();
+      ++normals;
+      break;
+    case ObjLine::Face:
+      corners.clear();
+      for (p = skipBlanks(p, chunk.end); p < chunk.end && *p != '\n';
+           p = skipBlanks(skipToken(p, chunk.end), chunk.end)) {
+        long long index{};
+        auto [next, error]{std::from_chars(p, chunk.end, index)};
+        if (error != std::errc{} || index == 0)
+          malformed();
+        p = next;
+        const auto absolute{index > 0 ? index - 1
+                                      : (long long)(positionsSoFar) + index};
+        if (absolute < 0 || (unsigned long long)(absolute) >= totalPositions)
+          malformed();
+        corners.push_back(size_t(absolute));
+        if (normalsMatch)
+          normalsMatch = normalIndex(p, chunk.end, normalsSoFar) == absolute;
+      }
+      faces = Faces::emit(faces, corners.data(), corners.size());
+      break;
+    case ObjLine::Other:
+      break;
+    }
+  }
+  return normalsMatch;
+}
+
+template <typename Faces, typename Mesh>
+void loadObj(const MappedFile &file, Mesh &mesh) {
+  const auto *begin{file.data()}, *end{begin + file.size()};
+
+  // chunks start right after a line break, so no line is split between two
+  const auto chunks{chunkCount(file.size(), 1 << 20)};
+  std::vector<ObjChunk> counts(chunks);
+  for (size_t i{}; i < chunks; ++i) {
+    auto start{begin + chunkRange(file.size(), chunks, i).first};
+    if (i > 0 && start[-1] != '\n')
+      start = nextLine(start, end);
+    counts[i].begin = (std::max)(start, i > 0 ? counts[i - 1].begin : begin);
+  }
+  for (size_t i{}; i < chunks; ++i)
+    counts[i].end = i + 1 < chunks ? counts[i + 1].begin : end;
+
+  parallelFor(chunks, [&](size_t i) { countObjChunk<Faces>(counts[i]); });
+
+  std::vector<ObjChunk> offsets(chunks + 1, ObjChunk{});
+  for (size_t i{}; i < chunks; ++i) {
+    offsets[i + 1].positions = offsets[i].positions + counts[i].positions;
+    offsets[i + 1].normals = offsets[i].normals + counts[i].normals;
+    offsets[i + 1].faces = offsets[i].faces + counts[i].faces;
+  }
+  const auto &total{offsets[chunks]};
+  const auto keepNormals{total.normals == total.positions};
+
+  resizeMesh<Mesh, Faces>(mesh, total.positions,
+                          keepNormals ? total.normals : 0, total.faces);
+  auto *positions{mesh.vertices().data()};
+  auto *normals{keepNormals ? mesh.normals().data() : nullptr};
+  auto *faces{Faces::of(mesh).data()};
+  std::vector<char> normalsMatch(chunks);
+  parallelFor(chunks, [&](size_t i) {
+    normalsMatch[i] = parseObjChunk<Faces>(counts[i], offsets[i],
+                                           total.positions, positions,
+                                           normals, faces);
+  });
+  // normals paired with corners some other way can't be kept per vertex
+  if (std::find(normalsMatch.begin(), normalsMatch.end(), false) !=
+      normalsMatch.end())
+    std::vector<V3F>{}.swap(mesh.normals());
+}
+
+// ---------------------------------------------------------------------------
+// PLY
+// ---------------------------------------------------------------------------
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float, Double };
+
+size_t sizeOf(PlyType type) {
+  switch (type) {
+  case PlyType::Int8:
+  case PlyType::UInt8:
+    return 1;
+  case PlyType::Int16:
+  case PlyType::UInt16:
+    return 2;
+  case PlyType::Int32:
+  case PlyType::UInt32:
+  case PlyType::Float:
+    return 4;
+  case PlyType::Double:
+    return 8;
+  }
+  return 0;
+}
+
+PlyType parsePlyType(const std::string &name) {
+  if (name == "char" || name == "int8")
+    return PlyType::Int8;
+  if (name == "uchar" || name == "uint8")
+    return PlyType::UInt8;
+  if (name == "short" || name == "int16")
+    return PlyType::Int16;
+  if (name == "ushort" || name == "uint16")
+    return PlyType::UInt16;
+  if (name == "int" || name == "int32")
+    return PlyType::Int32;
+  if (name == "uint" || name == "uint32")
+    return PlyType::UInt32;
+  if (name == "float" || name == "float32")
+    return PlyType::Float;
+  if (name == "double" || name == "float64")
+    return PlyType::Double;
+  malformed();
+}
+
+struct PlyProperty {
+  std::string name;
+  PlyType type;
+  bool isList{};
+  PlyType countType{};
+};
+
+struct PlyElement {
+  std::string name;
+  size_t count{};
+  std::vector<PlyProperty> properties;
+};
+
+struct PlyHeader {
+  bool swapBytes{};
+  size_t dataOffset{};
+  std::vector<PlyElement> elements;
+};
+
+/// @brief Reads a value of the given PLY type and converts it to T.
+template <typename T> T readPly(const char *p, PlyType type, bool swap) {
+  // the size is known at compile time in every case, which lets the copies
+  // be single loads
+  auto as{[&]<typename U>(U) {
+    char bytes[sizeof(U)];
+    std::memcpy(bytes, p, sizeof(U));
+    if (swap)
+      std::reverse(bytes, bytes + sizeof(U));
+    U value;
+    std::memcpy(&value, bytes, sizeof(U));
+    return T(value);
+  }};
+  switch (type) {
+  case PlyType::Int8:
+    return as(int8_t{});
+  case PlyType::UInt8:
+    return as(uint8_t{});
+  case PlyType::Int16:
+    return as(int16_t{});
+  case PlyType::UInt16:
+    return as(uint16_t{});
+  case PlyType::Int32:
+    return as(int32_t{});
+  case PlyType::UInt32:
+    return as(uint32_t{});
+  case PlyType::Float:
+    return as(float{});
+  case PlyType::Double:
+    return as(double{});
+  }
+  return T{};
+}
+
+std::vector<std::string> splitWords(const char *begin, const char *end) {
+  std::vector<std::string> words;
+  for (auto p{skipBlanks(begin, end)}; p < end;) {
+    auto wordEnd{skipToken(p, end)};
+    words.emplace_back(p, wordEnd);
+    p = skipBlanks(wordEnd, end);
+  }
+  return words;
+}
+
+PlyHeader parsePlyHeader(const MappedFile &file) {
+  const auto *begin{file.data()}, *end{begin + file.size()};
+  PlyHeader header;
+  auto p{begin};
+  auto lineEnd{[&] {
+    auto next{nextLine(p, end)};
+    return next > p && next[-1] == '\n' ? next - 1 : next;
+  }};
+
+  if (splitWords(p, lineEnd()) != std::vector<std::string>{"ply"})
+    throw RuntimeError<UnsupportedMeshFormat>{};
+  for (p = nextLine(p, end); p < end; p = nextLine(p, end)) {
+    const auto words{splitWords(p, lineEnd())};
+    if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+      continue;
+    if (words[0] == "end_header") {
+      header.dataOffset = size_t(nextLine(p, end) - begin);
+      return header;
+    }
+    if (words[0] == "format" && words.size() >= 2) {
+      const auto littleEndian{std::endian::native == std::endian::little};
+      if (words[1] == "binary_little_endian")
+        header.swapBytes = !littleEndian;
+      else if (words[1] == "binary_big_endian")
+        header.swapBytes = littleEndian;
+      else
+        throw RuntimeError<UnsupportedMeshFormat>{};
+    } else if (words[0] == "element" && words.size() == 3) {
+      PlyElement element{words[1], 0, {}};
+      auto [next, error]{std::from_chars(
+          words[2].data(), words[2].data() + words[2].size(), element.count)};
+      if (error != std::errc{})
+        malformed();
+      header.elements.push_back(std::move(element));
+    } else if (words[0] == "property" && !header.elements.empty()) {
+      auto &properties{header.elements.back().properties};
+      if (words.size() == 5 && words[1] == "list")
+        properties.push_back({words[4], parsePlyType(words[3]), true,
+                              parsePlyType(words[2])});
+      else if (words.size() == 3)
+        properties.push_back({words[2], parsePlyType(words[1])});
+      else
+        malformed();
+    } else {
+      malformed();
+    }
+  }
+  malformed();
+}
+
+bool hasProperty(const PlyElement &element, const char *name) {
+  return std::any_of(
+      element.properties.begin(), element.properties.end(),
+      [&](const auto &property) { return property.name == name; });
+}
+
+/// @brief Returns the size of one item of an element whose properties are all
+/// scalars, or 0 if it has lists.
+size_t fixedStride(const PlyElement &element) {
+  size_t stride{};
+  for (const auto &property : element.properties) {
+    if (property.isList)
+      return 0;
+    stride += sizeOf(property.type);
+  }
+  return stride;
+}
+
+/// @brief Skips one item of an element, returning where the next one starts.
+/// If the item has a vertex index list, its length is stored in corners.
+const char *skipPlyItem(const PlyElement &element, const char *p,
+                        const char *end, bool swap, size_t *corners) {
+  for (const auto &property : element.properties) {
+    if (!property.isList) {
+      p += sizeOf(property.type);
+      continue;
+    }
+    if (p + sizeOf(property.countType) > end)
+      malformed();
+    const auto count{readPly<size_t>(p, property.countType, swap)};
+    if (corners && (property.name == "vertex_indices" ||
+                    property.name == "vertex_index"))
+      *corners = count;
+    p += sizeOf(property.countType) + count * sizeOf(property.type);
+  }
+  if (p > end)
+    malformed();
+  return p;
+}
+
+template <typename Mesh>
+void loadPlyVertices(const PlyHeader &header, const PlyElement &element,
+                     const char *data, const char *end, Mesh &mesh) {
+  const auto stride{fixedStride(element)};
+  if (stride == 0)
+    throw RuntimeError<UnsupportedMeshFormat>{};
+  if (size_t(end - data) < element.count * stride)
+    malformed();
+
+  struct Field {
+    size_t offset{};
+    PlyType type{};
+    bool found{};
+  } fields[6];
+  static constexpr const char *names[6]{"x", "y", "z", "nx", "ny", "nz"};
+  size_t offset{};
+  for (const auto &property : element.properties) {
+    for (size_t i{}; i < 6; ++i)
+      if (property.name == names[i])
+        fields[i] = {offset, property.type, true};
+    offset += sizeOf(property.type);
+  }
+  if (!fields[0].found || !fields[1].found || !fields[2].found)
+    malformed();
+  const auto hasNormals{fields[3].found && fields[4].found && fields[5].found};
+
+  auto *positions{mesh.vertices().data()};
+  auto *normals{hasNormals ? mesh.normals().data() : nullptr};
+  const auto chunks{chunkCount(element.count, 1 << 16)};
+  parallelFor(chunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(element.count, chunks, chunk)};
+    for (auto i{first}; i < last; ++i) {
+      const auto *item{data + i * stride};
+      auto read{[&](const Field &field) {
+        return readPly<float>(item + field.offset, field.type,
+                              header.swapBytes);
+      }};
+      positions[i] = {read(fields[0]), read(fields[1]), read(fields[2])};
+      if (normals)
+        normals[i] =
+            V3F{read(fields[3]), read(fields[4]), read(fields[5])}.normalized();
+    }
+  });
+}
+
+template <typename Faces, typename Mesh>
+void loadPly(const MappedFile &file, Mesh &mesh) {
+  const auto header{parsePlyHeader(file)};
+  const auto *end{file.data() + file.size()};
+
+  const PlyElement *vertexElement{}, *faceElement{};
+  for (const auto &element : header.elements) {
+    if (element.name == "vertex")
+      vertexElement = &element;
+    else if (element.name == "face")
+      faceElement = &element;
+  }
+  if (!vertexElement)
+    malformed();
+  const auto vertexCount{vertexElement->count};
+  const auto hasNormals{hasProperty(*vertexElement, "nx") &&
+                        hasProperty(*vertexElement, "ny") &&
+                        hasProperty(*vertexElement, "nz")};
+
+  // face lists have variable lengths, so faces can't be located without
+  // walking them. that walk is cheap, though, and it only records where every
+  // block of faces starts so that the blocks can be decoded in parallel
+  static constexpr size_t faceBlockSize{4096};
+  struct FaceBlock {
+    const char *data;
+    size_t firstOutput;
+  };
+  std::vector<FaceBlock> faceBlocks;
+  const char *vertexData{};
+  size_t faceCount{};
+  auto p{file.data() + header.dataOffset};
+  for (const auto &element : header.elements) {
+    if (&element == vertexElement)
+      vertexData = p;
+    if (auto stride{fixedStride(element)}) {
+      if (size_t(end - p) < element.count * stride)
+        malformed();
+      p += element.count * stride;
+      continue;
+    }
+    for (size_t i{}; i < element.count; ++i) {
+      if (&element == faceElement && i % faceBlockSize == 0)
+        faceBlocks.push_back({p, faceCount});
+      size_t corners{};
+      p = skipPlyItem(element, p, end, header.swapBytes, &corners);
+      if (&element == faceElement)
+        faceCount += Faces::facesFor(corners);
+    }
+  }
+
+  resizeMesh<Mesh, Faces>(mesh, vertexCount, hasNormals ? vertexCount : 0,
+                          faceCount);
+  loadPlyVertices(header, *vertexElement, vertexData, end, mesh);
+  if (!faceElement || faceBlocks.empty())
+    return;
+
+  auto *faces{Faces::of(mesh).data()};
+  const auto chunks{chunkCount(faceBlocks.size())};
+  parallelFor(chunks, [&](size_t chunk) {
+    auto [firstBlock, lastBlock]{chunkRange(faceBlocks.size(), chunks, chunk)};
+    std::vector<size_t> corners;
+    for (auto block{firstBlock}; block < lastBlock; ++block) {
+      auto item{faceBlocks[block].data};
+      auto *out{faces + faceBlocks[block].firstOutput};
+      const auto firstFace{block * faceBlockSize};
+      const auto lastFace{(std::min)(firstFace + faceBlockSize,
+                                     faceElement->count)};
+      for (auto face{firstFace}; face < lastFace; ++face) {
+        corners.clear();
+        for (const auto &property : faceElement->properties) {
+          if (!property.isList) {
+            item += sizeOf(property.type);
+            continue;
+          }
+          const auto count{
+              readPly<size_t>(item, property.countType, header.swapBytes)};
+          item += sizeOf(property.countType);
+          const auto isIndexList{property.name == "vertex_indices" ||
+                                 property.name == "vertex_index"};
+          for (size_t i{}; isIndexList && i < count; ++i) {
+            const auto index{readPly<long long>(
+                item + i * sizeOf(property.type), property.type,
+                header.swapBytes)};
+            if (index < 0 || (unsigned long long)(index) >= vertexCount)
+              malformed();
+            corners.push_back(size_t(index));
+          }
+          item += count * sizeOf(property.type);
+        }
+        out = Faces::emit(out, corners.data(), corners.size());
+      }
+    }
+  });
+}
+
+template <typename Faces, typename Mesh>
+void load(const std::string &path, Mesh &mesh) {
+  const auto isObj{hasExtension(path, ".obj")};
+  if (!isObj && !hasExtension(path, ".ply"))
+    throw RuntimeError<UnsupportedMeshFormat>{};
+  const MappedFile file{path};
+  if (isObj)
+    loadObj<Faces>(file, mesh);
+  else
+    loadPly<Faces>(file, mesh);
+}
+
+/// @brief Appends numbers and text to a buffer that's written out in one go.
+class ObjWriter {
+public:
+  ObjWriter &operator<<(const char *text) {
+    buffer_ += text;
+    return *this;
+  }
+
+  template <typename T> ObjWriter &operator<<(T value) {
+    char digits[32];
+    const auto end{std::to_chars(digits, digits + sizeof digits, value).ptr};
+    buffer_.append(digits, end);
+    return *this;
+  }
+
+  void writeVectors(const char *tag, const std::vector<V3F> &vectors) {
+    for (const auto &v : vectors)
+      *this << tag << v.x << " " << v.y << " " << v.z << "\n";
+  }
+
+  void save(const std::string &path) const {
+    auto *file{std::fopen(path.c_str(), "wb")};
+    if (!file)
+      throw RuntimeError<CouldNotOpenFile>{};
+    const auto written{std::fwrite(buffer_.data(), 1, buffer_.size(), file)};
+    if (std::fclose(file) != 0 || written != buffer_.size())
+      throw RuntimeError<CouldNotOpenFile>{};
+  }
+
+private:
+  std::string buffer_;
+};
+
+/// @brief Writes the vertices (and normals, if there's one per vertex) that
+/// both kinds of meshes share, and tells whether faces should refer to normals.
+template <typename Mesh>
+bool writeObjVertices(ObjWriter &out, const Mesh &mesh) {
+  out.writeVectors("v ", mesh.vertices());
+  const auto withNormals{!mesh.normals().empty() &&
+                         mesh.normals().size() == mesh.vertices().size()};
+  if (withNormals)
+    out.writeVectors("vn ", mesh.normals());
+  return withNormals;
+}
+
+void writeObjCorner(ObjWriter &out, size_t vertex, bool withNormals) {
+  // obj indices start at 1
+  out << " " << vertex + 1;
+  if (withNormals)
+    out << "//" << vertex + 1;
+}
+
+} // namespace
+
+void loadMesh(const std::string &path, TriangleMesh &mesh) {
+  load<TriangleFaces>(path, mesh);
+}
+
+void loadMesh(const std::string &path, QuadMesh &mesh) {
+  load<QuadFaces>(path, mesh);
+}
+
+void saveMesh(const std::string &path, const TriangleMesh &mesh) {
+  if (!hasExtension(path, ".obj"))
+    throw RuntimeError<UnsupportedMeshFormat>{};
+  ObjWriter out;
+  const auto withNormals{writeObjVertices(out, mesh)};
+  for (const auto &triangle : mesh.triangles()) {
+    out << "f";
+    for (auto v : {triangle.v1, triangle.v2, triangle.v3})
+      writeObjCorner(out, v, withNormals);
+    out << "\n";
+  }
+  out.save(path);
+}
+
+void saveMesh(const std::string &path, const QuadMesh &mesh) {
+  if (!hasExtension(path, ".obj"))
+    throw RuntimeError<UnsupportedMeshFormat>{};
+  ObjWriter out;
+  const auto withNormals{writeObjVertices(out, mesh)};
+  for (const auto &quad : mesh.faces()) {
+    out << "f";
+    for (auto v : {quad.v1, quad.v2, quad.v3})
+      writeObjCorner(out, v, withNormals);
+    if (quad.v4 != quad.v1)
+      writeObjCorner(out, quad.v4, withNormals);
+    out << "\n";
+  }
+  out.save(path);
+}
+
+} // namespace vbag
@@ -0,0 +1,235 @@
+#include "graphics/mesh_normals.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <numbers>
+#include <vector>
+
+#include "util/job_system.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief How many faces or vertices a chunk gets at the very least.
+constexpr size_t minChunkSize{1 << 12};
+
+/// @brief The corners of the triangles of a TriangleMesh.
+struct TriangleCorners {
+  using Face = TriangleMesh::Triangle;
+
+  static constexpr size_t Face::*corners[]{&Face::v1, &Face::v2, &Face::v3};
+
+  static auto &of(TriangleMesh &mesh) { return mesh.triangles(); }
+
+  /// @brief Twice the area of the face, in the direction of its normal.
+  static V3F areaVector(const std::vector<V3F> &vertices, const Face &face) {
+    const auto &a{vertices[face.v1]};
+    return (vertices[face.v2] - a).cross(vertices[face.v3] - a);
+  }
+};
+
+/// @brief The corners of the quads of a QuadMesh.
+struct QuadCorners {
+  using Face = QuadMesh::Quad;
+
+  static constexpr size_t Face::*corners[]{&Face::v1, &Face::v2, &Face::v3,
+                                           &Face::v4};
+
+  static auto &of(QuadMesh &mesh) { return mesh.faces(); }
+
+  /// @brief Twice the area of the face, in the direction of its normal. This
+  /// also holds for degenerate quads, where v4 is v1.
+  static V3F areaVector(const std::vector<V3F> &vertices, const Face &face) {
+    return (vertices[face.v3] - vertices[face.v1])
+        .cross(vertices[face.v4] - vertices[face.v2]);
+  }
+};
+
+/// @brief Like V3F::normalized, but without the epsilon, since the faces of
+/// dense meshes are easily smaller than it.
+V3F unit(const V3F &v) {
+  const auto length{std::sqrt(v.dot(v))};
+  return length > 0 ? v / length : V3F{};
+}
+
+/// @brief Whether a corner repeats a vertex that comes before it (like v4 of
+/// degenerate quads), in which case it doesn't count.
+template <size_t count>
+bool isRepeated(const std::array<size_t, count> &ids, size_t corner) {
+  const auto end{ids.begin() + corner};
+  return std::find(ids.begin(), end, ids[corner]) != end;
+}
+
+/// @brief The angle of a face at one of its corners, or 0 if the corner is
+/// repeated.
+template <size_t count>
+float cornerAngle(const std::vector<V3F> &vertices,
+                  const std::array<size_t, count> &ids, size_t corner) {
+  const auto v{ids[corner]};
+  if (isRepeated(ids, corner))
+    return 0;
+  // the closest corners on either side that are actually different vertices
+  auto previous{v}, next{v};
+  for (size_t step{1}; step < count && previous == v; ++step)
+    previous = ids[(corner + count - step) % count];
+  for (size_t step{1}; step < count && next == v; ++step)
+    next = ids[(corner + step) % count];
+  if (previous == next)
+    return 0;
+  const auto cosine{unit(vertices[next] - vertices[v])
+                        .dot(unit(vertices[previous] - vertices[v]))};
+  return std::acos(std::clamp(cosine, -1.0f, 1.0f));
+}
+
+template <typename Traits, typename Mesh>
+void compute(Mesh &mesh, JobSystem &jobs, NormalWeighting weighting,
+             float creaseAngle) {
+  static constexpr auto cornersPerFace{std::size(Traits::corners)};
+  auto &faces{Traits::of(mesh)};
+  auto &vertices{mesh.vertices()};
+  auto &faceNormals{mesh.faceNormals()};
+  const auto faceCount{faces.size()}, vertexCount{vertices.size()};
+  const auto cornerCount{faceCount * cornersPerFace};
+
+  // face normals, and how much each corner weighs in its vertex's normal
+  faceNormals.resize(faceCount);
+  std::vector<float> weights(cornerCount);
+  auto chunks{jobs.chunkCount(faceCount, minChunkSize)};
+  jobs.parallelFor(chunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(faceCount, chunks, chunk)};
+    for (auto f{first}; f < last; ++f) {
+      const auto &face{faces[f]};
+      std::array<size_t, cornersPerFace> ids;
+      for (size_t i{}; i < cornersPerFace; ++i)
+        ids[i] = face.*Traits::corners[i];
+      const auto area{Traits::areaVector(vertices, face)};
+      const auto length{std::sqrt(area.dot(area))};
+      faceNormals[f] = length > 0 ? area / length : V3F{};
+      for (size_t i{}; i < cornersPerFace; ++i)
+        weights[f * cornersPerFace + i] =
+            weighting == NormalWeighting::Angle ? cornerAngle(vertices, ids, i)
+            : isRepeated(ids, i)                ? 0.0f
+                                                : length;
+    }
+  });
+
+  // the corners around every vertex, in face order
+  std::vector<uint32_t> offsets(vertexCount + 1), adjacency(cornerCount);
+  for (const auto &face : faces)
+    for (auto corner : Traits::corners)
+      ++offsets[face.*corner + 1];
+  for (size_t v{}; v < vertexCount; ++v)
+    offsets[v + 1] += offsets[v];
+  {
+    auto cursor{offsets};
+    for (size_t c{}; c < cornerCount; ++c) {
+      const auto &face{faces[c / cornersPerFace]};
+      adjacency[cursor[face.*Traits::corners[c % cornersPerFace]]++] =
+          uint32_t(c);
+    }
+  }
+
+  auto &normals{mesh.normals()};
+  chunks = jobs.chunkCount(vertexCount, minChunkSize);
+  if (creaseAngle >= 180) {
+    normals.resize(vertexCount);
+    jobs.parallelFor(chunks, [&](size_t chunk) {
+      auto [first, last]{chunkRange(vertexCount, chunks, chunk)};
+      for (auto v{first}; v < last; ++v) {
+        V3F sum{};
+        for (auto i{offsets[v]}; i < offsets[v + 1]; ++i) {
+          const auto c{adjacency[i]};
+          sum += faceNormals[c / cornersPerFace] * weights[c];
+        }
+        normals[v] = unit(sum);
+      }
+    });
+    return;
+  }
+
+  // with creases, every corner only smooths with the corners of its vertex
+  // whose faces are close enough to its own. corners of the same vertex that
+  // end up with the same normal share a group, and every group becomes a
+  // vertex of its own
+  const auto minCosine{
+      std::cos(creaseAngle * (std::numbers::pi_v<float> / 180.0f))};
+  std::vector<V3F> cornerNormals(cornerCount);
+  std::vector<uint32_t> groups(cornerCount), groupCounts(vertexCount + 1);
+  jobs.parallelFor(chunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(vertexCount, chunks, chunk)};
+    for (auto v{first}; v < last; ++v) {
+      uint32_t groupCount{};
+      for (auto i{offsets[v]}; i < offsets[v + 1]; ++i) {
+        const auto c{adjacency[i]};
+        const auto &own{faceNormals[c / cornersPerFace]};
+        V3F sum{};
+        for (auto j{offsets[v]}; j < offsets[v + 1]; ++j) {
+          const auto other{adjacency[j]};
+          const auto &normal{faceNormals[other / cornersPerFace]};
+          if (normal.dot(own) >= minCosine)
+            sum += normal * weights[other];
+        }
+        cornerNormals[c] = unit(sum);
+        groups[c] = groupCount;
+        for (auto j{offsets[v]}; j < i; ++j) {
+          const auto &earlier{cornerNormals[adjacency[j]]};
+          if (earlier.x == cornerNormals[c].x &&
+              earlier.y == cornerNormals[c].y &&
+              earlier.z == cornerNormals[c].z) {
+            groups[c] = groups[adjacency[j]];
+            break;
+          }
+        }
+        if (groups[c] == groupCount)
+          ++groupCount;
+      }
+      // unreferenced vertices are kept as they are
+      groupCounts[v + 1] = (std::max)(groupCount, 1u);
+    }
+  });
+  for (size_t v{}; v < vertexCount; ++v)
+    groupCounts[v + 1] += groupCounts[v];
+
+  std::vector<V3F> splitVertices(groupCounts[vertexCount]);
+  normals.assign(splitVertices.size(), V3F{});
+  jobs.parallelFor(chunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(vertexCount, chunks, chunk)};
+    for (auto v{first}; v < last; ++v) {
+      for (auto i{groupCounts[v]}; i < groupCounts[v + 1]; ++i)
+        splitVertices[i] = vertices[v];
+      for (auto i{offsets[v]}; i < offsets[v + 1]; ++i) {
+        const auto c{adjacency[i]};
+        normals[groupCounts[v] + groups[c]] = cornerNormals[c];
+      }
+    }
+  });
+  chunks = jobs.chunkCount(faceCount, minChunkSize);
+  jobs.parallelFor(chunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(faceCount, chunks, chunk)};
+    for (auto f{first}; f < last; ++f) {
+      for (size_t i{}; i < cornersPerFace; ++i) {
+        auto &v{faces[f].*Traits::corners[i]};
+        v = groupCounts[v] + groups[f * cornersPerFace + i];
+      }
+    }
+  });
+  vertices = std::move(splitVertices);
+}
+
+} // namespace
+
+void computeNormals(TriangleMesh &mesh, JobSystem &jobs,
+                    NormalWeighting weighting, float creaseAngle) {
+  compute<TriangleCorners>(mesh, jobs, weighting, creaseAngle);
+}
+
+void computeNormals(QuadMesh &mesh, JobSystem &jobs,
+                    NormalWeighting weighting, float creaseAngle) {
+  compute<QuadCorners>(mesh, jobs, weighting, creaseAngle);
+}
+
+} // namespace vbag
@@ -0,0 +1,251 @@
+#include "graphics/mesh_optimizer.hpp"
+
+#include <cassert>
+#include <limits>
+
+namespace vbag {
+
+namespace {
+
+/// @brief Triangles incident to each vertex, stored contiguously (CSR).
+struct VertexAdjacency {
+  std::vector<size_t> offsets;   ///< Where each vertex's list starts.
+  std::vector<size_t> triangles; ///< The concatenated lists.
+};
+
+VertexAdjacency buildAdjacency(const TriangleMesh &mesh) {
+  const auto &triangles{mesh.triangles()};
+  VertexAdjacency adjacency;
+  adjacency.offsets.assign(mesh.vertices().size() + 1, 0);
+  for (const auto &triangle : triangles) {
+    ++adjacency.offsets[triangle.v1 + 1];
+    ++adjacency.offsets[triangle.v2 + 1];
+    ++adjacency.offsets[triangle.v3 + 1];
+  }
+  for (size_t i{1}; i < adjacency.offsets.size(); ++i)
+    adjacency.offsets[i] += adjacency.offsets[i - 1];
+  adjacency.triangles.resize(3 * triangles.size());
+  auto cursor{adjacency.offsets};
+  for (size_t t{}; t < triangles.size(); ++t) {
+    adjacency.triangles[cursor[triangles[t].v1]++] = t;
+    adjacency.triangles[cursor[triangles[t].v2]++] = t;
+    adjacency.triangles[cursor[triangles[t].v3]++] = t;
+  }
+  return adjacency;
+}
+
+} // namespace
+
+void optimizeVertexCache(TriangleMesh &mesh, size_t cacheSize) {
+  auto &triangles{mesh.triangles()};
+  const auto vertexCount{mesh.vertices().size()};
+  if (triangles.empty() || vertexCount == 0)
+    return;
+
+  const auto adjacency{buildAdjacency(mesh)};
+  std::vector<size_t> live(vertexCount), cacheTime(vertexCount);
+  for (size_t v{}; v < vertexCount; ++v)
+    live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  std::vector<bool> emitted(triangles.size());
+  std::vector<size_t> deadEnd, candidates;
+  std::vector<size_t> order;
+  order.reserve(triangles.size());
+
+  static constexpr auto none{std::numeric_limits<size_t>::max()};
+  size_t fanningVertex{}, time{cacheSize + 1}, cursor{1};
+  while (fanningVertex != none) {
+    candidates.clear();
+    for (auto i{adjacency.offsets[fanningVertex]};
+         i < adjacency.offsets[fanningVertex + 1]; ++i) {
+      const auto t{adjacency.triangles[i]};
+      if (emitted[t])
+        continue;
+      emitted[t] = true;
+      order.push_back(t);
+      for (auto v : {triangles[t].v1, triangles[t].v2, triangles[t].v3}) {
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - cacheTime[v] > cacheSize)
+          cacheTime[v] = time++;
+      }
+    }
+
+    // picks the candidate that will still be in the cache once its remaining
+    // triangles are emitted, preferring the oldest one
+    fanningVertex = none;
+    long long bestPriority{-1};
+    for (auto v : candidates) {
+      if (live[v] == 0)
+        continue;
+      long long priority{};
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+        priority = static_cast<long long>(time - cacheTime[v]);
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        fanningVertex = v;
+      }
+    }
+    if (fanningVertex != none)
+      continue;
+
+    // dead end, so we go back to recently used vertices and, failing that,
+    // to the next vertex in input order that still has triangles left
+    while (!deadEnd.empty() && fanningVertex == none) {
+      const auto v{deadEnd.back()};
+      deadEnd.pop_back();
+      if (live[v] > 0)
+        fanningVertex = v;
+    }
+    while (fanningVertex == none && cursor < vertexCount) {
+      if (live[cursor] > 0)
+        fanningVertex = cursor;
+      ++cursor;
+    }
+  }
+
+  std::vector<TriangleMesh::Triangle> result;
+  result.reserve(triangles.size());
+  for (auto t : order)
+    result.push_back(triangles[t]);
+  triangles = std::move(result);
+  // face normals follow their triangles
+  auto &faceNormals{mesh.faceNormals()};
+  if (faceNormals.size() == triangles.size()) {
+    std::vector<V3F> reordered;
+    reordered.reserve(faceNormals.size());
+    for (auto t : order)
+      reordered.push_back(faceNormals[t]);
+    faceNormals = std::move(reordered);
+  }
+}
+
+void optimizeVertexFetch(TriangleMesh &mesh) {
+  auto &vertices{mesh.vertices()};
+  auto &normals{mesh.normals()};
+  static constexpr auto unassigned{std::numeric_limits<size_t>::max()};
+  std::vector<size_t> remap(vertices.size(), unassigned);
+  size_t next{};
+  for (auto &triangle : mesh.triangles()) {
+    for (auto *index : {&triangle.v1, &triangle.v2, &triangle.v3}) {
+      if (remap[*index] == unassigned)
+        remap[*index] = next++;
+      *index = remap[*index];
+    }
+  }
+  for (auto &index : remap)
+    if (index == unassigned)
+      index = next++;
+
+  std::vector<V3F> reordered(vertices.size());
+  for (size_t v{}; v < vertices.size(); ++v)
+    reordered[remap[v]] = vertices[v];
+  vertices.swap(reordered);
+  // normals are only meaningful here if there is one per vertex
+  if (normals.size() == reordered.size()) {
+    for (size_t v{}; v < normals.size(); ++v)
+      reordered[remap[v]] = normals[v];
+    normals.swap(reordered);
+  }
+}
+
+void optimizeMesh(TriangleMesh &mesh) {
+  optimizeVertexCache(mesh);
+  optimizeVertexFetch(mesh);
+}
+
+MeshletSet buildMeshlets(const TriangleMesh &mesh, size_t maxVertices,
+                         size_t maxTriangles) {
+  assert(maxVertices >= 3 && maxVertices <= 255);
+  assert(maxTriangles >= 1 && maxTriangles <= 255);
+  const auto &vertices{mesh.vertices()};
+  const auto &triangles{mesh.triangles()};
+
+  MeshletSet set;
+  set.vertices.reserve(triangles.size() * 3);
+  set.triangles.reserve(triangles.size() * 3);
+
+  static constexpr uint8_t notInMeshlet{0xFF};
+  std::vector<uint8_t> localIndex(vertices.size(), notInMeshlet);
+  Meshlet current{};
+
+  auto finish{[&] {
+    if (current.triangleCount == 0)
+      return;
+    const auto *meshletVertices{set.vertices.data() + current.vertexOffset};
+    const auto *meshletTriangles{set.triangles.data() +
+                                 current.triangleOffset};
+
+    // bounding sphere around the center of the bounding box
+    auto lo{vertices[meshletVertices[0]]}, hi{lo};
+    for (size_t i{1}; i < current.vertexCount; ++i) {
+      const auto &p{vertices[meshletVertices[i]]};
+      lo = {(min)(lo.x, p.x), (min)(lo.y, p.y), (min)(lo.z, p.z)};
+      hi = {(max)(hi.x, p.x), (max)(hi.y, p.y), (max)(hi.z, p.z)};
+    }
+    current.center = (lo + hi) / 2;
+    current.radius = 0;
+    for (size_t i{}; i < current.vertexCount; ++i)
+      current.radius = (max)(current.radius,
+                             (vertices[meshletVertices[i]] - current.center)
+                                 .magnitude());
+
+    // normal cone, which is only useful if all normals are within 90 degrees
+    // of the axis
+    std::vector<V3F> faceNormals(current.triangleCount);
+    V3F axis{};
+    for (size_t t{}; t < current.triangleCount; ++t) {
+      const auto &a{vertices[meshletVertices[meshletTriangles[3 * t]]]};
+      const auto &b{vertices[meshletVertices[meshletTriangles[3 * t + 1]]]};
+      const auto &c{vertices[meshletVertices[meshletTriangles[3 * t + 2]]]};
+      faceNormals[t] = (b - a).cross(c - a).normalized();
+      axis += faceNormals[t];
+    }
+    current.coneAxis = axis.normalized();
+    auto minDot{1.0f};
+    for (const auto &normal : faceNormals)
+      minDot = (min)(minDot, normal.dot(current.coneAxis));
+    current.coneCutoff =
+        minDot <= 0 || current.coneAxis.isZero()
+            ? 2.0f
+            : std::sqrt(1 - minDot * minDot);
+
+    set.meshlets.push_back(current);
+    for (size_t i{}; i < current.vertexCount; ++i)
+      localIndex[meshletVertices[i]] = notInMeshlet;
+    current = {};
+    current.vertexOffset = uint32_t(set.vertices.size());
+    current.triangleOffset = uint32_t(set.triangles.size());
+  }};
+
+  for (const auto &triangle : triangles) {
+    size_t newVertices{};
+    for (auto v : {triangle.v1, triangle.v2, triangle.v3})
+      newVertices += localIndex[v] == notInMeshlet;
+    if (current.vertexCount + newVertices > maxVertices ||
+        current.triangleCount + 1u > maxTriangles)
+      finish();
+    for (auto v : {triangle.v1, triangle.v2, triangle.v3}) {
+      if (localIndex[v] == notInMeshlet) {
+        localIndex[v] = current.vertexCount++;
+        set.vertices.push_back(uint32_t(v));
+      }
+      set.triangles.push_back(localIndex[v]);
+    }
+    ++current.triangleCount;
+  }
+  finish();
+
+  return set;
+}
+
+bool isMeshletBackfacing(const Meshlet &meshlet, const V3F &cameraPosition) {
+  const auto view{meshlet.center - cameraPosition};
+  const auto distance{view.magnitude()};
+  if (distance <= meshlet.radius)
+    return false;
+  return view.dot(meshlet.coneAxis) >=
+         meshlet.coneCutoff * distance + meshlet.radius;
+}
+
+} // namespace vbag
@@ -0,0 +1,498 @@
+#include "graphics/mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "util/parallel.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief A symmetric 4x4 matrix holding the sum of squared distances to a
+/// set of planes, stored as its upper triangle.
+struct Quadric {
+  double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+  static Quadric fromPlane(double a, double b, double c, double d,
+                           double weight = 1) {
+    return {weight * a * a, weight * a * b, weight * a * c, weight * a * d,
+            weight * b * b, weight * b * c, weight * b * d, weight * c * c,
+            weight * c * d, weight * d * d};
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+    b2 += other.b2, bc += other.bc, bd += other.bd;
+    c2 += other.c2, cd += other.cd, d2 += other.d2;
+    return *this;
+  }
+
+  Quadric operator+(const Quadric &other) const {
+    auto result{*this};
+    return result += other;
+  }
+
+  [[nodiscard]] double evaluate(const V3F &p) const {
+    const double x{p.x}, y{p.y}, z{p.z};
+    return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+           b2 * y * y + 2 * bc * y * z + 2 * bd * y + c2 * z * z +
+           2 * cd * z + d2;
+  }
+
+  /// @brief Finds the point where the error is the smallest, if the system is
+  /// well conditioned.
+  bool minimize(V3F &p) const {
+    const auto det{a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) +
+                   ac * (ab * bc - b2 * ac)};
+    const auto scale{(std::max)({a2, b2, c2})};
+    if (std::abs(det) <= 1e-9 * scale * scale * scale)
+      return false;
+    // cramer's rule on A p = -b
+    const auto bx{-ad}, by{-bd}, bz{-cd};
+    p.x = float((bx * (b2 * c2 - bc * bc) - ab * (by * c2 - bc * bz) +
+                 ac * (by * bc - b2 * bz)) /
+                det);
+    p.y = float((a2 * (by * c2 - bz * bc) - bx * (ab * c2 - bc * ac) +
+                 ac * (ab * bz - by * ac)) /
+                det);
+    p.z = float((a2 * (b2 * bz - bc * by) - ab * (ab * bz - by * ac) +
+                 bx * (ab * bc - b2 * ac)) /
+                det);
+    return true;
+  }
+};
+
+using Face = std::array<uint32_t, 3>;
+
+/// @brief The plane of a face of the original mesh.
+struct Plane {
+  V3F normal;
+  float offset;
+
+  [[nodiscard]] float distance(const V3F &p) const {
+    return std::abs(normal.dot(p) + offset);
+  }
+};
+
+/// @brief Like V3F::normalized, but without the epsilon, since the triangles
+/// of dense meshes are easily smaller than it.
+V3F unit(const V3F &v) {
+  const auto length{std::sqrt(v.dot(v))};
+  return length > 0 ? v / length : V3F{};
+}
+
+/// @brief How much more boundary planes weigh than regular ones.
+constexpr double boundaryWeight{1000};
+
+struct Collapse {
+  double cost;
+  uint32_t a, b;
+  uint32_t versionA, versionB;
+
+  bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+class Simplifier {
+public:
+  Simplifier(std::vector<V3F> positions, std::vector<Face> faces)
+      : positions_{std::move(positions)}, faces_{std::move(faces)},
+        quadrics_(positions_.size()), facePlanes_(faces_.size()),
+        vertexFaces_(positions_.size()), originalFaces_(positions_.size()),
+        rejected_(positions_.size()), versions_(positions_.size()),
+        removed_(positions_.size()), faceRemoved_(faces_.size()),
+        liveFaces_{faces_.size()} {}
+
+  void prepare(bool preserveBoundary) {
+    for (uint32_t f{}; f < faces_.size(); ++f)
+      for (auto v : faces_[f])
+        vertexFaces_[v].push_back(f);
+    originalFaces_ = vertexFaces_;
+
+    // plane quadrics of every face, then summed per vertex. each vertex sums
+    // its own faces in order, so the result doesn't depend on the threads
+    std::vector<Quadric> faceQuadrics(faces_.size());
+    auto chunks{chunkCount(faces_.size(), 1 << 14)};
+    parallelFor(chunks, [&](size_t chunk) {
+      auto [first, last]{chunkRange(faces_.size(), chunks, chunk)};
+      for (auto f{first}; f < last; ++f) {
+        const auto normal{faceNormal(faces_[f])};
+        const auto &p{positions_[faces_[f][0]]};
+        facePlanes_[f] = {normal, -normal.dot(p)};
+        faceQuadrics[f] = Quadric::fromPlane(normal.x, normal.y, normal.z,
+                                             facePlanes_[f].offset);
+      }
+    });
+    chunks = chunkCount(positions_.size(), 1 << 14);
+    parallelFor(chunks, [&](size_t chunk) {
+      auto [first, last]{chunkRange(positions_.size(), chunks, chunk)};
+      for (auto v{first}; v < last; ++v)
+        for (auto f : vertexFaces_[v])
+          quadrics_[v] += faceQuadrics[f];
+    });
+
+    // every edge once, along with how many faces use it
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(3 * faces_.size());
+    for (uint32_t f{}; f < faces_.size(); ++f)
+      for (size_t i{}; i < 3; ++i)
+        edges.emplace_back(edgeKey(faces_[f][i], faces_[f][(i + 1) % 3]), f);
+    std::sort(edges.begin(), edges.end());
+    std::vector<std::pair<uint32_t, uint32_t>> uniqueEdges;
+    for (size_t i{}; i < edges.size();) {
+      auto j{i + 1};
+      while (j < edges.size() && edges[j].first == edges[i].first)
+        ++j;
+      const uint32_t a(edges[i].first >> 32), b(edges[i].first);
+      uniqueEdges.emplace_back(a, b);
+      if (preserveBoundary && j - i == 1)
+        addBoundaryPlane(a, b, faces_[edges[i].second]);
+      i = j;
+    }
+
+    heap_.resize(uniqueEdges.size());
+    chunks = chunkCount(uniqueEdges.size(), 1 << 14);
+    parallelFor(chunks, [&](size_t chunk) {
+      auto [first, last]{chunkRange(uniqueEdges.size(), chunks, chunk)};
+      for (auto e{first}; e < last; ++e)
+        heap_[e] = collapseFor(uniqueEdges[e].first, uniqueEdges[e].second);
+    });
+    std::make_heap(heap_.begin(), heap_.end(), std::greater{});
+  }
+
+  SimplificationResult run(size_t targetFaces, float maxError) {
+    float worstError{};
+    while (liveFaces_ > targetFaces && !heap_.empty()) {
+      std::pop_heap(heap_.begin(), heap_.end(), std::greater{});
+      const auto collapse{heap_.back()};
+      heap_.pop_back();
+      if (removed_[collapse.a] || removed_[collapse.b] ||
+          versions_[collapse.a] != collapse.versionA ||
+          versions_[collapse.b] != collapse.versionB)
+        continue;
+      V3F target;
+      placement(collapse.a, collapse.b, target);
+      // the quadric cost orders the collapses, but it sums squared distances
+      // (and weighs boundary planes more), so the limit is checked against
+      // the actual distance. only moving a or b changes it, which queues
+      // their edges again anyway
+      const auto error{distance(collapse.a, collapse.b, target)};
+      if (error > maxError)
+        continue;
+      if (!isManifoldCollapse(collapse.a, collapse.b) ||
+          flipsFaces(collapse.a, collapse.b, target) ||
+          flipsFaces(collapse.b, collapse.a, target)) {
+        // tried again once a collapse nearby changes the neighbourhood
+        rejected_[collapse.a].push_back(collapse.b);
+        rejected_[collapse.b].push_back(collapse.a);
+        continue;
+      }
+      apply(collapse.a, collapse.b, target);
+      worstError = (std::max)(worstError, error);
+    }
+    return {liveFaces_, worstError};
+  }
+
+  /// @brief Writes the remaining vertices and faces out, dropping the unused
+  /// ones. The remap maps old vertex indices to new ones.
+  void compact(std::vector<V3F> &positions, std::vector<Face> &faces,
+               std::vector<uint32_t> &remap) const {
+    static constexpr auto unused{~uint32_t{}};
+    remap.assign(positions_.size(), unused);
+    positions.clear();
+    faces.clear();
+    faces.reserve(liveFaces_);
+    for (uint32_t f{}; f < faces_.size(); ++f) {
+      if (faceRemoved_[f])
+        continue;
+      Face face;
+      for (size_t i{}; i < 3; ++i) {
+        const auto v{faces_[f][i]};
+        if (remap[v] == unused) {
+          remap[v] = uint32_t(positions.size());
+          positions.push_back(positions_[v]);
+        }
+        face[i] = remap[v];
+      }
+      faces.push_back(face);
+    }
+  }
+
+private:
+  static uint64_t edgeKey(uint32_t a, uint32_t b) {
+    if (a > b)
+      std::swap(a, b);
+    return uint64_t(a) << 32 | b;
+  }
+
+  [[nodiscard]] V3F faceNormal(const Face &face) const {
+    const auto &a{positions_[face[0]]}, &b{positions_[face[1]]},
+        &c{positions_[face[2]]};
+    return unit((b - a).cross(c - a));
+  }
+
+  void addBoundaryPlane(uint32_t a, uint32_t b, const Face &face) {
+    const auto edge{positions_[b] - positions_[a]};
+    const auto normal{unit(edge.cross(faceNormal(face)))};
+    const auto plane{Quadric::fromPlane(normal.x, normal.y, normal.z,
+                                        -normal.dot(positions_[a]),
+                                        boundaryWeight)};
+    quadrics_[a] += plane;
+    quadrics_[b] += plane;
+  }
+
+  double placement(uint32_t a, uint32_t b, V3F &target) const {
+    const auto quadric{quadrics_[a] + quadrics_[b]};
+    const auto &pa{positions_[a]}, &pb{positions_[b]};
+    // the endpoints and the midpoint are always candidates, since the optimum
+    // may not exist (flat or linear neighbourhoods) or be badly conditioned
+    V3F candidates[4]{pa, pb, (pa + pb) / 2};
+    size_t count{3};
+    const auto reach{(pb - pa).magnitude() * 2};
+    if (quadric.minimize(candidates[3]) &&
+        (candidates[3] - candidates[2]).magnitude() <= reach)
+      count = 4;
+    auto best{std::numeric_limits<double>::infinity()};
+    for (size_t i{}; i < count; ++i) {
+      const auto cost{quadric.evaluate(candidates[i])};
+      if (cost < best) {
+        best = cost;
+        target = candidates[i];
+      }
+    }
+    return best;
+  }
+
+  /// @brief Returns the largest distance from the target to the planes of
+  /// the original faces either end of the edge stands for.
+  [[nodiscard]] float distance(uint32_t a, uint32_t b,
+                               const V3F &target) const {
+    float largest{};
+    for (auto v : {a, b})
+      for (auto f : originalFaces_[v])
+        largest = (std::max)(largest, facePlanes_[f].distance(target));
+    return largest;
+  }
+
+  [[nodiscard]] Collapse collapseFor(uint32_t a, uint32_t b) const {
+    V3F target;
+    const auto cost{placement(a, b, target)};
+    return {cost, a, b, versions_[a], versions_[b]};
+  }
+
+  void neighbours(uint32_t v, std::vector<uint32_t> &out) const {
+    out.clear();
+    for (auto f : vertexFaces_[v])
+      for (auto u : faces_[f])
+        if (u != v)
+          out.push_back(u);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  }
+
+  /// @brief The link condition: the vertices adjacent to both ends of the edge
+  /// must be exactly the opposite corners of the faces that share it.
+  bool isManifoldCollapse(uint32_t a, uint32_t b) {
+    neighbours(a, scratchA_);
+    neighbours(b, scratchB_);
+    size_t shared{};
+    for (auto i{scratchA_.begin()}, j{scratchB_.begin()};
+         i != scratchA_.end() && j != scratchB_.end();) {
+      if (*i < *j) {
+        ++i;
+      } else if (*j < *i) {
+        ++j;
+      } else {
+        ++shared, ++i, ++j;
+      }
+    }
+    size_t edgeFaces{};
+    for (auto f : vertexFaces_[a])
+      edgeFaces += std::find(faces_[f].begin(), faces_[f].end(), b) !=
+                   faces_[f].end();
+    return shared == edgeFaces;
+  }
+
+  /// @brief Checks whether moving v to the target would turn any of the faces
+  /// that survive the collapse upside down.
+  [[nodiscard]] bool flipsFaces(uint32_t v, uint32_t other,
+                                const V3F &target) const {
+    for (auto f : vertexFaces_[v]) {
+      const auto &face{faces_[f]};
+      if (std::find(face.begin(), face.end(), other) != face.end())
+        continue;
+      auto moved{face};
+      std::array<V3F, 3> corners;
+      for (size_t i{}; i < 3; ++i)
+        corners[i] = moved[i] == v ? target : positions_[moved[i]];
+      const auto after{
+          (corners[1] - corners[0]).cross(corners[2] - corners[0])};
+      if (unit(after).dot(faceNormal(face)) < 0.2f)
+        return true;
+    }
+    return false;
+  }
+
+  void detach(uint32_t v, uint32_t f) {
+    auto &list{vertexFaces_[v]};
+    list.erase(std::find(list.begin(), list.end(), f));
+  }
+
+  void apply(uint32_t a, uint32_t b, const V3F &target) {
+    for (auto f : vertexFaces_[b]) {
+      auto &face{faces_[f]};
+      if (std::find(face.begin(), face.end(), a) != face.end()) {
+        faceRemoved_[f] = true;
+        --liveFaces_;
+        for (auto v : face)
+          if (v != b)
+            detach(v, f);
+      } else {
+        std::replace(face.begin(), face.end(), b, a);
+        vertexFaces_[a].push_back(f);
+      }
+    }
+    vertexFaces_[b].clear();
+    removed_[b] = true;
+    positions_[a] = target;
+    quadrics_[a] += quadrics_[b];
+    ++versions_[a];
+
+    auto &faces{originalFaces_[a]};
+    scratchB_.clear();
+    std::set_union(faces.begin(), faces.end(), originalFaces_[b].begin(),
+                   originalFaces_[b].end(), std::back_inserter(scratchB_));
+    faces.swap(scratchB_);
+    originalFaces_[b] = {};
+
+    // the edges of a changed, and so did the neighbourhood of the edges
+    // around it that couldn't be collapsed so far
+    neighbours(a, scratchA_);
+    for (auto n : scratchA_) {
+      push(a, n);
+      retry(n, a);
+    }
+    rejected_[a].clear();
+    rejected_[b] = {};
+  }
+
+  /// @brief Queues the rejected collapses of the edges of a vertex again,
+  /// but for the one to a vertex whose edges are queued already.
+  void retry(uint32_t v, uint32_t skipped) {
+    auto edges{std::exchange(rejected_[v], {})};
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    for (auto other : edges) {
+      if (removed_[other] || other == skipped)
+        continue;
+      // the edge is queued once, rather than once from either end
+      auto &mirror{rejected_[other]};
+      mirror.erase(std::remove(mirror.begin(), mirror.end(), v), mirror.end());
+      push(v, other);
+    }
+  }
+
+  void push(uint32_t a, uint32_t b) {
+    heap_.push_back(collapseFor(a, b));
+    std::push_heap(heap_.begin(), heap_.end(), std::greater{});
+  }
+
+  std::vector<V3F> positions_;
+  std::vector<Face> faces_;
+  std::vector<Quadric> quadrics_;
+  std::vector<Plane> facePlanes_;
+  std::vector<std::vector<uint32_t>> vertexFaces_;
+  /// @brief The faces of the original mesh every vertex stands for, sorted.
+  std::vector<std::vector<uint32_t>> originalFaces_;
+  /// @brief The other ends of the edges of every vertex whose collapse was
+  /// rejected as non-manifold or flipping faces.
+  std::vector<std::vector<uint32_t>> rejected_;
+  std::vector<uint32_t> versions_;
+  std::vector<bool> removed_, faceRemoved_;
+  std::vector<Collapse> heap_;
+  std::vector<uint32_t> scratchA_, scratchB_;
+  size_t liveFaces_;
+};
+
+SimplificationResult simplify(std::vector<V3F> &positions,
+                              std::vector<Face> &faces,
+                              std::vector<uint32_t> &remap, size_t target,
+                              float maxError, bool preserveBoundary) {
+  Simplifier simplifier{std::move(positions), std::move(faces)};
+  simplifier.prepare(preserveBoundary);
+  const auto result{simplifier.run(target, maxError)};
+  simplifier.compact(positions, faces, remap);
+  return result;
+}
+
+/// @brief Carries per-vertex normals over to the surviving vertices.
+void remapNormals(std::vector<V3F> &normals, size_t oldVertexCount,
+                  size_t newVertexCount, const std::vector<uint32_t> &remap) {
+  if (normals.size() != oldVertexCount) {
+    normals.clear();
+    return;
+  }
+  std::vector<V3F> remapped(newVertexCount);
+  for (size_t v{}; v < oldVertexCount; ++v)
+    if (remap[v] < newVertexCount)
+      remapped[remap[v]] = normals[v];
+  normals.swap(remapped);
+}
+
+} // namespace
+
+SimplificationResult simplifyMesh(TriangleMesh &mesh, size_t targetTriangles,
+                                  float maxError, bool preserveBoundary) {
+  std::vector<Face> faces;
+  faces.reserve(mesh.triangles().size());
+  for (const auto &t : mesh.triangles())
+    faces.push_back({uint32_t(t.v1), uint32_t(t.v2), uint32_t(t.v3)});
+  auto positions{mesh.vertices()};
+  const auto oldVertexCount{positions.size()};
+  std::vector<uint32_t> remap;
+  const auto result{simplify(positions, faces, remap, targetTriangles,
+                             maxError, preserveBoundary)};
+
+  remapNormals(mesh.normals(), oldVertexCount, positions.size(), remap);
+  mesh.faceNormals().clear();
+  mesh.vertices() = std::move(positions);
+  auto &triangles{mesh.triangles()};
+  triangles.clear();
+  for (const auto &face : faces)
+    triangles.push_back({face[0], face[1], face[2]});
+  return result;
+}
+
+SimplificationResult simplifyMesh(QuadMesh &mesh, size_t targetFaces,
+                                  float maxError, bool preserveBoundary) {
+  std::vector<Face> faces;
+  faces.reserve(2 * mesh.faces().size());
+  for (const auto &q : mesh.faces()) {
+    faces.push_back({uint32_t(q.v1), uint32_t(q.v2), uint32_t(q.v3)});
+    // degenerate quads are triangles already
+    if (q.v4 != q.v1 && q.v4 != q.v3)
+      faces.push_back({uint32_t(q.v1), uint32_t(q.v3), uint32_t(q.v4)});
+  }
+  auto positions{mesh.vertices()};
+  const auto oldVertexCount{positions.size()};
+  std::vector<uint32_t> remap;
+  const auto result{simplify(positions, faces, remap, targetFaces, maxError,
+                             preserveBoundary)};
+
+  remapNormals(mesh.normals(), oldVertexCount, positions.size(), remap);
+  mesh.faceNormals().clear();
+  mesh.vertices() = std::move(positions);
+  auto &quads{mesh.faces()};
+  quads.clear();
+  for (const auto &face : faces)
+    quads.push_back({face[0], face[1], face[2], face[0]});
+  return result;
+}
+
+} // namespace vbag
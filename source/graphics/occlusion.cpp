@@ -0,0 +1,196 @@
+#include "graphics/occlusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vbag {
+
+void HiZBuffer::reset(size_t width, size_t height) {
+  width_ = width;
+  height_ = height;
+  auto levelWidth{(width + blockSize - 1) / blockSize},
+      levelHeight{(height + blockSize - 1) / blockSize};
+  // the levels of the last frame are reused, so their storage is too
+  size_t levels{};
+  for (;;) {
+    if (levels_.size() == levels)
+      levels_.emplace_back();
+    auto &level{levels_[levels++]};
+    level.width = levelWidth;
+    level.height = levelHeight;
+    level.depth.assign(levelWidth * levelHeight, 1.0f);
+    if (levelWidth <= 1 && levelHeight <= 1)
+      break;
+    levelWidth = (levelWidth + 1) / 2;
+    levelHeight = (levelHeight + 1) / 2;
+  }
+  levels_.resize(levels);
+
+  // the pixels of the blocks on the right and bottom edges that are off the
+  // screen are always covered
+  const auto &finest{levels_.front()};
+  coverage_.assign(finest.width * finest.height, 0);
+  coveredDepth_.assign(coverage_.size(), 0.0f);
+  for (size_t y{}; y < finest.height; ++y)
+    coverage_[(y + 1) * finest.width - 1] = offscreen_(finest.width - 1, y);
+  for (size_t x{}; x < finest.width; ++x)
+    coverage_[(finest.height - 1) * finest.width + x] =
+        offscreen_(x, finest.height - 1);
+}
+
+void HiZBuffer::loadDepth(const float *depth) {
+  auto &finest{levels_.front()};
+  std::fill(finest.depth.begin(), finest.depth.end(), 0.0f);
+  for (size_t y{}; y < height_; ++y) {
+    const auto *row{depth + y * width_};
+    auto *texels{finest.depth.data() + y / blockSize * finest.width};
+    for (size_t x{}; x < width_; x += blockSize) {
+      const auto end{(std::min)(x + blockSize, width_)};
+      auto farthest{texels[x / blockSize]};
+      for (auto i{x}; i < end; ++i)
+        farthest = row[i] > farthest ? row[i] : farthest;
+      texels[x / blockSize] = farthest;
+    }
+  }
+}
+
+void HiZBuffer::drawOccluder(const V3F (&triangle)[3]) {
+  auto &finest{levels_.front()};
+  const auto &a{triangle[0]}, &b{triangle[1]}, &c{triangle[2]};
+  const auto area{(b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)};
+  if (!(std::fabs(area) > 0))
+    return;
+
+  // the edge functions of the triangle, positive inside it whatever its
+  // winding
+  const auto sign{area > 0 ? 1.0f : -1.0f};
+  struct Edge {
+    float a, b, c;
+  } edges[3];
+  for (size_t i{}; i < 3; ++i) {
+    const auto &p{triangle[i]}, &q{triangle[(i + 1) % 3]};
+    edges[i].a = sign * (p.y - q.y);
+    edges[i].b = sign * (q.x - p.x);
+    edges[i].c = sign * (p.x * q.y - p.y * q.x);
+  }
+
+  const auto farthest{(std::max)({a.z, b.z, c.z})};
+  const auto texel{float(blockSize)};
+  const auto clampTexel{[](float value, size_t size) {
+    return size_t(std::clamp(value, 0.0f, float(size)));
+  }};
+  const auto x0{clampTexel(std::floor((std::min)({a.x, b.x, c.x}) / texel),
+                           finest.width)},
+      x1{clampTexel(std::ceil((std::max)({a.x, b.x, c.x}) / texel),
+                    finest.width)},
+      y0{clampTexel(std::floor((std::min)({a.y, b.y, c.y}) / texel),
+                    finest.height)},
+      y1{clampTexel(std::ceil((std::max)({a.y, b.y, c.y}) / texel),
+                    finest.height)};
+  for (auto y{y0}; y < y1; ++y) {
+    // the centers of the first and last pixels of the blocks
+    const auto top{float(y * blockSize) + 0.5f}, bottom{top + texel - 1};
+    for (auto x{x0}; x < x1; ++x) {
+      const auto left{float(x * blockSize) + 0.5f}, right{left + texel - 1};
+      // the edge functions at the pixel centers where they're the lowest and
+      // the highest
+      auto inside{true}, outside{false};
+      for (const auto &edge : edges) {
+        const auto lowest{edge.a * (edge.a < 0 ? right : left) +
+                          edge.b * (edge.b < 0 ? bottom : top) + edge.c},
+            highest{edge.a * (edge.a < 0 ? left : right) +
+                    edge.b * (edge.b < 0 ? top : bottom) + edge.c};
+        inside = inside && lowest >= 0;
+        outside = outside || highest < 0;
+      }
+      if (outside)
+        continue;
+      const auto index{y * finest.width + x};
+      if (inside) {
+        finest.depth[index] = (std::min)(finest.depth[index], farthest);
+        continue;
+      }
+
+      // a block the triangle covers partly is only written once the pixels
+      // covered by this and other triangles add up to the whole of it
+      auto &covered{coverage_[index]};
+      for (size_t row{}; row < blockSize; ++row) {
+        float values[3];
+        for (size_t i{}; i < 3; ++i)
+          values[i] = edges[i].a * left +
+                      edges[i].b * (top + float(row)) + edges[i].c;
+        for (size_t column{}; column < blockSize; ++column) {
+          if (values[0] >= 0 && values[1] >= 0 && values[2] >= 0)
+            covered |= uint64_t{1} << (row * blockSize + column);
+          for (size_t i{}; i < 3; ++i)
+            values[i] += edges[i].a;
+        }
+      }
+      auto &coveredDepth{coveredDepth_[index]};
+      coveredDepth = (std::max)(coveredDepth, farthest);
+      if (covered == ~uint64_t{}) {
+        finest.depth[index] = (std::min)(finest.depth[index], coveredDepth);
+        covered = offscreen_(x, y);
+        coveredDepth = 0;
+      }
+    }
+  }
+}
+
+void HiZBuffer::buildPyramid() {
+  for (size_t i{1}; i < levels_.size(); ++i) {
+    const auto &fine{levels_[i - 1]};
+    auto &coarse{levels_[i]};
+    for (size_t y{}; y < coarse.height; ++y) {
+      const auto y0{2 * y}, y1{(std::min)(2 * y + 1, fine.height - 1)};
+      for (size_t x{}; x < coarse.width; ++x) {
+        const auto x0{2 * x}, x1{(std::min)(2 * x + 1, fine.width - 1)};
+        coarse.depth[y * coarse.width + x] =
+            (std::max)({fine.depth[y0 * fine.width + x0],
+                        fine.depth[y0 * fine.width + x1],
+                        fine.depth[y1 * fine.width + x0],
+                        fine.depth[y1 * fine.width + x1]});
+      }
+    }
+  }
+}
+
+uint64_t HiZBuffer::offscreen_(size_t x, size_t y) const {
+  uint64_t mask{};
+  for (size_t row{}; row < blockSize; ++row)
+    for (size_t column{}; column < blockSize; ++column)
+      if (x * blockSize + column >= width_ || y * blockSize + row >= height_)
+        mask |= uint64_t{1} << (row * blockSize + column);
+  return mask;
+}
+
+bool HiZBuffer::isOccluded(float x0, float y0, float x1, float y1,
+                           float depth) const {
+  if (levels_.empty())
+    return false;
+  x0 = (std::max)(x0, 0.0f), y0 = (std::max)(y0, 0.0f);
+  x1 = (std::min)(x1, float(width_)), y1 = (std::min)(y1, float(height_));
+  if (!(x0 < x1 && y0 < y1))
+    return false;
+
+  // the texels of the finest level the rectangle touches, inclusive
+  const auto texel{float(blockSize)};
+  auto left{size_t(x0 / texel)}, top{size_t(y0 / texel)},
+      right{size_t(std::ceil(x1 / texel)) - 1},
+      bottom{size_t(std::ceil(y1 / texel)) - 1};
+  // goes up until the rectangle is within 4x4 texels
+  size_t level{};
+  while (level + 1 < levels_.size() && (right - left > 3 || bottom - top > 3))
+    ++level, left /= 2, top /= 2, right /= 2, bottom /= 2;
+
+  const auto &texels{levels_[level]};
+  right = (std::min)(right, texels.width - 1);
+  bottom = (std::min)(bottom, texels.height - 1);
+  for (auto y{top}; y <= bottom; ++y)
+    for (auto x{left}; x <= right; ++x)
+      if (!(depth > texels.depth[y * texels.width + x]))
+        return false;
+  return true;
+}
+
+} // namespace vbag
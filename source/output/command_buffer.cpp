@@ -0,0 +1,247 @@
+#include "output/command_buffer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace vbag {
+
+namespace {
+
+constexpr unsigned typeShift{56}, stateShift{40};
+
+/// @brief How many of the low bits of a key are used, so the radix sort can
+/// stop there.
+constexpr unsigned keyBits{58};
+
+/// @brief The bits of a key holding the depth.
+constexpr uint64_t depthMask{0xFFFFFFFF};
+
+/// @brief How many packets and primitives of each type the storage has room
+/// for from the start.
+constexpr size_t minCapacity{1024};
+
+} // namespace
+
+CommandBuffer::CommandBuffer() {
+  packets_.reserve(minCapacity);
+  sortScratch_.reserve(minCapacity);
+  vertices_.reserve(minCapacity);
+  colors_.reserve(minCapacity);
+  lines_.reserve(minCapacity);
+  points_.reserve(minCapacity);
+  vertexScratch_.reserve(minCapacity);
+  colorScratch_.reserve(minCapacity);
+  lineScratch_.reserve(minCapacity);
+}
+
+void CommandBuffer::clear() {
+  packets_.clear();
+  vertices_.clear();
+  colors_.clear();
+  lines_.clear();
+  points_.clear();
+}
+
+void CommandBuffer::drawTriangles(std::span<const V3F> vertices,
+                                  std::span<const D3DCOLOR> colors,
+                                  uint16_t state) {
+  const auto count{vertices.size() / 3 * 3};
+  if (count == 0)
+    return;
+  auto depth{vertices[0].z};
+  for (size_t i{1}; i < count; ++i)
+    depth = (std::min)(depth, vertices[i].z);
+  packets_.push_back({key_(PrimitiveType::Triangles, state, depth),
+                      uint32_t(vertices_.size()), uint32_t(count)});
+  vertices_.insert(vertices_.end(), vertices.begin(),
+                   vertices.begin() + count);
+  colors_.insert(colors_.end(), colors.begin(), colors.begin() + count);
+}
+
+void CommandBuffer::drawLines(std::span<const Line> lines, uint16_t state) {
+  if (lines.empty())
+    return;
+  auto depth{(std::min)(lines[0].start.z, lines[0].end.z)};
+  for (const auto &line : lines)
+    depth = (std::min)({depth, line.start.z, line.end.z});
+  packets_.push_back({key_(PrimitiveType::Lines, state, depth),
+                      uint32_t(lines_.size()), uint32_t(lines.size())});
+  lines_.insert(lines_.end(), lines.begin(), lines.end());
+}
+
+void CommandBuffer::drawPoints(std::span<const V3F> points, uint16_t state) {
+  if (points.empty())
+    return;
+  auto depth{points[0].z};
+  for (const auto &point : points)
+    depth = (std::min)(depth, point.z);
+  packets_.push_back({key_(PrimitiveType::Points, state, depth),
+                      uint32_t(points_.size()), uint32_t(points.size())});
+  points_.insert(points_.end(), points.begin(), points.end());
+}
+
+void CommandBuffer::append(const CommandBuffer &other) {
+  const auto vertexOffset{uint32_t(vertices_.size())},
+      lineOffset{uint32_t(lines_.size())},
+      pointOffset{uint32_t(points_.size())};
+  packets_.reserve(packets_.size() + other.packets_.size());
+  for (auto packet : other.packets_) {
+    switch (type_(packet.key)) {
+    case PrimitiveType::Triangles:
+      packet.first += vertexOffset;
+      break;
+    case PrimitiveType::Lines:
+      packet.first += lineOffset;
+      break;
+    case PrimitiveType::Points:
+      packet.first += pointOffset;
+      break;
+    }
+    packets_.push_back(packet);
+  }
+  vertices_.insert(vertices_.end(), other.vertices_.begin(),
+                   other.vertices_.end());
+  colors_.insert(colors_.end(), other.colors_.begin(), other.colors_.end());
+  lines_.insert(lines_.end(), other.lines_.begin(), other.lines_.end());
+  points_.insert(points_.end(), other.points_.begin(), other.points_.end());
+}
+
+CommandBuffer::Submission CommandBuffer::execute(Screen &screen) {
+  // without a depth buffer, whatever is drawn last ends up in front, so the
+  // depth order is flipped while sorting. the keys are flipped back, so
+  // executing again sorts the same way
+  const auto farthestFirst{!screen.depth()};
+  if (farthestFirst)
+    for (auto &packet : packets_)
+      packet.key ^= depthMask;
+  sort_();
+  if (farthestFirst)
+    for (auto &packet : packets_)
+      packet.key ^= depthMask;
+  // packets that only differ in depth are adjacent now, and get merged
+  const auto mask{~uint64_t{} << stateShift};
+  Submission submission;
+  for (size_t begin{}, end{}; begin < packets_.size(); begin = end) {
+    end = begin + 1;
+    size_t count{packets_[begin].count};
+    while (end < packets_.size() &&
+           (packets_[end].key & mask) == (packets_[begin].key & mask))
+      count += packets_[end++].count;
+    executeRun_(screen, begin, end);
+    ++submission.calls;
+    switch (type_(packets_[begin].key)) {
+    case PrimitiveType::Triangles:
+      submission.triangles += count / 3;
+      submission.bytes += count * (sizeof(V3F) + sizeof(D3DCOLOR));
+      break;
+    case PrimitiveType::Lines:
+      submission.lines += count;
+      submission.bytes += count * sizeof(Line);
+      break;
+    case PrimitiveType::Points:
+      submission.points += count;
+      submission.bytes += count * sizeof(V3F);
+      break;
+    }
+  }
+  return submission;
+}
+
+size_t CommandBuffer::packetCount() const { return packets_.size(); }
+
+bool CommandBuffer::empty() const { return packets_.empty(); }
+
+uint64_t CommandBuffer::key_(PrimitiveType type, uint16_t state,
+                             float depth) {
+  // the bits of non-negative floats sort like the floats do
+  if (!(depth > 0))
+    depth = 0;
+  return uint64_t(type) << typeShift | uint64_t(state) << stateShift |
+         std::bit_cast<uint32_t>(depth);
+}
+
+CommandBuffer::PrimitiveType CommandBuffer::type_(uint64_t key) {
+  return PrimitiveType(key >> typeShift);
+}
+
+void CommandBuffer::sort_() {
+  if (packets_.size() < 2)
+    return;
+  sortScratch_.resize(packets_.size());
+  for (unsigned shift{}; shift < keyBits; shift += 8) {
+    size_t offsets[256]{};
+    for (const auto &packet : packets_)
+      ++offsets[packet.key >> shift & 0xFF];
+    // every key has the same byte here, so this pass wouldn't move anything
+    if (offsets[packets_[0].key >> shift & 0xFF] == packets_.size())
+      continue;
+    size_t total{};
+    for (auto &offset : offsets)
+      total += std::exchange(offset, total);
+    for (const auto &packet : packets_)
+      sortScratch_[offsets[packet.key >> shift & 0xFF]++] = packet;
+    packets_.swap(sortScratch_);
+  }
+}
+
+void CommandBuffer::executeRun_(Screen &screen, size_t begin, size_t end) {
+  const auto type{type_(packets_[begin].key)};
+  // a single packet is drawn straight from where it was recorded, a run of
+  // them is gathered first
+  const auto single{end - begin == 1};
+  const auto &first{packets_[begin]};
+  switch (type) {
+  case PrimitiveType::Triangles: {
+    if (single) {
+      screen.drawTriangles({vertices_.data() + first.first, first.count},
+                           {colors_.data() + first.first, first.count});
+      return;
+    }
+    vertexScratch_.clear();
+    colorScratch_.clear();
+    for (auto i{begin}; i < end; ++i) {
+      const auto &packet{packets_[i]};
+      vertexScratch_.insert(vertexScratch_.end(),
+                            vertices_.begin() + packet.first,
+                            vertices_.begin() + packet.first + packet.count);
+      colorScratch_.insert(colorScratch_.end(),
+                           colors_.begin() + packet.first,
+                           colors_.begin() + packet.first + packet.count);
+    }
+    screen.drawTriangles(vertexScratch_, colorScratch_);
+    return;
+  }
+  case PrimitiveType::Lines: {
+    if (single) {
+      screen.drawLines(lines_.data() + first.first, first.count);
+      return;
+    }
+    lineScratch_.clear();
+    for (auto i{begin}; i < end; ++i) {
+      const auto &packet{packets_[i]};
+      lineScratch_.insert(lineScratch_.end(), lines_.begin() + packet.first,
+                          lines_.begin() + packet.first + packet.count);
+    }
+    screen.drawLines(lineScratch_.data(), lineScratch_.size());
+    return;
+  }
+  case PrimitiveType::Points: {
+    if (single) {
+      screen.drawPoints({points_.data() + first.first, first.count});
+      return;
+    }
+    vertexScratch_.clear();
+    for (auto i{begin}; i < end; ++i) {
+      const auto &packet{packets_[i]};
+      vertexScratch_.insert(vertexScratch_.end(),
+                            points_.begin() + packet.first,
+                            points_.begin() + packet.first + packet.count);
+    }
+    screen.drawPoints(vertexScratch_);
+    return;
+  }
+  }
+}
+
+} // namespace vbag
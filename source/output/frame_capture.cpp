@@ -0,0 +1,372 @@
+#include "output/frame_capture.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "util/error_handling.hpp"
+
+namespace vbag {
+
+namespace {
+
+bool hasExtension(const std::string &path, const char *extension) {
+  const auto length{std::strlen(extension)};
+  if (path.size() < length)
+    return false;
+  return std::equal(path.end() - long(length), path.end(), extension,
+                    [](char a, char b) { return std::tolower(a) == b; });
+}
+
+void appendNumber(std::vector<uint8_t> &output, size_t value) {
+  char digits[20];
+  const auto end{std::to_chars(digits, digits + sizeof(digits), value).ptr};
+  output.insert(output.end(), digits, end);
+}
+
+void appendText(std::vector<uint8_t> &output, const char *text) {
+  output.insert(output.end(), text, text + std::strlen(text));
+}
+
+void appendBigEndian(std::vector<uint8_t> &output, uint32_t value) {
+  for (int shift{24}; shift >= 0; shift -= 8)
+    output.push_back(uint8_t(value >> shift));
+}
+
+/// @brief Appends the pixels as 8-bit RGB triples, dropping the alpha.
+void appendRgb(std::vector<uint8_t> &output, const uint32_t *pixels,
+               size_t count) {
+  const auto start{output.size()};
+  output.resize(start + count * 3);
+  auto *out{output.data() + start};
+  for (size_t i{}; i < count; ++i, out += 3) {
+    out[0] = uint8_t(pixels[i]);
+    out[1] = uint8_t(pixels[i] >> 8);
+    out[2] = uint8_t(pixels[i] >> 16);
+  }
+}
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+  static const auto table{[] {
+    std::vector<uint32_t> table(256);
+    for (uint32_t i{}; i < 256; ++i) {
+      auto c{i};
+      for (int bit{}; bit < 8; ++bit)
+        c = c & 1 ? 0xEDB88320u ^ c >> 1 : c >> 1;
+      table[i] = c;
+    }
+    return table;
+  }()};
+  crc = ~crc;
+  for (size_t i{}; i < size; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ crc >> 8;
+  return ~crc;
+}
+
+uint32_t adler32(const uint8_t *data, size_t size) {
+  // 5552 bytes is the most that can be summed before the sums may overflow
+  uint32_t a{1}, b{};
+  while (size) {
+    const auto n{(std::min)(size, size_t{5552})};
+    for (size_t i{}; i < n; ++i)
+      b += a += data[i];
+    a %= 65521, b %= 65521;
+    data += n, size -= n;
+  }
+  return b << 16 | a;
+}
+
+/// @brief Appends a PNG chunk: its length, type, data and CRC.
+void appendChunk(std::vector<uint8_t> &output, const char *type,
+                 const uint8_t *data, size_t size) {
+  appendBigEndian(output, uint32_t(size));
+  const auto start{output.size()};
+  appendText(output, type);
+  output.insert(output.end(), data, data + size);
+  appendBigEndian(output,
+                  crc32(output.data() + start, output.size() - start));
+}
+
+std::vector<uint8_t> encodePpm(const uint32_t *pixels, size_t width,
+                               size_t height) {
+  std::vector<uint8_t> output;
+  output.reserve(32 + width * height * 3);
+  appendText(output, "P6\n");
+  appendNumber(output, width);
+  output.push_back(' ');
+  appendNumber(output, height);
+  appendText(output, "\n255\n");
+  appendRgb(output, pixels, width * height);
+  return output;
+}
+
+std::vector<uint8_t> encodePng(const uint32_t *pixels, size_t width,
+                               size_t height) {
+  // every row starts with its filter, which is always none
+  std::vector<uint8_t> rows;
+  rows.reserve((width * 3 + 1) * height);
+  for (size_t y{}; y < height; ++y) {
+    rows.push_back(0);
+    appendRgb(rows, pixels + y * width, width);
+  }
+
+  // a zlib stream made of stored deflate blocks, at most 65535 bytes each
+  constexpr size_t maxBlock{65535};
+  std::vector<uint8_t> zlib{0x78, 0x01};
+  zlib.reserve(rows.size() + rows.size() / maxBlock * 5 + 16);
+  size_t offset{};
+  do {
+    const auto size{(std::min)(rows.size() - offset, maxBlock)};
+    const auto last{offset + size == rows.size()};
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back(uint8_t(size)), zlib.push_back(uint8_t(size >> 8));
+    zlib.push_back(uint8_t(~size)), zlib.push_back(uint8_t(~size >> 8));
+    zlib.insert(zlib.end(), rows.begin() + long(offset),
+                rows.begin() + long(offset + size));
+    offset += size;
+  } while (offset < rows.size());
+  appendBigEndian(zlib, adler32(rows.data(), rows.size()));
+
+  std::vector<uint8_t> output{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  output.reserve(zlib.size() + 64);
+  std::vector<uint8_t> header;
+  appendBigEndian(header, uint32_t(width));
+  appendBigEndian(header, uint32_t(height));
+  // 8 bits per channel, RGB, deflate, adaptive filtering, not interlaced
+  header.insert(header.end(), {8, 2, 0, 0, 0});
+  appendChunk(output, "IHDR", header.data(), header.size());
+  appendChunk(output, "IDAT", zlib.data(), zlib.size());
+  appendChunk(output, "IEND", nullptr, 0);
+  return output;
+}
+
+/// @brief Converts a pixel to full range BT.601 luma, like JPEG does.
+uint8_t luma(uint32_t pixel) {
+  const auto r{int(pixel & 0xFF)}, g{int(pixel >> 8 & 0xFF)},
+      b{int(pixel >> 16 & 0xFF)};
+  return uint8_t((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+/// @brief Converts the sums of the channels of a 2x2 block of pixels to full
+/// range BT.601 chroma, like JPEG does.
+///
+/// Saturated colors land just past the range, so they're clamped rather
+/// than left to wrap around.
+///
+/// @return The blue difference (U) and the red difference (V).
+constexpr std::pair<uint8_t, uint8_t> chroma(int r, int g, int b) {
+  // the sums are four times the averages, so the shifts make up for it
+  const auto u{((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128},
+      v{((128 * r - 107 * g - 21 * b + 512) >> 10) + 128};
+  return {uint8_t(std::clamp(u, 0, 255)), uint8_t(std::clamp(v, 0, 255))};
+}
+
+static_assert(chroma(0, 0, 0) == std::pair<uint8_t, uint8_t>{128, 128});
+static_assert(chroma(1020, 1020, 1020) ==
+              std::pair<uint8_t, uint8_t>{128, 128});
+static_assert(chroma(1020, 0, 0) == std::pair<uint8_t, uint8_t>{85, 255});
+static_assert(chroma(0, 1020, 0) == std::pair<uint8_t, uint8_t>{43, 21});
+static_assert(chroma(0, 0, 1020) == std::pair<uint8_t, uint8_t>{255, 107});
+
+} // namespace
+
+void saveImage(const std::string &path, const uint32_t *pixels, size_t width,
+               size_t height) {
+  std::vector<uint8_t> bytes;
+  if (hasExtension(path, ".ppm"))
+    bytes = encodePpm(pixels, width, height);
+  else if (hasExtension(path, ".png"))
+    bytes = encodePng(pixels, width, height);
+  else
+    throw RuntimeError<UnsupportedImageFormat>{};
+
+  auto *file{std::fopen(path.c_str(), "wb")};
+  if (!file)
+    throw RuntimeError<CouldNotOpenFile>{};
+  const auto written{std::fwrite(bytes.data(), 1, bytes.size(), file)};
+  if (std::fclose(file) != 0 || written != bytes.size())
+    throw RuntimeError<CouldNotOpenFile>{};
+}
+
+FrameRecorder::FrameRecorder(const std::string &path, size_t width,
+                             size_t height, VideoFormat format,
+                             float frameRate, size_t queueDepth,
+                             bool dropWhenFull)
+    : width_{width}, height_{height}, format_{format},
+      dropWhenFull_{dropWhenFull} {
+  if (path == "-") {
+    file_ = stdout;
+#if defined(_WIN32)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  } else if (!path.empty() && path[0] == '|') {
+#if defined(_WIN32)
+    file_ = _popen(path.c_str() + 1, "wb");
+#else
+    file_ = popen(path.c_str() + 1, "w");
+#endif
+    isPipe_ = true;
+  } else {
+    file_ = std::fopen(path.c_str(), "wb");
+  }
+  if (!file_)
+    throw RuntimeError<CouldNotOpenFile>{};
+
+  if (format_ == VideoFormat::Y4m) {
+    // the frame rate goes in as a fraction, to the thousandth
+    const auto numerator{
+        (std::max)(std::lround(double(frameRate) * 1000), 1l)},
+        divisor{std::gcd(numerator, 1000l)};
+    std::vector<uint8_t> header;
+    appendText(header, "YUV4MPEG2 W");
+    appendNumber(header, width_);
+    appendText(header, " H");
+    appendNumber(header, height_);
+    appendText(header, " F");
+    appendNumber(header, size_t(numerator / divisor));
+    header.push_back(':');
+    appendNumber(header, size_t(1000 / divisor));
+    appendText(header, " Ip A1:1 C420jpeg XCOLORRANGE=FULL\n");
+    failed_ = std::fwrite(header.data(), 1, header.size(), file_) !=
+              header.size();
+  }
+
+  freeBuffers_.resize((std::max)(queueDepth, size_t{1}));
+  for (auto &buffer : freeBuffers_)
+    buffer.resize(width_ * height_);
+  writer_ = std::thread{[this] { write_(); }};
+}
+
+FrameRecorder::~FrameRecorder() {
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+  }
+  frameQueued_.notify_one();
+  writer_.join();
+  if (isPipe_) {
+#if defined(_WIN32)
+    _pclose(file_);
+#else
+    pclose(file_);
+#endif
+  } else if (file_ == stdout) {
+    std::fflush(file_);
+  } else {
+    std::fclose(file_);
+  }
+}
+
+void FrameRecorder::push(const uint32_t *pixels) {
+  std::vector<uint32_t> buffer;
+  {
+    std::unique_lock lock{mutex_};
+    if (freeBuffers_.empty()) {
+      if (dropWhenFull_) {
+        ++dropped_;
+        return;
+      }
+      bufferFreed_.wait(lock, [this] { return !freeBuffers_.empty(); });
+    }
+    buffer = std::move(freeBuffers_.back());
+    freeBuffers_.pop_back();
+  }
+  // the copy happens outside the lock, so the writer isn't held up by it
+  std::copy(pixels, pixels + width_ * height_, buffer.begin());
+  {
+    std::lock_guard lock{mutex_};
+    queue_.push_back(std::move(buffer));
+  }
+  frameQueued_.notify_one();
+}
+
+size_t FrameRecorder::framesWritten() const {
+  std::lock_guard lock{mutex_};
+  return written_;
+}
+
+size_t FrameRecorder::framesDropped() const {
+  std::lock_guard lock{mutex_};
+  return dropped_;
+}
+
+bool FrameRecorder::failed() const {
+  std::lock_guard lock{mutex_};
+  return failed_;
+}
+
+void FrameRecorder::write_() {
+  std::unique_lock lock{mutex_};
+  for (;;) {
+    frameQueued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+    auto frame{std::move(queue_.front())};
+    queue_.pop_front();
+    const auto failed{failed_};
+    lock.unlock();
+
+    auto written{false};
+    if (!failed) {
+      encode_(frame);
+      written = std::fwrite(encoded_.data(), 1, encoded_.size(), file_) ==
+                encoded_.size();
+    }
+
+    lock.lock();
+    if (written)
+      ++written_;
+    else
+      failed_ = true;
+    freeBuffers_.push_back(std::move(frame));
+    bufferFreed_.notify_one();
+  }
+}
+
+void FrameRecorder::encode_(const std::vector<uint32_t> &frame) {
+  encoded_.clear();
+  if (format_ == VideoFormat::RawRgb) {
+    appendRgb(encoded_, frame.data(), frame.size());
+    return;
+  }
+
+  // 4:2:0 chroma planes cover odd sizes with a last half-empty block
+  const auto chromaWidth{(width_ + 1) / 2}, chromaHeight{(height_ + 1) / 2};
+  appendText(encoded_, "FRAME\n");
+  const auto start{encoded_.size()};
+  encoded_.resize(start + width_ * height_ + 2 * chromaWidth * chromaHeight);
+  auto *y{encoded_.data() + start}, *u{y + width_ * height_},
+      *v{u + chromaWidth * chromaHeight};
+
+  for (size_t i{}; i < frame.size(); ++i)
+    y[i] = luma(frame[i]);
+  for (size_t row{}; row < chromaHeight; ++row) {
+    const auto y0{row * 2}, y1{(std::min)(y0 + 1, height_ - 1)};
+    for (size_t column{}; column < chromaWidth; ++column) {
+      const auto x0{column * 2}, x1{(std::min)(x0 + 1, width_ - 1)};
+      const uint32_t block[4]{frame[y0 * width_ + x0], frame[y0 * width_ + x1],
+                              frame[y1 * width_ + x0],
+                              frame[y1 * width_ + x1]};
+      int r{}, g{}, b{};
+      for (const auto pixel : block) {
+        r += int(pixel & 0xFF);
+        g += int(pixel >> 8 & 0xFF);
+        b += int(pixel >> 16 & 0xFF);
+      }
+      const auto i{row * chromaWidth + column};
+      std::tie(u[i], v[i]) = chroma(r, g, b);
+    }
+  }
+}
+
+} // namespace vbag
@@ -0,0 +1,428 @@
+#include "output/software_screen.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+
+#include "output/frame_capture.hpp"
+#include "output/triangle_rasterizer.hpp"
+#include "util/parallel.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief The fewest primitives worth binning on a thread of their own.
+constexpr size_t minBinChunkSize{1024};
+
+/// @brief How many primitives every tile list has room for from the start,
+/// so the lists of tiles that had nothing in them yet don't allocate when
+/// things move into them.
+constexpr size_t minBinCapacity{256};
+
+/// @brief How many primitives the screen has room for from the start.
+constexpr size_t minPrimitiveCapacity{4096};
+
+/// @brief Converts a 0xAARRGGBB color to a 0xAABBGGRR pixel.
+uint32_t toRgba(D3DCOLOR color) {
+  return (color & 0xFF00FF00u) | (color >> 16 & 0xFFu) |
+         (color & 0xFFu) << 16;
+}
+
+/// @brief Twice the signed area of the triangle (a, b, p). Positive when the
+/// points go clockwise on the screen, since y grows downwards.
+float edge(const V3F &a, const V3F &b, float px, float py) {
+  return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+/// @brief Whether pixels exactly on an edge of a clockwise triangle belong to
+/// it: only the ones on top and left edges do, so triangles sharing an edge
+/// never draw the same pixel twice.
+bool isTopLeft(const V3F &a, const V3F &b) {
+  return (a.y == b.y && b.x > a.x) || b.y < a.y;
+}
+
+/// @brief Finds the part of the segment from a to b that lies inside the
+/// rectangle [x0, x1] x [y0, y1] (liang-barsky).
+///
+/// @return False if the segment misses the rectangle, otherwise true, with
+/// enter and exit set to the parameters where it goes in and out.
+bool clipSegment(const V3F &a, const V3F &b, float x0, float y0, float x1,
+                 float y1, float &enter, float &exit) {
+  enter = 0, exit = 1;
+  const auto d{b - a};
+  const float p[4]{-d.x, d.x, -d.y, d.y},
+      q[4]{a.x - x0, x1 - a.x, a.y - y0, y1 - a.y};
+  for (size_t i{}; i < 4; ++i) {
+    if (p[i] == 0) {
+      if (q[i] < 0)
+        return false;
+      continue;
+    }
+    const auto t{q[i] / p[i]};
+    if (p[i] < 0)
+      enter = (std::max)(enter, t);
+    else
+      exit = (std::min)(exit, t);
+  }
+  return enter <= exit;
+}
+
+/// @brief How many steps a line is drawn in, one pixel apart along its major
+/// axis.
+float lineSteps(const V3F &a, const V3F &b) {
+  const auto d{b - a};
+  return (std::max)(std::ceil((std::max)(std::abs(d.x), std::abs(d.y))),
+                    1.0f);
+}
+
+} // namespace
+
+SoftwareScreen::SoftwareScreen(size_t width, size_t height, size_t threads)
+    : width_{width}, height_{height},
+      tilesX_{(width + tileSize - 1) / tileSize},
+      tilesY_{(height + tileSize - 1) / tileSize},
+      jobs_{threads},
+      backBuffer_(width * height), frontBuffer_(width * height),
+      depthBuffer_(width * height, 1.0f) {
+  primitives_.reserve(minPrimitiveCapacity);
+}
+
+void SoftwareScreen::clear() { fill(0, 0, 0); }
+
+void SoftwareScreen::fill(uint8_t r, uint8_t g, uint8_t b) {
+  // nothing drawn before a clear can be seen
+  primitives_.clear();
+  Primitive clear{PrimitiveType::Clear};
+  clear.colors[0] = toRgba(D3DCOLOR_XRGB(r, g, b));
+  primitives_.push_back(clear);
+}
+
+size_t SoftwareScreen::width() const { return width_; }
+
+size_t SoftwareScreen::height() const { return height_; }
+
+void SoftwareScreen::drawLine(const Line &line) {
+  float enter, exit;
+  if (!clipSegment(line.start, line.end, 0, 0, float(width_), float(height_),
+                   enter, exit))
+    return;
+  const auto d{line.end - line.start};
+  Primitive primitive{PrimitiveType::Line};
+  primitive.vertices[0] = line.start + d * enter;
+  primitive.vertices[1] = line.start + d * exit;
+  primitive.colors[0] = toRgba(line.color);
+  primitives_.push_back(primitive);
+}
+
+void SoftwareScreen::drawLines(const Line *lines, size_t n) {
+  primitives_.reserve(primitives_.size() + n);
+  for (size_t i{}; i < n; ++i)
+    drawLine(lines[i]);
+}
+
+void SoftwareScreen::drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1,
+                                  D3DCOLOR c2, D3DCOLOR c3) {
+  const auto area{edge(v1, v2, v3.x, v3.y)};
+  if (area == 0)
+    return;
+  // the rasterizer expects clockwise triangles
+  if (area < 0) {
+    std::swap(v2, v3);
+    std::swap(c2, c3);
+  }
+  if ((std::max)({v1.x, v2.x, v3.x}) < 0 ||
+      (std::max)({v1.y, v2.y, v3.y}) < 0 ||
+      (std::min)({v1.x, v2.x, v3.x}) >= float(width_) ||
+      (std::min)({v1.y, v2.y, v3.y}) >= float(height_))
+    return;
+  primitives_.push_back({PrimitiveType::Triangle,
+                         {v1, v2, v3},
+                         {toRgba(c1), toRgba(c2), toRgba(c3)}});
+}
+
+void SoftwareScreen::drawPoint(V3F p) {
+  if (p.x < -3 || p.y < -3 || p.x >= float(width_) + 3 ||
+      p.y >= float(height_) + 3)
+    return;
+  Primitive point{PrimitiveType::Point};
+  point.vertices[0] = p;
+  point.colors[0] = toRgba(D3DCOLOR_XRGB(255, 255, 255));
+  primitives_.push_back(point);
+}
+
+void SoftwareScreen::drawTriangles(std::span<const V3F> vertices,
+                                   std::span<const D3DCOLOR> colors) {
+  primitives_.reserve(primitives_.size() + vertices.size() / 3);
+  // qualified, so the calls aren't virtual
+  for (size_t i{}; i + 2 < vertices.size(); i += 3)
+    SoftwareScreen::drawTriangle(vertices[i], vertices[i + 1],
+                                 vertices[i + 2], colors[i], colors[i + 1],
+                                 colors[i + 2]);
+}
+
+void SoftwareScreen::drawIndexedTriangles(std::span<const V3F> vertices,
+                                          std::span<const D3DCOLOR> colors,
+                                          std::span<const uint32_t> indices) {
+  primitives_.reserve(primitives_.size() + indices.size() / 3);
+  for (size_t i{}; i + 2 < indices.size(); i += 3)
+    SoftwareScreen::drawTriangle(
+        vertices[indices[i]], vertices[indices[i + 1]],
+        vertices[indices[i + 2]], colors[indices[i]], colors[indices[i + 1]],
+        colors[indices[i + 2]]);
+}
+
+void SoftwareScreen::drawPoints(std::span<const V3F> points) {
+  primitives_.reserve(primitives_.size() + points.size());
+  for (const auto &point : points)
+    SoftwareScreen::drawPoint(point);
+}
+
+void SoftwareScreen::flush() {
+  if (primitives_.empty())
+    return;
+  const auto tileCount{tilesX_ * tilesY_};
+
+  // front end: contiguous chunks of primitives are binned in parallel, each
+  // into lists of its own, so going through the chunks in order keeps the
+  // submission order within every tile
+  const auto binChunks{
+      (std::min)(chunkCount(primitives_.size(), minBinChunkSize),
+                 jobs_.threadCount())};
+  if (bins_.size() < binChunks * tileCount) {
+    bins_.resize(binChunks * tileCount);
+    for (auto &bin : bins_)
+      bin.reserve(minBinCapacity);
+  }
+  jobs_.parallelFor(binChunks, [&](size_t chunk) {
+    auto [first, last]{chunkRange(primitives_.size(), binChunks, chunk)};
+    for (auto i{first}; i < last; ++i)
+      bin_(uint32_t(i), &bins_[chunk * tileCount]);
+  });
+
+  // back end: threads grab tiles until there are none left, which balances
+  // tiles that are busier than others
+  std::atomic<size_t> nextTile{};
+  jobs_.parallelFor((std::min)(jobs_.threadCount(), tileCount), [&](size_t) {
+    for (auto tile{nextTile++}; tile < tileCount; tile = nextTile++)
+      rasterizeTile_(tile, binChunks);
+  });
+  jobs_.reserveJobs();
+  primitives_.clear();
+}
+
+void SoftwareScreen::present() {
+  flush();
+  backBuffer_.swap(frontBuffer_);
+  ++frameCount_;
+  if (recorder_)
+    recorder_->push(frontBuffer_.data());
+}
+
+const uint32_t *SoftwareScreen::pixels() const { return frontBuffer_.data(); }
+
+const float *SoftwareScreen::depth() const { return depthBuffer_.data(); }
+
+size_t SoftwareScreen::frameCount() const { return frameCount_; }
+
+void SoftwareScreen::setRecorder(FrameRecorder *recorder) {
+  recorder_ = recorder;
+}
+
+void SoftwareScreen::bin_(uint32_t index, std::vector<uint32_t> *bins) {
+  const auto &primitive{primitives_[index]};
+  const auto &v{primitive.vertices};
+  float minX, minY, maxX, maxY;
+  switch (primitive.type) {
+  case PrimitiveType::Clear:
+    for (size_t tile{}; tile < tilesX_ * tilesY_; ++tile)
+      bins[tile].push_back(index);
+    return;
+  case PrimitiveType::Triangle:
+    minX = (std::min)({v[0].x, v[1].x, v[2].x});
+    minY = (std::min)({v[0].y, v[1].y, v[2].y});
+    maxX = (std::max)({v[0].x, v[1].x, v[2].x});
+    maxY = (std::max)({v[0].y, v[1].y, v[2].y});
+    break;
+  case PrimitiveType::Line:
+    minX = (std::min)(v[0].x, v[1].x) - 1;
+    minY = (std::min)(v[0].y, v[1].y) - 1;
+    maxX = (std::max)(v[0].x, v[1].x) + 1;
+    maxY = (std::max)(v[0].y, v[1].y) + 1;
+    break;
+  case PrimitiveType::Point:
+    minX = v[0].x - 3, minY = v[0].y - 3;
+    maxX = v[0].x + 3, maxY = v[0].y + 3;
+    break;
+  default:
+    return;
+  }
+  const auto tileRange{[](float min, float max, size_t tiles) {
+    const auto first{(std::max)(min, 0.0f) / float(tileSize)},
+        last{(std::max)(max, 0.0f) / float(tileSize)};
+    return std::pair{(std::min)(size_t(first), tiles - 1),
+                     (std::min)(size_t(last), tiles - 1)};
+  }};
+  const auto [x0, x1]{tileRange(minX, maxX, tilesX_)};
+  const auto [y0, y1]{tileRange(minY, maxY, tilesY_)};
+  for (auto y{y0}; y <= y1; ++y) {
+    for (auto x{x0}; x <= x1; ++x) {
+      // long diagonal lines span lots of tiles they never touch
+      if (primitive.type == PrimitiveType::Line) {
+        const auto size{float(tileSize)};
+        float enter, exit;
+        if (!clipSegment(v[0], v[1], float(x) * size - 1, float(y) * size - 1,
+                         float(x + 1) * size + 1, float(y + 1) * size + 1,
+                         enter, exit))
+          continue;
+      }
+      bins[y * tilesX_ + x].push_back(index);
+    }
+  }
+}
+
+void SoftwareScreen::rasterizeTile_(size_t tile, size_t binChunks) {
+  const auto rect{tileRect_(tile)};
+  const auto tileCount{tilesX_ * tilesY_};
+  for (size_t chunk{}; chunk < binChunks; ++chunk) {
+    auto &bin{bins_[chunk * tileCount + tile]};
+    for (auto index : bin) {
+      const auto &primitive{primitives_[index]};
+      switch (primitive.type) {
+      case PrimitiveType::Clear:
+        clearRect_(rect, primitive.colors[0]);
+        break;
+      case PrimitiveType::Triangle:
+        drawTriangle_(primitive, rect);
+        break;
+      case PrimitiveType::Line:
+        drawLine_(primitive, rect);
+        break;
+      case PrimitiveType::Point:
+        drawPoint_(primitive, rect);
+        break;
+      }
+    }
+    bin.clear();
+  }
+}
+
+void SoftwareScreen::clearRect_(const Rect &rect, uint32_t color) {
+  for (auto y{rect.y0}; y < rect.y1; ++y) {
+    const auto row{size_t(y) * width_};
+    std::fill(backBuffer_.begin() + row + rect.x0,
+              backBuffer_.begin() + row + rect.x1, color);
+    std::fill(depthBuffer_.begin() + row + rect.x0,
+              depthBuffer_.begin() + row + rect.x1, 1.0f);
+  }
+}
+
+void SoftwareScreen::drawTriangle_(const Primitive &triangle,
+                                   const Rect &rect) {
+  const auto &[v1, v2, v3]{triangle.vertices};
+  if ((std::max)({std::abs(v1.x), std::abs(v1.y), std::abs(v2.x),
+                  std::abs(v2.y), std::abs(v3.x), std::abs(v3.y)}) <=
+      maxRasterCoordinate) {
+    rasterizeTriangle({backBuffer_.data(), depthBuffer_.data(), width_,
+                       rect.x0, rect.y0, rect.x1, rect.y1},
+                      triangle.vertices, triangle.colors);
+    return;
+  }
+
+  // vertices this far out don't fit in fixed point, so these triangles are
+  // sampled in floating point, one pixel at a time
+  const auto area{edge(v1, v2, v3.x, v3.y)};
+  const auto minX{(std::max)(
+      static_cast<long long>(std::floor((std::min)({v1.x, v2.x, v3.x}))),
+      rect.x0)},
+      maxX{(std::min)(
+          static_cast<long long>(std::ceil((std::max)({v1.x, v2.x, v3.x}))),
+          rect.x1)},
+      minY{(std::max)(
+          static_cast<long long>(std::floor((std::min)({v1.y, v2.y, v3.y}))),
+          rect.y0)},
+      maxY{(std::min)(
+          static_cast<long long>(std::ceil((std::max)({v1.y, v2.y, v3.y}))),
+          rect.y1)};
+  const bool topLeft[3]{isTopLeft(v2, v3), isTopLeft(v3, v1),
+                        isTopLeft(v1, v2)};
+  float channels[3][4];
+  for (size_t v{}; v < 3; ++v)
+    for (size_t i{}; i < 4; ++i)
+      channels[v][i] = float(triangle.colors[v] >> (8 * i) & 0xFF);
+
+  for (auto y{minY}; y < maxY; ++y) {
+    for (auto x{minX}; x < maxX; ++x) {
+      // sampled at the center of the pixel
+      const auto px{float(x) + 0.5f}, py{float(y) + 0.5f};
+      const float weights[3]{edge(v2, v3, px, py), edge(v3, v1, px, py),
+                             edge(v1, v2, px, py)};
+      bool inside{true};
+      for (size_t i{}; i < 3; ++i)
+        inside &= weights[i] > 0 || (weights[i] == 0 && topLeft[i]);
+      if (!inside)
+        continue;
+      const auto b1{weights[0] / area}, b2{weights[1] / area},
+          b3{weights[2] / area};
+      uint32_t color{};
+      for (size_t i{}; i < 4; ++i)
+        color |= uint32_t(channels[0][i] * b1 + channels[1][i] * b2 +
+                          channels[2][i] * b3 + 0.5f)
+                 << (8 * i);
+      plot_(x, y, v1.z * b1 + v2.z * b2 + v3.z * b3, color, rect);
+    }
+  }
+}
+
+void SoftwareScreen::drawLine_(const Primitive &line, const Rect &rect) {
+  const auto &a{line.vertices[0]}, &b{line.vertices[1]};
+  // the steps depend on the whole line rather than on the tile, so the tiles
+  // it crosses agree on which pixels it covers
+  const auto steps{lineSteps(a, b)};
+  float enter, exit;
+  if (!clipSegment(a, b, float(rect.x0 - 1), float(rect.y0 - 1),
+                   float(rect.x1 + 1), float(rect.y1 + 1), enter, exit))
+    return;
+  const auto first{(std::max)(std::floor(enter * steps) - 1, 0.0f)},
+      last{(std::min)(std::ceil(exit * steps) + 1, steps)};
+  const auto d{b - a};
+  for (auto i{first}; i <= last; ++i) {
+    const auto p{a + d * (i / steps)};
+    plot_(static_cast<long long>(std::floor(p.x)),
+          static_cast<long long>(std::floor(p.y)), p.z, line.colors[0], rect);
+  }
+}
+
+void SoftwareScreen::drawPoint_(const Primitive &point, const Rect &rect) {
+  const auto &p{point.vertices[0]};
+  const auto cx{static_cast<long long>(std::floor(p.x))},
+      cy{static_cast<long long>(std::floor(p.y))};
+  for (auto y{cy - 2}; y <= cy + 2; ++y)
+    for (auto x{cx - 2}; x <= cx + 2; ++x)
+      plot_(x, y, p.z, point.colors[0], rect);
+}
+
+void SoftwareScreen::plot_(long long x, long long y, float z, uint32_t color,
+                           const Rect &rect) {
+  if (x < rect.x0 || y < rect.y0 || x >= rect.x1 || y >= rect.y1 || z < 0 ||
+      z > 1)
+    return;
+  const auto i{size_t(y) * width_ + size_t(x)};
+  if (z >= depthBuffer_[i])
+    return;
+  depthBuffer_[i] = z;
+  backBuffer_[i] = color;
+}
+
+SoftwareScreen::Rect SoftwareScreen::tileRect_(size_t tile) const {
+  const auto x{static_cast<long long>((tile % tilesX_) * tileSize)},
+      y{static_cast<long long>((tile / tilesX_) * tileSize)};
+  return {x, y,
+          (std::min)(x + static_cast<long long>(tileSize),
+                     static_cast<long long>(width_)),
+          (std::min)(y + static_cast<long long>(tileSize),
+                     static_cast<long long>(height_))};
+}
+
+} // namespace vbag
@@ -0,0 +1,284 @@
+#include "output/terminal_screen.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace vbag {
+
+namespace {
+
+constexpr uint32_t upperHalfBlock{0x2580}, brailleBlank{0x2800};
+
+/// @brief A pixel lights its braille dot when any of its channels is above
+/// this.
+constexpr uint8_t brailleThreshold{48};
+
+/// @brief The braille dot of every pixel of a cell, by row and column.
+constexpr uint8_t brailleDots[TerminalScreen::cellHeight]
+                             [TerminalScreen::cellWidth]{
+                                 {0x01, 0x08},
+                                 {0x02, 0x10},
+                                 {0x04, 0x20},
+                                 {0x40, 0x80}};
+
+/// @brief Drops the alpha of a 0xAABBGGRR pixel and turns it into 0xRRGGBB.
+uint32_t toRgb(uint32_t pixel) {
+  return (pixel & 0xFFu) << 16 | (pixel & 0xFF00u) | (pixel >> 16 & 0xFFu);
+}
+
+/// @brief Averages two pixels channel by channel, rounding up like SSE2's
+/// pavgb does.
+uint32_t average(uint32_t a, uint32_t b) {
+  uint32_t result{};
+  for (unsigned shift{}; shift < 32; shift += 8)
+    result |= (((a >> shift & 0xFF) + (b >> shift & 0xFF) + 1) >> 1) << shift;
+  return result;
+}
+
+uint32_t channelMax(uint32_t a, uint32_t b) {
+  uint32_t result{};
+  for (unsigned shift{}; shift < 32; shift += 8)
+    result |= (std::max)(a >> shift & 0xFF, b >> shift & 0xFF) << shift;
+  return result;
+}
+
+bool isLit(uint32_t pixel) {
+  return (pixel & 0xFF) > brailleThreshold ||
+         (pixel >> 8 & 0xFF) > brailleThreshold ||
+         (pixel >> 16 & 0xFF) > brailleThreshold;
+}
+
+void appendNumber(std::string &output, size_t value) {
+  char digits[20];
+  const auto end{std::to_chars(digits, digits + sizeof(digits), value).ptr};
+  output.append(digits, end);
+}
+
+void appendColor(std::string &output, uint32_t rgb) {
+  appendNumber(output, rgb >> 16 & 0xFF);
+  output += ';';
+  appendNumber(output, rgb >> 8 & 0xFF);
+  output += ';';
+  appendNumber(output, rgb & 0xFF);
+}
+
+void appendUtf8(std::string &output, uint32_t codePoint) {
+  if (codePoint < 0x80) {
+    output += char(codePoint);
+    return;
+  }
+  // everything drawn is in the basic multilingual plane
+  output += char(0xE0 | codePoint >> 12);
+  output += char(0x80 | (codePoint >> 6 & 0x3F));
+  output += char(0x80 | (codePoint & 0x3F));
+}
+
+} // namespace
+
+TerminalScreen::TerminalScreen(size_t columns, size_t rows,
+                               TerminalGlyphs glyphs, int fd, size_t threads)
+    : SoftwareScreen{columns * cellWidth, rows * cellHeight, threads},
+      columns_{columns}, rows_{rows}, glyphs_{glyphs}, fd_{fd},
+      cells_(columns * rows), previousCells_(columns * rows) {
+#if defined(_WIN32)
+  // consoles only understand escape sequences when asked to
+  const auto console{GetStdHandle(STD_OUTPUT_HANDLE)};
+  DWORD mode{};
+  if (GetConsoleMode(console, &mode))
+    SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+TerminalScreen::~TerminalScreen() {
+  if (!hasPresented_)
+    return;
+  // resets the colors, shows the cursor and leaves it below the frame
+  std::string restore{"\x1b[0m\x1b[?25h\x1b["};
+  appendNumber(restore, rows_ + 1);
+  restore += ";1H";
+  write_(restore);
+}
+
+void TerminalScreen::present() {
+  SoftwareScreen::present();
+  downsample_();
+  output_.clear();
+  if (!hasPresented_) {
+    // hides the cursor and clears the terminal, so every cell is drawn
+    output_ += "\x1b[?25l\x1b[2J";
+    std::fill(previousCells_.begin(), previousCells_.end(), Cell{});
+    hasPresented_ = true;
+  }
+  encode_();
+  write_(output_);
+  cells_.swap(previousCells_);
+}
+
+size_t TerminalScreen::lastFrameBytes() const { return output_.size(); }
+
+void TerminalScreen::downsample_() {
+  const auto *pixels{this->pixels()};
+  const auto stride{width()};
+  for (size_t row{}; row < rows_; ++row) {
+    size_t column{};
+#if defined(__SSE2__) || defined(_M_X64)
+    // two cells at a time: every register holds a row of both of them
+    const auto *block{pixels + row * cellHeight * stride};
+    const auto rgbMask{_mm_set1_epi32(0x00FFFFFF)},
+        threshold{_mm_set1_epi8(char(brailleThreshold))},
+        zero{_mm_setzero_si128()};
+    for (; column + 2 <= columns_; column += 2) {
+      __m128i lines[cellHeight];
+      for (size_t i{}; i < cellHeight; ++i)
+        lines[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+            block + i * stride + column * cellWidth));
+      auto &left{cells_[row * columns_ + column]},
+          &right{cells_[row * columns_ + column + 1]};
+      if (glyphs_ == TerminalGlyphs::HalfBlocks) {
+        // averages the rows of each half, then the columns
+        auto top{_mm_avg_epu8(lines[0], lines[1])},
+            bottom{_mm_avg_epu8(lines[2], lines[3])};
+        top = _mm_avg_epu8(top, _mm_shuffle_epi32(top, 0xB1));
+        bottom = _mm_avg_epu8(bottom, _mm_shuffle_epi32(bottom, 0xB1));
+        const auto upper{_mm_srli_si128(top, 8)},
+            lower{_mm_srli_si128(bottom, 8)};
+        left = halfBlock_(uint32_t(_mm_cvtsi128_si32(top)),
+                          uint32_t(_mm_cvtsi128_si32(bottom)));
+        right = halfBlock_(uint32_t(_mm_cvtsi128_si32(upper)),
+                           uint32_t(_mm_cvtsi128_si32(lower)));
+      } else {
+        uint32_t dots[2]{};
+        auto brightest{zero};
+        for (size_t i{}; i < cellHeight; ++i) {
+          // pixels whose channels are all at most the threshold go to zero
+          const auto dark{_mm_cmpeq_epi32(
+              _mm_subs_epu8(_mm_and_si128(lines[i], rgbMask), threshold),
+              zero)};
+          const auto lit{~_mm_movemask_ps(_mm_castsi128_ps(dark)) & 0xF};
+          for (size_t cell{}; cell < 2; ++cell)
+            for (size_t x{}; x < cellWidth; ++x)
+              if (lit >> (cell * cellWidth + x) & 1)
+                dots[cell] |= brailleDots[i][x];
+          brightest = _mm_max_epu8(brightest, lines[i]);
+        }
+        brightest =
+            _mm_max_epu8(brightest, _mm_shuffle_epi32(brightest, 0xB1));
+        const uint32_t colors[2]{
+            toRgb(uint32_t(_mm_cvtsi128_si32(brightest))),
+            toRgb(uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(brightest, 8))))};
+        for (size_t cell{}; cell < 2; ++cell)
+          cells_[row * columns_ + column + cell] =
+              dots[cell] ? Cell{brailleBlank + dots[cell], colors[cell], 0}
+                         : Cell{' ', 0, 0};
+      }
+    }
+#endif
+    for (; column < columns_; ++column)
+      cells_[row * columns_ + column] = cell_(column, row);
+  }
+}
+
+TerminalScreen::Cell TerminalScreen::halfBlock_(uint32_t top,
+                                               uint32_t bottom) {
+  top = toRgb(top);
+  bottom = toRgb(bottom);
+  if (top == bottom)
+    return {' ', bottom, bottom};
+  return {upperHalfBlock, top, bottom};
+}
+
+TerminalScreen::Cell TerminalScreen::cell_(size_t column, size_t row) const {
+  const auto stride{width()};
+  const auto *block{pixels() + row * cellHeight * stride + column * cellWidth};
+  const auto at{[&](size_t x, size_t y) { return block[y * stride + x]; }};
+  if (glyphs_ == TerminalGlyphs::HalfBlocks) {
+    const auto top{average(average(at(0, 0), at(0, 1)),
+                           average(at(1, 0), at(1, 1)))},
+        bottom{average(average(at(0, 2), at(0, 3)),
+                       average(at(1, 2), at(1, 3)))};
+    return halfBlock_(top, bottom);
+  }
+  uint32_t dots{}, brightest{};
+  for (size_t y{}; y < cellHeight; ++y) {
+    for (size_t x{}; x < cellWidth; ++x) {
+      if (isLit(at(x, y)))
+        dots |= brailleDots[y][x];
+      brightest = channelMax(brightest, at(x, y));
+    }
+  }
+  return dots ? Cell{brailleBlank + dots, toRgb(brightest), 0}
+              : Cell{' ', 0, 0};
+}
+
+void TerminalScreen::encode_() {
+  // where the cursor is and which colors are set, as far as this frame knows
+  size_t cursor{cells_.size()};
+  auto foreground{~uint32_t{}}, background{~uint32_t{}};
+  for (size_t i{}; i < cells_.size(); ++i) {
+    const auto &cell{cells_[i]};
+    if (cell == previousCells_[i])
+      continue;
+    if (cursor != i) {
+      output_ += "\x1b[";
+      appendNumber(output_, i / columns_ + 1);
+      output_ += ';';
+      appendNumber(output_, i % columns_ + 1);
+      output_ += 'H';
+    }
+    const auto needsForeground{cell.glyph != ' ' &&
+                               cell.foreground != foreground},
+        needsBackground{cell.background != background};
+    if (needsForeground || needsBackground) {
+      output_ += "\x1b[";
+      if (needsForeground) {
+        output_ += "38;2;";
+        appendColor(output_, cell.foreground);
+        foreground = cell.foreground;
+      }
+      if (needsBackground) {
+        output_ += needsForeground ? ";48;2;" : "48;2;";
+        appendColor(output_, cell.background);
+        background = cell.background;
+      }
+      output_ += 'm';
+    }
+    appendUtf8(output_, cell.glyph);
+    // the cursor wraps to the next row by itself, except after the last
+    // column, where it stays put until the next character
+    cursor = (i + 1) % columns_ ? i + 1 : cells_.size();
+  }
+}
+
+void TerminalScreen::write_(const std::string &bytes) const {
+  const auto *data{bytes.data()};
+  auto left{bytes.size()};
+  // a single call, unless the descriptor takes less than everything at once
+  while (left) {
+#if defined(_WIN32)
+    const auto written{_write(fd_, data, unsigned(left))};
+#else
+    const auto written{::write(fd_, data, left)};
+#endif
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    data += written;
+    left -= size_t(written);
+  }
+}
+
+} // namespace vbag
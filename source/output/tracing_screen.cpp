@@ -0,0 +1,294 @@
+#include "output/tracing_screen.hpp"
+
+#include <cstring>
+
+#include "util/error_handling.hpp"
+
+namespace vbag {
+
+namespace {
+
+constexpr char traceMagic[8]{'V', 'B', 'A', 'G', 'T', 'R', 'C', '1'};
+constexpr size_t headerSize{sizeof(traceMagic) + 2 * sizeof(uint32_t)};
+
+static_assert(sizeof(V3F) == 12 && sizeof(Line) == 28,
+              "the trace format stores vertices and lines as they are");
+
+[[noreturn]] void malformed() { throw RuntimeError<MalformedTraceFile>{}; }
+
+} // namespace
+
+TracingScreen::TracingScreen(Screen &screen, const std::string &path)
+    : screen_{screen}, file_{std::fopen(path.c_str(), "wb")} {
+  if (!file_)
+    throw RuntimeError<CouldNotOpenFile>{};
+  write_(traceMagic, sizeof(traceMagic));
+  writeCount_(screen_.width());
+  writeCount_(screen_.height());
+}
+
+TracingScreen::~TracingScreen() {
+  std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+  std::fclose(file_);
+}
+
+void TracingScreen::clear() {
+  write_(TraceCommand::Clear);
+  screen_.clear();
+}
+
+size_t TracingScreen::width() const { return screen_.width(); }
+
+size_t TracingScreen::height() const { return screen_.height(); }
+
+void TracingScreen::drawLine(const Line &line) {
+  write_(TraceCommand::DrawLine);
+  write_(&line, sizeof(line));
+  screen_.drawLine(line);
+}
+
+void TracingScreen::drawLines(const Line *lines, size_t n) {
+  write_(TraceCommand::DrawLines);
+  writeCount_(n);
+  write_(lines, n * sizeof(Line));
+  screen_.drawLines(lines, n);
+}
+
+void TracingScreen::drawTriangle(V3F v1, V3F v2, V3F v3, D3DCOLOR c1,
+                                 D3DCOLOR c2, D3DCOLOR c3) {
+  const V3F vertices[3]{v1, v2, v3};
+  const D3DCOLOR colors[3]{c1, c2, c3};
+  write_(TraceCommand::DrawTriangle);
+  write_(vertices, sizeof(vertices));
+  write_(colors, sizeof(colors));
+  screen_.drawTriangle(v1, v2, v3, c1, c2, c3);
+}
+
+void TracingScreen::drawPoint(V3F p) {
+  write_(TraceCommand::DrawPoint);
+  write_(&p, sizeof(p));
+  screen_.drawPoint(p);
+}
+
+void TracingScreen::drawTriangles(std::span<const V3F> vertices,
+                                  std::span<const D3DCOLOR> colors) {
+  write_(TraceCommand::DrawTriangles);
+  writeCount_(vertices.size());
+  write_(vertices.data(), vertices.size_bytes());
+  write_(colors.data(), vertices.size() * sizeof(D3DCOLOR));
+  screen_.drawTriangles(vertices, colors);
+}
+
+void TracingScreen::drawIndexedTriangles(std::span<const V3F> vertices,
+                                         std::span<const D3DCOLOR> colors,
+                                         std::span<const uint32_t> indices) {
+  write_(TraceCommand::DrawIndexedTriangles);
+  writeCount_(vertices.size());
+  writeCount_(indices.size());
+  write_(vertices.data(), vertices.size_bytes());
+  write_(colors.data(), vertices.size() * sizeof(D3DCOLOR));
+  write_(indices.data(), indices.size_bytes());
+  screen_.drawIndexedTriangles(vertices, colors, indices);
+}
+
+void TracingScreen::drawPoints(std::span<const V3F> points) {
+  write_(TraceCommand::DrawPoints);
+  writeCount_(points.size());
+  write_(points.data(), points.size_bytes());
+  screen_.drawPoints(points);
+}
+
+void TracingScreen::present() {
+  write_(TraceCommand::Present);
+  screen_.present();
+  const auto written{std::fwrite(buffer_.data(), 1, buffer_.size(), file_)};
+  const auto size{buffer_.size()};
+  buffer_.clear();
+  if (written != size)
+    throw RuntimeError<CouldNotOpenFile>{};
+}
+
+const float *TracingScreen::depth() const { return screen_.depth(); }
+
+#if defined(_WIN32)
+HWND TracingScreen::window() { return screen_.window(); }
+#endif
+
+void TracingScreen::write_(TraceCommand command) {
+  buffer_.push_back(uint8_t(command));
+}
+
+void TracingScreen::write_(const void *data, size_t size) {
+  if (!size)
+    return;
+  const auto offset{buffer_.size()};
+  buffer_.resize(offset + size);
+  std::memcpy(buffer_.data() + offset, data, size);
+}
+
+void TracingScreen::writeCount_(size_t count) {
+  const auto value{uint32_t(count)};
+  write_(&value, sizeof(value));
+}
+
+TraceReplayer::TraceReplayer(const std::string &path) : file_{path} {
+  const auto *data{file_.data()};
+  const auto *const end{data + file_.size()};
+  if (file_.size() < headerSize ||
+      std::memcmp(data, traceMagic, sizeof(traceMagic)))
+    malformed();
+  uint32_t width, height;
+  std::memcpy(&width, data + sizeof(traceMagic), sizeof(width));
+  std::memcpy(&height, data + sizeof(traceMagic) + sizeof(width),
+              sizeof(height));
+  width_ = width;
+  height_ = height;
+
+  // walks the whole trace once, so replaying frames needs no checks
+  const auto *cursor{data + headerSize};
+  frames_.push_back(headerSize);
+  const auto count{[&] {
+    if (size_t(end - cursor) < sizeof(uint32_t))
+      malformed();
+    uint32_t value;
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return size_t(value);
+  }};
+  while (cursor < end) {
+    const auto command{TraceCommand(*cursor++)};
+    size_t size{};
+    switch (command) {
+    case TraceCommand::Clear:
+    case TraceCommand::Present:
+      break;
+    case TraceCommand::DrawLine:
+      size = sizeof(Line);
+      break;
+    case TraceCommand::DrawLines:
+      size = count() * sizeof(Line);
+      break;
+    case TraceCommand::DrawTriangle:
+      size = 3 * (sizeof(V3F) + sizeof(D3DCOLOR));
+      break;
+    case TraceCommand::DrawPoint:
+      size = sizeof(V3F);
+      break;
+    case TraceCommand::DrawTriangles:
+    case TraceCommand::DrawPoints:
+      size = count() * (command == TraceCommand::DrawPoints
+                            ? sizeof(V3F)
+                            : sizeof(V3F) + sizeof(D3DCOLOR));
+      break;
+    case TraceCommand::DrawIndexedTriangles: {
+      const auto vertices{count()}, indices{count()};
+      const auto vertexSize{vertices * (sizeof(V3F) + sizeof(D3DCOLOR))};
+      size = vertexSize + indices * sizeof(uint32_t);
+      if (size_t(end - cursor) < size)
+        malformed();
+      // replaying would read past the vertices otherwise
+      for (size_t i{}; i < indices; ++i) {
+        uint32_t index;
+        std::memcpy(&index, cursor + vertexSize + i * sizeof(index),
+                    sizeof(index));
+        if (index >= vertices)
+          malformed();
+      }
+      break;
+    }
+    default:
+      malformed();
+    }
+    if (size_t(end - cursor) < size)
+      malformed();
+    cursor += size;
+    if (command == TraceCommand::Present)
+      frames_.push_back(size_t(cursor - data));
+  }
+}
+
+size_t TraceReplayer::width() const { return width_; }
+
+size_t TraceReplayer::height() const { return height_; }
+
+size_t TraceReplayer::frameCount() const { return frames_.size() - 1; }
+
+void TraceReplayer::replay(size_t frame, Screen &screen) {
+  const auto *cursor{file_.data() + frames_[frame]};
+  for (;;) {
+    const auto command{TraceCommand(*cursor++)};
+    switch (command) {
+    case TraceCommand::Clear:
+      screen.clear();
+      break;
+    case TraceCommand::DrawLine: {
+      Line line;
+      read_(cursor, &line, sizeof(line));
+      screen.drawLine(line);
+      break;
+    }
+    case TraceCommand::DrawLines:
+      readList_(cursor, lines_);
+      read_(cursor, lines_.data(), lines_.size() * sizeof(Line));
+      screen.drawLines(lines_.data(), lines_.size());
+      break;
+    case TraceCommand::DrawTriangle: {
+      V3F vertices[3];
+      D3DCOLOR colors[3];
+      read_(cursor, vertices, sizeof(vertices));
+      read_(cursor, colors, sizeof(colors));
+      screen.drawTriangle(vertices[0], vertices[1], vertices[2], colors[0],
+                          colors[1], colors[2]);
+      break;
+    }
+    case TraceCommand::DrawPoint: {
+      V3F point;
+      read_(cursor, &point, sizeof(point));
+      screen.drawPoint(point);
+      break;
+    }
+    case TraceCommand::DrawTriangles:
+      readList_(cursor, vertices_);
+      colors_.resize(vertices_.size());
+      read_(cursor, vertices_.data(), vertices_.size() * sizeof(V3F));
+      read_(cursor, colors_.data(), colors_.size() * sizeof(D3DCOLOR));
+      screen.drawTriangles(vertices_, colors_);
+      break;
+    case TraceCommand::DrawIndexedTriangles:
+      readList_(cursor, vertices_);
+      readList_(cursor, indices_);
+      colors_.resize(vertices_.size());
+      read_(cursor, vertices_.data(), vertices_.size() * sizeof(V3F));
+      read_(cursor, colors_.data(), colors_.size() * sizeof(D3DCOLOR));
+      read_(cursor, indices_.data(), indices_.size() * sizeof(uint32_t));
+      screen.drawIndexedTriangles(vertices_, colors_, indices_);
+      break;
+    case TraceCommand::DrawPoints:
+      readList_(cursor, vertices_);
+      read_(cursor, vertices_.data(), vertices_.size() * sizeof(V3F));
+      screen.drawPoints(vertices_);
+      break;
+    case TraceCommand::Present:
+      screen.present();
+      return;
+    }
+  }
+}
+
+void TraceReplayer::read_(const char *&cursor, void *data,
+                          size_t size) const {
+  // the trace is only byte aligned, so everything is copied out of it
+  if (size)
+    std::memcpy(data, cursor, size);
+  cursor += size;
+}
+
+template <typename T>
+void TraceReplayer::readList_(const char *&cursor,
+                              std::vector<T> &list) const {
+  uint32_t count;
+  read_(cursor, &count, sizeof(count));
+  list.resize(count);
+}
+
+} // namespace vbag
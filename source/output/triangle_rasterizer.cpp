@@ -0,0 +1,481 @@
+#include "output/triangle_rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__) ||          \
+    defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace vbag {
+
+namespace {
+
+/// @brief Vertices are snapped to 1/16th of a pixel.
+constexpr int subpixelBits{4};
+constexpr long long subpixels{1 << subpixelBits};
+
+/// @brief The height of the blocks the bounding box is walked in.
+constexpr long long blockHeight{8};
+
+// every instruction set gets a struct with the same operations on a
+// register of floats (F), one of 32-bit integers (I) and a lane mask (M), so
+// a single kernel can be written for all of them
+
+struct ScalarLanes {
+  static constexpr int width{1};
+  using F = float;
+  using I = int32_t;
+  using M = bool;
+
+  static F splat(float v) { return v; }
+  static I splat(int32_t v) { return v; }
+  static F load(const float *p) { return *p; }
+  static I load(const int32_t *p) { return *p; }
+  static I load(const uint32_t *p) { return int32_t(*p); }
+  static F add(F a, F b) { return a + b; }
+  static I add(I a, I b) { return a + b; }
+  static F min(F a, F b) { return a < b ? a : b; }
+  static F max(F a, F b) { return a > b ? a : b; }
+  static I bitOr(I a, I b) { return a | b; }
+  template <int bits> static I shiftLeft(I v) {
+    return int32_t(uint32_t(v) << bits);
+  }
+  static I toInt(F v) { return int32_t(std::nearbyint(v)); }
+  static M nonNegative(I v) { return v >= 0; }
+  static M less(F a, F b) { return a < b; }
+  static M greaterEqual(F a, F b) { return a >= b; }
+  static M both(M a, M b) { return a && b; }
+  static M all() { return true; }
+  static bool any(M m) { return m; }
+  static F select(M m, F a, F b) { return m ? a : b; }
+  static void store(float *p, M m, F v) {
+    if (m)
+      *p = v;
+  }
+  static void store(uint32_t *p, M m, I v) {
+    if (m)
+      *p = uint32_t(v);
+  }
+};
+
+#if defined(__AVX512F__)
+
+// the zero-masked forms of some of the intrinsics are used because the plain
+// ones trip -Wmaybe-uninitialized in the headers of some versions of gcc; with
+// every lane enabled they compile to the same instructions
+
+struct SimdLanes {
+  static constexpr int width{16};
+  static constexpr __mmask16 allLanes{0xFFFF};
+
+  using F = __m512;
+  using I = __m512i;
+  using M = __mmask16;
+
+  static F splat(float v) { return _mm512_set1_ps(v); }
+  static I splat(int32_t v) { return _mm512_set1_epi32(v); }
+  static F load(const float *p) { return _mm512_loadu_ps(p); }
+  static I load(const int32_t *p) { return _mm512_loadu_si512(p); }
+  static F add(F a, F b) { return _mm512_add_ps(a, b); }
+  static I add(I a, I b) { return _mm512_add_epi32(a, b); }
+  static F min(F a, F b) { return _mm512_maskz_min_ps(allLanes, a, b); }
+  static F max(F a, F b) { return _mm512_maskz_max_ps(allLanes, a, b); }
+  static I bitOr(I a, I b) { return _mm512_or_si512(a, b); }
+  template <int bits> static I shiftLeft(I v) {
+    return _mm512_maskz_slli_epi32(allLanes, v, bits);
+  }
+  static I toInt(F v) { return _mm512_maskz_cvtps_epi32(allLanes, v); }
+  static M nonNegative(I v) {
+    return _mm512_cmpge_epi32_mask(v, _mm512_setzero_si512());
+  }
+  static M less(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static M greaterEqual(F a, F b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+  }
+  static M both(M a, M b) { return M(a & b); }
+  static M all() { return allLanes; }
+  static bool any(M m) { return m != 0; }
+  static F select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+  static void store(float *p, M m, F v) { _mm512_mask_storeu_ps(p, m, v); }
+  static void store(uint32_t *p, M m, I v) {
+    _mm512_mask_storeu_epi32(p, m, v);
+  }
+};
+
+constexpr auto instructionSet{"AVX-512"};
+
+#elif defined(__AVX2__)
+
+struct SimdLanes {
+  static constexpr int width{8};
+  using F = __m256;
+  using I = __m256i;
+  using M = __m256i;
+
+  static F splat(float v) { return _mm256_set1_ps(v); }
+  static I splat(int32_t v) { return _mm256_set1_epi32(v); }
+  static F load(const float *p) { return _mm256_loadu_ps(p); }
+  static I load(const int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static F add(F a, F b) { return _mm256_add_ps(a, b); }
+  static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+  static F min(F a, F b) { return _mm256_min_ps(a, b); }
+  static F max(F a, F b) { return _mm256_max_ps(a, b); }
+  static I bitOr(I a, I b) { return _mm256_or_si256(a, b); }
+  template <int bits> static I shiftLeft(I v) {
+    return _mm256_slli_epi32(v, bits);
+  }
+  static I toInt(F v) { return _mm256_cvtps_epi32(v); }
+  static M nonNegative(I v) {
+    return _mm256_cmpgt_epi32(v, _mm256_set1_epi32(-1));
+  }
+  static M less(F a, F b) {
+    return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+  static M greaterEqual(F a, F b) {
+    return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GE_OQ));
+  }
+  static M both(M a, M b) { return _mm256_and_si256(a, b); }
+  static M all() { return _mm256_set1_epi32(-1); }
+  static bool any(M m) { return !_mm256_testz_si256(m, m); }
+  static F select(M m, F a, F b) {
+    return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(m));
+  }
+  static void store(float *p, M m, F v) { _mm256_maskstore_ps(p, m, v); }
+  static void store(uint32_t *p, M m, I v) {
+    _mm256_maskstore_epi32(reinterpret_cast<int *>(p), m, v);
+  }
+};
+
+constexpr auto instructionSet{"AVX2"};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct SimdLanes {
+  static constexpr int width{4};
+  using F = __m128;
+  using I = __m128i;
+  using M = __m128i;
+
+  static F splat(float v) { return _mm_set1_ps(v); }
+  static I splat(int32_t v) { return _mm_set1_epi32(v); }
+  static F load(const float *p) { return _mm_loadu_ps(p); }
+  static I load(const int32_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+  static F add(F a, F b) { return _mm_add_ps(a, b); }
+  static I add(I a, I b) { return _mm_add_epi32(a, b); }
+  static F min(F a, F b) { return _mm_min_ps(a, b); }
+  static F max(F a, F b) { return _mm_max_ps(a, b); }
+  static I bitOr(I a, I b) { return _mm_or_si128(a, b); }
+  template <int bits> static I shiftLeft(I v) {
+    return _mm_slli_epi32(v, bits);
+  }
+  static I toInt(F v) { return _mm_cvtps_epi32(v); }
+  static M nonNegative(I v) { return _mm_cmpgt_epi32(v, _mm_set1_epi32(-1)); }
+  static M less(F a, F b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+  static M greaterEqual(F a, F b) {
+    return _mm_castps_si128(_mm_cmpge_ps(a, b));
+  }
+  static M both(M a, M b) { return _mm_and_si128(a, b); }
+  static M all() { return _mm_set1_epi32(-1); }
+  static bool any(M m) { return _mm_movemask_epi8(m) != 0; }
+  static F select(M m, F a, F b) {
+    const auto mask{_mm_castsi128_ps(m)};
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+  static void store(float *p, M m, F v) {
+    _mm_storeu_ps(p, select(m, v, _mm_loadu_ps(p)));
+  }
+  static void store(uint32_t *p, M m, I v) {
+    auto *q{reinterpret_cast<__m128i *>(p)};
+    const auto old{_mm_loadu_si128(q)};
+    _mm_storeu_si128(q, _mm_or_si128(_mm_and_si128(m, v),
+                                     _mm_andnot_si128(m, old)));
+  }
+};
+
+constexpr auto instructionSet{"SSE2"};
+
+#else
+
+using SimdLanes = ScalarLanes;
+
+constexpr auto instructionSet{"scalar"};
+
+#endif
+
+/// @brief The width of the blocks the bounding box is walked in: a whole
+/// register per row, but at least 8 pixels.
+constexpr long long blockWidth{(std::max)(SimdLanes::width, 8)};
+
+/// @brief Depth, red, green, blue and alpha.
+constexpr size_t attributeCount{5};
+
+/// @brief A linear function of the pixel coordinates, evaluated at pixel
+/// centers.
+struct Plane {
+  double base, dx, dy;
+
+  [[nodiscard]] double at(long long x, long long y) const {
+    return base + dx * double(x) + dy * double(y);
+  }
+};
+
+/// @brief An edge function, in 1/16ths of a pixel squared, at pixel centers:
+/// e(x, y) = a x + b y + c. Pixels are inside when it's not negative.
+struct Edge {
+  long long a, b, c;
+
+  [[nodiscard]] long long at(long long x, long long y) const {
+    return a * x + b * y + c;
+  }
+};
+
+/// @brief What every block of a triangle needs to know.
+struct Triangle {
+  Edge edges[3];
+  Plane attributes[attributeCount];
+  /// @brief How much each edge function grows from lane to lane.
+  alignas(64) int32_t edgeRamps[3][SimdLanes::width];
+  /// @brief How much each attribute grows from lane to lane.
+  alignas(64) float attributeRamps[attributeCount][SimdLanes::width];
+};
+
+/// @brief Everything about one block a row of pixels needs: where the edge
+/// functions of the straddling edges start, and where the attributes start.
+struct Block {
+  long long x, y;
+  int32_t edgeStart[3], edgeStepX[3], edgeStepY[3];
+  bool testEdge[3];
+  float attributeStart[attributeCount], attributeStepX[attributeCount],
+      attributeStepY[attributeCount];
+};
+
+/// @brief Calls f(0), f(1), ..., f(n - 1), unrolled, so that arrays of
+/// registers indexed by the calls can stay in registers.
+template <size_t n, typename Function> void unrolled(Function &&f) {
+  [&]<size_t... i>(std::index_sequence<i...>) {
+    (f(i), ...);
+  }(std::make_index_sequence<n>{});
+}
+
+/// @brief Shades a column of Lanes::width pixels of a block, starting at
+/// column x of the block, from its first row down to the given one.
+template <typename Lanes>
+void shadeColumn(const Triangle &triangle, const Block &block,
+                 const RasterTarget &target, long long x, long long rows) {
+  using F = typename Lanes::F;
+  using I = typename Lanes::I;
+  using M = typename Lanes::M;
+
+  // zeros let lanes narrower than the ramps (the scalar tail) reuse the code
+  static constexpr int32_t zeroEdges[SimdLanes::width]{};
+  static constexpr float zeroAttributes[SimdLanes::width]{};
+
+  // the values of the first row, which are stepped down row by row
+  I edges[3], edgeSteps[3];
+  unrolled<3>([&](size_t i) {
+    const auto *ramp{Lanes::width == SimdLanes::width ? triangle.edgeRamps[i]
+                                                      : zeroEdges};
+    edges[i] = Lanes::add(
+        Lanes::splat(block.edgeStart[i] + block.edgeStepX[i] * int32_t(x)),
+        Lanes::load(ramp));
+    edgeSteps[i] = Lanes::splat(block.edgeStepY[i]);
+  });
+  F values[attributeCount], valueSteps[attributeCount];
+  unrolled<attributeCount>([&](size_t i) {
+    const auto *ramp{Lanes::width == SimdLanes::width
+                         ? triangle.attributeRamps[i]
+                         : zeroAttributes};
+    values[i] = Lanes::add(Lanes::splat(block.attributeStart[i] +
+                                        block.attributeStepX[i] * float(x)),
+                           Lanes::load(ramp));
+    valueSteps[i] = Lanes::splat(block.attributeStepY[i]);
+  });
+  const auto low{Lanes::splat(0.0f)}, high{Lanes::splat(255.0f)};
+
+  auto offset{size_t(block.y) * target.stride + size_t(block.x + x)};
+  for (long long row{}; row < rows; ++row, offset += target.stride) {
+    M mask{Lanes::all()};
+    unrolled<3>([&](size_t i) {
+      if (block.testEdge[i])
+        mask = Lanes::both(mask, Lanes::nonNegative(edges[i]));
+      edges[i] = Lanes::add(edges[i], edgeSteps[i]);
+    });
+    F current[attributeCount];
+    unrolled<attributeCount>([&](size_t i) {
+      current[i] = values[i];
+      values[i] = Lanes::add(values[i], valueSteps[i]);
+    });
+    if (!Lanes::any(mask))
+      continue;
+
+    auto *depth{target.depth + offset};
+    mask = Lanes::both(
+        mask, Lanes::both(Lanes::less(current[0], Lanes::load(depth)),
+                          Lanes::greaterEqual(current[0], low)));
+    if (!Lanes::any(mask))
+      continue;
+    Lanes::store(depth, mask, current[0]);
+    if (!target.color)
+      continue;
+
+    I channels[4];
+    unrolled<4>([&](size_t i) {
+      channels[i] =
+          Lanes::toInt(Lanes::min(Lanes::max(current[i + 1], low), high));
+    });
+    const auto color{Lanes::bitOr(
+        Lanes::bitOr(channels[0], Lanes::template shiftLeft<8>(channels[1])),
+        Lanes::bitOr(Lanes::template shiftLeft<16>(channels[2]),
+                     Lanes::template shiftLeft<24>(channels[3])))};
+    Lanes::store(target.color + offset, mask, color);
+  }
+}
+
+/// @brief Sets up a block and shades the rows of it that are in the target.
+void shadeBlock(const Triangle &triangle, const RasterTarget &target,
+                long long bx, long long by, const bool (&testEdge)[3]) {
+  Block block;
+  block.x = bx;
+  block.y = by;
+  // pixel centers are half a pixel in, hence the 8 sixteenths
+  const auto px{bx * subpixels + subpixels / 2},
+      py{by * subpixels + subpixels / 2};
+  for (size_t i{}; i < 3; ++i) {
+    const auto &edge{triangle.edges[i]};
+    block.testEdge[i] = testEdge[i];
+    // only straddling edges are tested, and those are small enough here
+    block.edgeStart[i] = testEdge[i] ? int32_t(edge.at(px, py)) : 0;
+    block.edgeStepX[i] = int32_t(edge.a * subpixels);
+    block.edgeStepY[i] = int32_t(edge.b * subpixels);
+  }
+  for (size_t i{}; i < attributeCount; ++i) {
+    const auto &plane{triangle.attributes[i]};
+    block.attributeStart[i] = float(plane.at(bx, by));
+    block.attributeStepX[i] = float(plane.dx);
+    block.attributeStepY[i] = float(plane.dy);
+  }
+
+  const auto rows{(std::min)(blockHeight, target.y1 - by)},
+      columns{(std::min)(blockWidth, target.x1 - bx)};
+  long long x{};
+  for (; x + SimdLanes::width <= columns; x += SimdLanes::width)
+    shadeColumn<SimdLanes>(triangle, block, target, x, rows);
+  // the right edge of the target may cut a register short
+  for (; x < columns; ++x)
+    shadeColumn<ScalarLanes>(triangle, block, target, x, rows);
+}
+
+} // namespace
+
+void rasterizeTriangle(const RasterTarget &target, const V3F (&vertices)[3],
+                       const uint32_t (&colors)[3]) {
+  long long xs[3], ys[3];
+  for (size_t i{}; i < 3; ++i) {
+    xs[i] = std::llround(double(vertices[i].x) * double(subpixels));
+    ys[i] = std::llround(double(vertices[i].y) * double(subpixels));
+  }
+  // the edge functions below are positive inside clockwise triangles (on the
+  // screen, where y grows downwards)
+  size_t order[3]{0, 1, 2};
+  auto area{(xs[1] - xs[0]) * (ys[2] - ys[0]) -
+            (ys[1] - ys[0]) * (xs[2] - xs[0])};
+  if (area == 0)
+    return;
+  if (area < 0) {
+    std::swap(order[1], order[2]);
+    area = -area;
+  }
+
+  Triangle triangle;
+  for (size_t i{}; i < 3; ++i) {
+    const auto a{order[(i + 1) % 3]}, b{order[(i + 2) % 3]};
+    const auto dx{xs[b] - xs[a]}, dy{ys[b] - ys[a]};
+    auto &edge{triangle.edges[i]};
+    edge.a = -dy;
+    edge.b = dx;
+    edge.c = dy * xs[a] - dx * ys[a];
+    // top-left rule: pixels right on an edge only belong to the triangle if
+    // it's a top or a left edge, so the others need a strictly positive value
+    const auto topLeft{(dy == 0 && dx > 0) || dy < 0};
+    if (!topLeft)
+      edge.c -= 1;
+    for (int lane{}; lane < SimdLanes::width; ++lane)
+      triangle.edgeRamps[i][lane] = int32_t(edge.a * subpixels * lane);
+  }
+
+  // attributes are interpolated linearly over the snapped triangle
+  const auto x0{double(xs[order[0]]) / double(subpixels)},
+      y0{double(ys[order[0]]) / double(subpixels)};
+  const auto e1x{double(xs[order[1]] - xs[order[0]]) / double(subpixels)},
+      e1y{double(ys[order[1]] - ys[order[0]]) / double(subpixels)},
+      e2x{double(xs[order[2]] - xs[order[0]]) / double(subpixels)},
+      e2y{double(ys[order[2]] - ys[order[0]]) / double(subpixels)};
+  const auto determinant{e1x * e2y - e1y * e2x};
+  for (size_t i{}; i < attributeCount; ++i) {
+    double values[3];
+    for (size_t v{}; v < 3; ++v)
+      values[v] = i == 0 ? double(vertices[order[v]].z)
+                         : double(colors[order[v]] >> (8 * (i - 1)) & 0xFF);
+    const auto d1{values[1] - values[0]}, d2{values[2] - values[0]};
+    auto &plane{triangle.attributes[i]};
+    plane.dx = (d1 * e2y - d2 * e1y) / determinant;
+    plane.dy = (d2 * e1x - d1 * e2x) / determinant;
+    plane.base = values[0] + plane.dx * (0.5 - x0) + plane.dy * (0.5 - y0);
+    for (int lane{}; lane < SimdLanes::width; ++lane)
+      triangle.attributeRamps[i][lane] = float(plane.dx * lane);
+  }
+
+  // bounding box, in pixels whose centers may be covered, aligned to blocks
+  const auto pixelMin{[](long long v) {
+    return (v - subpixels / 2 + subpixels - 1) >> subpixelBits;
+  }};
+  const auto pixelMax{[](long long v) {
+    return ((v - subpixels / 2) >> subpixelBits) + 1;
+  }};
+  const auto minX{(std::max)(pixelMin((std::min)({xs[0], xs[1], xs[2]})),
+                             target.x0)},
+      maxX{(std::min)(pixelMax((std::max)({xs[0], xs[1], xs[2]})),
+                      target.x1)},
+      minY{(std::max)(pixelMin((std::min)({ys[0], ys[1], ys[2]})),
+                      target.y0)},
+      maxY{(std::min)(pixelMax((std::max)({ys[0], ys[1], ys[2]})),
+                      target.y1)};
+  if (minX >= maxX || minY >= maxY)
+    return;
+  const auto startX{minX - (minX - target.x0) % blockWidth},
+      startY{minY - (minY - target.y0) % blockHeight};
+
+  for (auto by{startY}; by < maxY; by += blockHeight) {
+    for (auto bx{startX}; bx < maxX; bx += blockWidth) {
+      // the edge functions are linear, so their extremes over a block are at
+      // its corners
+      const auto px{bx * subpixels + subpixels / 2},
+          py{by * subpixels + subpixels / 2};
+      bool rejected{}, testEdge[3];
+      for (size_t i{}; i < 3 && !rejected; ++i) {
+        const auto &edge{triangle.edges[i]};
+        const auto spanX{edge.a * subpixels * (blockWidth - 1)},
+            spanY{edge.b * subpixels * (blockHeight - 1)};
+        const auto corner{edge.at(px, py)};
+        const auto highest{corner + (std::max)(spanX, 0ll) +
+                           (std::max)(spanY, 0ll)},
+            lowest{corner + (std::min)(spanX, 0ll) + (std::min)(spanY, 0ll)};
+        rejected = highest < 0;
+        testEdge[i] = lowest < 0;
+      }
+      if (!rejected)
+        shadeBlock(triangle, target, bx, by, testEdge);
+    }
+  }
+}
+
+const char *rasterizerInstructionSet() { return instructionSet; }
+
+} // namespace vbag
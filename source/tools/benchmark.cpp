@@ -0,0 +1,403 @@
+// Renders parametric scenes offscreen for a fixed number of frames, moving
+// the camera and the objects the same way on every run, and prints how long
+// the frames took as JSON on the standard output.
+//
+// usage: vbag_bench [tiles|mesh|hierarchy|lights|all] [--size <count>]
+//                   [--frames <count>] [--warmup <count>]
+//                   [--width <pixels>] [--height <pixels>]
+//                   [--threads <count>] [--pipeline-depth <count>]
+//                   [--hidden-lines] [--image <path>]
+//
+// --size is the number of tiles, triangles, levels or lights of the scene,
+// and --image saves the last frame of every scene, with the name of the scene
+// put before the extension.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "animation/animation_engine.hpp"
+#include "graphics/light.hpp"
+#include "graphics/mesh_normals.hpp"
+#include "output/frame_capture.hpp"
+#include "output/software_screen.hpp"
+
+namespace {
+
+/// @brief The objects of a scene and how they move.
+struct Workload {
+  std::vector<std::unique_ptr<vbag::Object>> objects;
+  /// @brief Moves the objects into their places for a frame.
+  std::function<void(size_t frame)> animate;
+  /// @brief How many edges and triangles are submitted every frame.
+  size_t primitives{};
+};
+
+struct Options {
+  size_t frames{300}, warmup{30};
+  size_t width{640}, height{360};
+  size_t threads{}, pipelineDepth{1}, size{};
+  bool hiddenLines{};
+  std::string image;
+};
+
+struct Result {
+  std::string name;
+  size_t size, objects, primitives;
+  size_t threads; ///< How many threads processed the scene.
+  std::vector<double> times; ///< In milliseconds, one per frame.
+  vbag::RenderStats stats;
+};
+
+template <typename T> T &add(Workload &workload, std::unique_ptr<T> object) {
+  auto &added{*object};
+  workload.objects.push_back(std::move(object));
+  return added;
+}
+
+/// @brief Builds one of the graphs GV3F makes on the heap.
+std::unique_ptr<vbag::GV3F>
+makeGraph(vbag::GV3F (*make)(const std::string &, const vbag::RgbColor &),
+          const std::string &name) {
+  // built in place, since the transform of a copied object still points to
+  // the object it was copied from
+  return std::unique_ptr<vbag::GV3F>{
+      new vbag::GV3F{make(name, vbag::RgbColor::white())}};
+}
+
+/// @brief Builds a UV sphere with about the given number of triangles,
+/// computing its normals on a job system.
+std::unique_ptr<vbag::TriangleMesh> makeSphere(vbag::JobSystem &jobs,
+                                               const std::string &name,
+                                               size_t triangles,
+                                               float radius) {
+  using std::numbers::pi_v;
+  // a sphere of r rings and 2r segments has 4r(r - 1) triangles
+  const auto rings{(std::max)(
+      size_t(std::sqrt(double(triangles) / 4.0) + 0.5) + 1, size_t{3})};
+  const auto segments{2 * rings};
+  auto mesh{std::make_unique<vbag::TriangleMesh>(name)};
+  for (size_t ring{}; ring <= rings; ++ring) {
+    const auto theta{pi_v<float> * float(ring) / float(rings)};
+    for (size_t segment{}; segment < segments; ++segment) {
+      const auto phi{2 * pi_v<float> * float(segment) / float(segments)};
+      mesh->addVertex(radius * std::sin(theta) * std::cos(phi),
+                      radius * std::cos(theta),
+                      radius * std::sin(theta) * std::sin(phi));
+    }
+  }
+  const auto vertex{[&](size_t ring, size_t segment) {
+    return ring * segments + segment % segments;
+  }};
+  for (size_t ring{}; ring < rings; ++ring) {
+    for (size_t segment{}; segment < segments; ++segment) {
+      const auto a{vertex(ring, segment)}, b{vertex(ring, segment + 1)},
+          c{vertex(ring + 1, segment)}, d{vertex(ring + 1, segment + 1)};
+      if (ring != 0)
+        mesh->addTriangle(a, b, c);
+      if (ring != rings - 1)
+        mesh->addTriangle(b, d, c);
+    }
+  }
+  vbag::computeNormals(*mesh, jobs);
+  return mesh;
+}
+
+/// @brief A grid of spinning wireframe squares facing the camera.
+Workload makeTiles(size_t count) {
+  Workload workload;
+  std::vector<vbag::Object *> tiles;
+  const auto side{size_t(std::ceil(std::sqrt(double(count))))};
+  const auto spacing{4.0f / float(side)};
+  for (size_t i{}; i < count; ++i) {
+    auto &tile{add(workload,
+                   makeGraph(vbag::GV3F::square, "tile" + std::to_string(i)))};
+    tile.transform().scale(0.4f * spacing);
+    tile.transform().rotateInPlace(std::numbers::pi_v<float> / 2, 0, 0);
+    tile.transform().translate(
+        (float(i % side) + 0.5f) * spacing - 2.0f,
+        (float(i / side) + 0.5f) * spacing - 2.0f, 0);
+    tiles.push_back(&tile);
+  }
+  workload.animate = [tiles](size_t frame) {
+    // every other tile spins the other way
+    for (size_t i{}; i < tiles.size(); ++i)
+      tiles[i]->transform().rotateInPlace(
+          0, 0, (i + frame / 60) % 2 ? 0.02f : -0.02f);
+  };
+  workload.primitives = 4 * count;
+  return workload;
+}
+
+/// @brief A single spinning mesh.
+Workload makeMesh(vbag::JobSystem &jobs, size_t triangles) {
+  Workload workload;
+  auto &mesh{add(workload, makeSphere(jobs, "mesh", triangles, 1.5f))};
+  workload.animate = [&mesh](size_t) {
+    mesh.transform().rotateInPlace(0.01f, 0.02f, 0);
+  };
+  workload.primitives = mesh.triangles().size();
+  return workload;
+}
+
+/// @brief A chain of cubes, each the child of the one before, spiralling out
+/// of the root; rotating the root moves every level.
+Workload makeHierarchy(size_t levels) {
+  Workload workload;
+  vbag::Object *parent{};
+  for (size_t level{}; level < levels; ++level) {
+    auto &cube{add(workload, makeGraph(vbag::GV3F::cube,
+                                       "level" + std::to_string(level)))};
+    const auto angle{0.3f * float(level)};
+    const auto distance{2.5f * float(level) / float(levels)};
+    cube.transform().scale(0.08f);
+    cube.transform().translate(distance * std::cos(angle),
+                               distance * std::sin(angle), 0);
+    if (parent)
+      parent->addChild(&cube);
+    parent = &cube;
+  }
+  auto *root{workload.objects.front().get()};
+  workload.animate = [root](size_t) {
+    root->transform().rotateInPlace(0, 0.01f, 0.02f);
+  };
+  workload.primitives = 12 * levels;
+  return workload;
+}
+
+/// @brief A mesh with point lights circling around it.
+Workload makeLights(vbag::JobSystem &jobs, size_t count) {
+  Workload workload;
+  auto &mesh{add(workload, makeSphere(jobs, "mesh", 4096, 1.0f))};
+  std::vector<vbag::Object *> lights;
+  for (size_t i{}; i < count; ++i) {
+    auto &light{add(workload, std::make_unique<vbag::PointLight>(
+                                  "light" + std::to_string(i)))};
+    const auto angle{2 * std::numbers::pi_v<float> * float(i) /
+                     float(count)};
+    light.transform().translate(2 * std::cos(angle), 0, 2 * std::sin(angle));
+    lights.push_back(&light);
+  }
+  workload.animate = [&mesh, lights](size_t frame) {
+    mesh.transform().rotateInPlace(0, 0.01f, 0);
+    // the lights bob up and down, out of step with each other
+    for (size_t i{}; i < lights.size(); ++i) {
+      const auto phase{0.05f * float(frame) + float(i)};
+      lights[i]->transform().translate(
+          0, 0.5f * (std::sin(phase + 0.05f) - std::sin(phase)), 0);
+    }
+  };
+  workload.primitives = mesh.triangles().size();
+  return workload;
+}
+
+Result runScene(const std::string &name, const Options &options) {
+  Workload workload;
+  size_t size;
+  {
+    // the meshes are built on a pool of their own, gone before the engine
+    // starts its own
+    vbag::JobSystem jobs;
+    if (name == "tiles")
+      workload = makeTiles(size = options.size ? options.size : 1024);
+    else if (name == "mesh")
+      workload = makeMesh(jobs, size = options.size ? options.size : 65536);
+    else if (name == "hierarchy")
+      workload = makeHierarchy(size = options.size ? options.size : 256);
+    else
+      workload = makeLights(jobs, size = options.size ? options.size : 64);
+  }
+
+  // pipelined frames are recorded while the one before is rasterized, so the
+  // engine and the screen split the threads between them
+  const auto threads{options.threads
+                         ? options.threads
+                         : size_t{(std::max)(
+                               1u, std::thread::hardware_concurrency())}};
+  const auto pipelined{options.pipelineDepth > 1};
+  const auto screenThreads{pipelined ? (std::max)(threads / 2, size_t{1})
+                                     : threads};
+  const auto engineThreads{
+      pipelined ? (std::max)(threads - screenThreads, size_t{1}) : threads};
+  vbag::SoftwareScreen screen{options.width, options.height, screenThreads};
+  vbag::Camera camera{"camera", 90,
+                      float(screen.height()) / float(screen.width())};
+  vbag::Scene scene;
+  scene.addObject(&camera);
+  // children come along with their parents
+  for (const auto &object : workload.objects)
+    if (!object->parent())
+      scene.addObject(object.get());
+  scene.setMainCamera("camera");
+
+  // the motion only depends on the frame number, never on the clock, so
+  // every run renders the same frames
+  using Clock = std::chrono::steady_clock;
+  std::vector<Clock::time_point> starts;
+  starts.reserve(options.warmup + options.frames + 1);
+  size_t frame{};
+  vbag::Engine engine{
+      screen,
+      [&](vbag::Engine *) { camera.transform().translate(0, 0, 4); },
+      [&](vbag::Engine *) {
+        starts.push_back(Clock::now());
+        // dollies in and out
+        const auto dolly{[](size_t frame) {
+          return std::sin(0.02f * float(frame));
+        }};
+        camera.transform().translate(0, 0, dolly(frame + 1) - dolly(frame));
+        workload.animate(frame);
+        ++frame;
+      },
+      scene, 0, engineThreads};
+  engine.setPipelineDepth(options.pipelineDepth);
+  engine.setHiddenLineRemoval(options.hiddenLines);
+  engine.runFrames(options.warmup + options.frames);
+  starts.push_back(Clock::now());
+
+  Result result{name,
+                size,
+                workload.objects.size(),
+                workload.primitives,
+                threads,
+                {},
+                engine.stats()};
+  for (auto i{options.warmup}; i + 1 < starts.size(); ++i)
+    result.times.push_back(
+        std::chrono::duration<double, std::milli>{starts[i + 1] - starts[i]}
+            .count());
+
+  if (!options.image.empty()) {
+    auto path{options.image};
+    const auto dot{path.find_last_of('.')};
+    path.insert(dot == std::string::npos ? path.size() : dot, "_" + name);
+    vbag::saveImage(path, screen.pixels(), screen.width(), screen.height());
+  }
+  return result;
+}
+
+void printUsage() {
+  std::fprintf(stderr,
+               "usage: vbag_bench [tiles|mesh|hierarchy|lights|all] "
+               "[--size <count>] [--frames <count>] [--warmup <count>] "
+               "[--width <pixels>] [--height <pixels>] [--threads <count>] "
+               "[--pipeline-depth <count>] [--hidden-lines] "
+               "[--image <path>]\n");
+}
+
+void printResult(const Result &result, bool last) {
+  auto times{result.times};
+  double total{};
+  for (const auto time : times)
+    total += time;
+  std::sort(times.begin(), times.end());
+  const auto percentile{[&](double p) {
+    return times[size_t(p * double(times.size() - 1) + 0.5)];
+  }};
+  const auto framesPerSecond{1e3 * double(times.size()) / total};
+  // averaged over the last few frames
+  const auto &recent{result.stats.recent};
+  const auto perFrame{[&](size_t count) {
+    return double(count) / double(result.stats.recentFrames);
+  }};
+  const auto objects{[](const vbag::FrameStats &stats, auto member) {
+    return stats.graphs.*member + stats.triangleMeshes.*member +
+           stats.quadMeshes.*member;
+  }};
+  std::printf("    {\"name\": \"%s\", \"size\": %zu, \"objects\": %zu, "
+              "\"primitives\": %zu, \"threads\": %zu, \"frames\": %zu,\n"
+              "     \"meanMs\": %.4f, \"p50Ms\": %.4f, \"p99Ms\": %.4f, "
+              "\"maxMs\": %.4f,\n"
+              "     \"framesPerSecond\": %.2f, \"primitivesPerSecond\": %.0f,\n"
+              "     \"perFrame\": {\"objectsDrawn\": %.1f, "
+              "\"objectsCulled\": %.1f, \"verticesTransformed\": %.0f, "
+              "\"trianglesSubmitted\": %.0f, \"linesSubmitted\": %.0f, "
+              "\"backendCalls\": %.1f, \"bytesUploaded\": %.0f}}%s\n",
+              result.name.c_str(), result.size, result.objects,
+              result.primitives, result.threads, times.size(),
+              total / double(times.size()), percentile(0.5),
+              percentile(0.99), times.back(), framesPerSecond,
+              framesPerSecond * double(result.primitives),
+              perFrame(objects(recent, &vbag::ObjectStats::drawn)),
+              perFrame(objects(recent, &vbag::ObjectStats::culled)),
+              perFrame(recent.verticesTransformed),
+              perFrame(recent.trianglesSubmitted),
+              perFrame(recent.linesSubmitted), perFrame(recent.backendCalls),
+              perFrame(recent.bytesUploaded), last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string> allScenes{"tiles", "mesh", "hierarchy",
+                                           "lights"};
+  std::vector<std::string> scenes{allScenes};
+  Options options;
+  for (int i{1}; i < argc; ++i) {
+    const auto number{[&] {
+      return i + 1 < argc ? std::strtoull(argv[++i], nullptr, 10) : 0ull;
+    }};
+    if (!std::strcmp(argv[i], "--size"))
+      options.size = number();
+    else if (!std::strcmp(argv[i], "--frames"))
+      options.frames = number();
+    else if (!std::strcmp(argv[i], "--warmup"))
+      options.warmup = number();
+    else if (!std::strcmp(argv[i], "--width"))
+      options.width = number();
+    else if (!std::strcmp(argv[i], "--height"))
+      options.height = number();
+    else if (!std::strcmp(argv[i], "--threads"))
+      options.threads = number();
+    else if (!std::strcmp(argv[i], "--pipeline-depth"))
+      options.pipelineDepth = number();
+    else if (!std::strcmp(argv[i], "--hidden-lines"))
+      options.hiddenLines = true;
+    else if (!std::strcmp(argv[i], "--image") && i + 1 < argc)
+      options.image = argv[++i];
+    else if (std::find(allScenes.begin(), allScenes.end(), argv[i]) !=
+             allScenes.end())
+      scenes = {argv[i]};
+    else if (std::strcmp(argv[i], "all") != 0) {
+      std::fprintf(stderr, "vbag_bench: unknown argument '%s'\n", argv[i]);
+      printUsage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (!options.frames || !options.width || !options.height) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Result> results;
+  try {
+    for (const auto &scene : scenes) {
+      std::fprintf(stderr, "vbag_bench: %s\n", scene.c_str());
+      results.push_back(runScene(scene, options));
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "vbag_bench: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  std::printf("{\n  \"width\": %zu, \"height\": %zu, \"pipelineDepth\": %zu, "
+              "\"hiddenLines\": %s, \"warmupFrames\": %zu,\n"
+              "  \"scenes\": [\n",
+              options.width, options.height, options.pipelineDepth,
+              options.hiddenLines ? "true" : "false",
+              options.warmup);
+  for (size_t i{}; i < results.size(); ++i)
+    printResult(results[i], i + 1 == results.size());
+  std::printf("  ]\n}\n");
+  return EXIT_SUCCESS;
+}
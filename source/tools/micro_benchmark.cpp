@@ -0,0 +1,444 @@
+// Times the building blocks of the engine (matrices, transforms, graphs,
+// meshes, colors, strings, behaviors and the frame loop itself) in isolation,
+// and compares the results with a baseline saved by an earlier run, flagging
+// the ones that got slower.
+//
+// usage: vbag_microbench [--filter <text>] [--samples <count>]
+//                        [--min-sample-ms <ms>] [--warmup-ms <ms>]
+//                        [--baseline <path>] [--save-baseline <path>]
+//                        [--tolerance <percent>]
+//
+// Every benchmark is warmed up, then timed over a number of samples, each
+// running it as many times as it takes to last at least --min-sample-ms. The
+// median time of a sample is what's compared with the baseline: it regressed
+// if it's more than --tolerance percent slower, which makes the exit status
+// 1. The baseline is a text file with a name and a time in nanoseconds on
+// every line.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "animation/animation_engine.hpp"
+#include "animation/behavior.hpp"
+#include "geometry/graph.hpp"
+#include "graphics/color.hpp"
+#include "graphics/quad_mesh.hpp"
+#include "math/matrix.hpp"
+#include "output/software_screen.hpp"
+#include "util/error_handling.hpp"
+#include "util/string.hpp"
+
+namespace {
+
+/// @brief Keeps the compiler from optimizing away a value, or the work that
+/// went into it.
+template <typename T> void keep(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static const void *volatile sink;
+  sink = &value;
+#endif
+}
+
+/// @brief A benchmark: makes its fixture and returns the operation timed,
+/// which can run any number of times.
+struct Benchmark {
+  const char *name;
+  std::function<std::function<void()>()> make;
+};
+
+struct Options {
+  std::string filter, baseline, saveBaseline;
+  size_t samples{15};
+  double minSampleMs{2}, warmupMs{20}, tolerance{10};
+};
+
+struct Statistics {
+  double median, mean, min, deviation; ///< In nanoseconds per operation.
+};
+
+vbag::M4F rotation(float angle) {
+  const auto c{std::cos(angle)}, s{std::sin(angle)};
+  return {
+      c,  0, s, 0, //
+      0,  1, 0, 0, //
+      -s, 0, c, 0, //
+      0,  0, 0, 1,
+  };
+}
+
+/// @brief A chain of objects, each the child of the one before.
+struct Hierarchy {
+  explicit Hierarchy(size_t levels) {
+    for (size_t level{}; level < levels; ++level) {
+      objects.push_back(
+          std::make_unique<vbag::Object>("level" + std::to_string(level)));
+      if (level)
+        objects[level - 1]->addChild(objects[level].get());
+    }
+  }
+
+  std::vector<std::unique_ptr<vbag::Object>> objects;
+};
+
+/// @brief A graph of a ring of vertices, each also joined to the vertex
+/// halfway around.
+void buildGraph(vbag::GV3F &graph, size_t vertices) {
+  for (size_t i{}; i < vertices; ++i)
+    graph.addVertex(float(i), 0, 0);
+  for (size_t i{}; i < vertices; ++i) {
+    graph.addEdge(i, (i + 1) % vertices);
+    if (i < vertices / 2)
+      graph.addEdge(i, i + vertices / 2);
+  }
+}
+
+/// @brief An engine drawing nothing but a camera to a tiny screen, so a frame
+/// costs little besides the frame loop itself.
+template <typename Engine> struct EngineFixture {
+  template <typename Setup, typename Loop>
+  EngineFixture(Setup setup, Loop loop)
+      : engine{screen, std::move(setup), std::move(loop), scene(), 0, 1} {}
+
+  vbag::Scene scene() {
+    vbag::Scene scene;
+    scene.addObject(&camera);
+    scene.setMainCamera("camera");
+    return scene;
+  }
+
+  vbag::SoftwareScreen screen{16, 16, 1};
+  vbag::Camera camera{"camera", 90, 1};
+  Engine engine;
+};
+
+/// @brief Renders frames of an engine whose loop function does next to
+/// nothing, kept in std::functions or inlined into the frame loop.
+template <bool inlined> std::function<void()> engineFrame() {
+  auto setup{[](vbag::EngineCore *) {}};
+  auto loop{[frame = size_t{}](vbag::EngineCore *) mutable { keep(++frame); }};
+  using Engine =
+      std::conditional_t<inlined,
+                         vbag::BasicEngine<decltype(setup), decltype(loop)>,
+                         vbag::Engine>;
+  auto fixture{std::make_shared<EngineFixture<Engine>>(setup, loop)};
+  return [=] { fixture->engine.runFrames(1); };
+}
+
+/// @brief A behavior that mostly sleeps, waking up now and then to do a
+/// little work.
+vbag::Behavior idle(double period, size_t *work) {
+  while (true) {
+    co_await vbag::seconds(period);
+    ++*work;
+  }
+}
+
+/// @brief A behavior that finishes in the next frame.
+vbag::Behavior shortLived() { co_await vbag::nextFrame(); }
+
+/// @brief The time between two frames at 60 frames per second.
+const vbag::BehaviorScheduler::Duration frameLength{
+    std::chrono::duration_cast<vbag::BehaviorScheduler::Duration>(
+        std::chrono::duration<double>{1.0 / 60})};
+
+std::vector<Benchmark> benchmarks() {
+  return {
+      {"matrix_multiply",
+       [] {
+         auto product{std::make_shared<vbag::M4F>(rotation(0))};
+         const auto step{rotation(0.01f)};
+         return [=] {
+           *product = *product * step;
+           keep(*product);
+         };
+       }},
+      {"matrix_vector_multiply",
+       [] {
+         const auto matrix{rotation(0.5f)};
+         auto vector{std::make_shared<vbag::Matrix<float, 4, 1>>(
+             vbag::Matrix<float, 4, 1>{1, 2, 3, 1})};
+         return [=] {
+           *vector = matrix * *vector;
+           keep(*vector);
+         };
+       }},
+      {"transform_rotate_64_levels",
+       [] {
+         auto hierarchy{std::make_shared<Hierarchy>(64)};
+         return [=] {
+           hierarchy->objects.front()->transform().rotate(0, 0.01f, 0);
+           keep(hierarchy->objects.back()->transform());
+         };
+       }},
+      {"transform_translate_64_levels",
+       [] {
+         auto hierarchy{std::make_shared<Hierarchy>(64)};
+         auto sign{std::make_shared<float>(1)};
+         return [=] {
+           // back and forth, so the positions stay put
+           hierarchy->objects.front()->transform().translate(*sign, 0, 0);
+           *sign = -*sign;
+           keep(hierarchy->objects.back()->transform());
+         };
+       }},
+      {"graph_add_edges_1k",
+       [] {
+         return [] {
+           vbag::GV3F graph{"graph"};
+           buildGraph(graph, 1024);
+           keep(graph);
+         };
+       }},
+      {"graph_iterate_edges_1k",
+       [] {
+         auto graph{std::make_shared<vbag::GV3F>("graph")};
+         buildGraph(*graph, 1024);
+         return [=] {
+           size_t sum{};
+           for (size_t vertex{}; vertex < graph->order(); ++vertex)
+             for (const auto neighbour : graph->edges(vertex))
+               sum += neighbour;
+           keep(sum);
+         };
+       }},
+      {"quad_mesh_as_triangle_mesh_4k",
+       [] {
+         auto mesh{std::make_shared<vbag::QuadMesh>("grid")};
+         constexpr size_t side{64};
+         for (size_t y{}; y <= side; ++y)
+           for (size_t x{}; x <= side; ++x) {
+             mesh->addVertex(float(x), float(y), 0);
+             mesh->addNormal(0, 0, 1);
+           }
+         for (size_t y{}; y < side; ++y)
+           for (size_t x{}; x < side; ++x) {
+             const auto corner{y * (side + 1) + x};
+             mesh->addQuad(corner, corner + 1, corner + side + 2,
+                           corner + side + 1);
+           }
+         return [=] {
+           const auto triangles{mesh->asTriangleMesh()};
+           keep(triangles);
+         };
+       }},
+      {"color_to_d3dcolor_1k",
+       [] {
+         auto colors{std::make_shared<std::vector<vbag::RgbColor>>()};
+         for (size_t i{}; i < 1024; ++i)
+           colors->push_back({float(i % 7) / 5.0f - 0.1f,
+                              float(i % 11) / 10.0f, float(i % 13) / 12.0f});
+         auto converted{std::make_shared<std::vector<D3DCOLOR>>(1024)};
+         return [=] {
+           for (size_t i{}; i < colors->size(); ++i)
+             (*converted)[i] = (*colors)[i];
+           keep(*converted);
+         };
+       }},
+      {"string_copy_short",
+       [] {
+         const vbag::String string{"short string"};
+         return [=] {
+           const vbag::String copy{string};
+           keep(copy);
+         };
+       }},
+      {"string_copy_long",
+       [] {
+         const vbag::String string{
+             "a string long enough to live on the heap instead of inline"};
+         return [=] {
+           const vbag::String copy{string};
+           keep(copy);
+         };
+       }},
+      {"behaviors_10k_idle_frame",
+       [] {
+         auto scheduler{std::make_shared<vbag::BehaviorScheduler>()};
+         auto work{std::make_shared<size_t>()};
+         // waking up every 1 to 10 seconds, so about 1 in 300 are due in a
+         // frame
+         for (size_t i{}; i < 10000; ++i)
+           scheduler->spawn(idle(1.0 + double(i % 91) / 10.0, work.get()));
+         return [=] {
+           scheduler->update(frameLength);
+           keep(*work);
+         };
+       }},
+      {"behavior_spawn_and_finish",
+       [] {
+         auto scheduler{std::make_shared<vbag::BehaviorScheduler>()};
+         return [=] {
+           scheduler->spawn(shortLived());
+           scheduler->update(frameLength);
+         };
+       }},
+      {"engine_frame_std_function", engineFrame<false>},
+      {"engine_frame_inlined", engineFrame<true>},
+  };
+}
+
+/// @brief Runs an operation a number of times and returns how long that
+/// took, in nanoseconds.
+double time(const std::function<void()> &operation, size_t iterations) {
+  const auto start{std::chrono::steady_clock::now()};
+  for (size_t i{}; i < iterations; ++i)
+    operation();
+  return std::chrono::duration<double, std::nano>{
+      std::chrono::steady_clock::now() - start}.count();
+}
+
+Statistics measure(const std::function<void()> &operation,
+                   const Options &options) {
+  // warms up caches, branch predictors and the clock speed, and finds out
+  // how many iterations make a sample long enough to time reliably
+  size_t iterations{1};
+  double elapsed{}, warmup{};
+  while (warmup < options.warmupMs * 1e6 ||
+         elapsed < options.minSampleMs * 1e6) {
+    elapsed = time(operation, iterations);
+    warmup += elapsed;
+    if (elapsed < options.minSampleMs * 1e6)
+      iterations *= 2;
+  }
+
+  std::vector<double> samples;
+  for (size_t sample{}; sample < options.samples; ++sample)
+    samples.push_back(time(operation, iterations) / double(iterations));
+  std::sort(samples.begin(), samples.end());
+  double mean{};
+  for (const auto sample : samples)
+    mean += sample;
+  mean /= double(samples.size());
+  double variance{};
+  for (const auto sample : samples)
+    variance += (sample - mean) * (sample - mean);
+  variance /= double(samples.size());
+  const auto middle{samples.size() / 2};
+  const auto median{samples.size() % 2
+                        ? samples[middle]
+                        : (samples[middle - 1] + samples[middle]) / 2};
+  return {median, mean, samples.front(), std::sqrt(variance)};
+}
+
+/// @brief Reads a baseline, mapping the name of every benchmark to its
+/// median time.
+///
+/// @throw RuntimeError<CouldNotOpenFile> If the file can't be read.
+std::map<std::string, double> loadBaseline(const std::string &path) {
+  std::map<std::string, double> baseline;
+  auto *file{std::fopen(path.c_str(), "r")};
+  if (!file)
+    throw vbag::RuntimeError<vbag::CouldNotOpenFile>{};
+  char name[256];
+  double median;
+  while (std::fscanf(file, "%255s %lf", name, &median) == 2)
+    baseline[name] = median;
+  std::fclose(file);
+  return baseline;
+}
+
+void printUsage() {
+  std::fprintf(stderr,
+               "usage: vbag_microbench [--filter <text>] [--samples <count>] "
+               "[--min-sample-ms <ms>] [--warmup-ms <ms>] "
+               "[--baseline <path>] [--save-baseline <path>] "
+               "[--tolerance <percent>]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i{1}; i < argc; ++i) {
+    const auto hasValue{i + 1 < argc};
+    if (!std::strcmp(argv[i], "--filter") && hasValue)
+      options.filter = argv[++i];
+    else if (!std::strcmp(argv[i], "--samples") && hasValue)
+      options.samples = (std::max)(std::strtoull(argv[++i], nullptr, 10), 1ull);
+    else if (!std::strcmp(argv[i], "--min-sample-ms") && hasValue)
+      options.minSampleMs = std::strtod(argv[++i], nullptr);
+    else if (!std::strcmp(argv[i], "--warmup-ms") && hasValue)
+      options.warmupMs = std::strtod(argv[++i], nullptr);
+    else if (!std::strcmp(argv[i], "--baseline") && hasValue)
+      options.baseline = argv[++i];
+    else if (!std::strcmp(argv[i], "--save-baseline") && hasValue)
+      options.saveBaseline = argv[++i];
+    else if (!std::strcmp(argv[i], "--tolerance") && hasValue)
+      options.tolerance = std::strtod(argv[++i], nullptr);
+    else {
+      printUsage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<std::pair<std::string, double>> medians;
+  size_t regressions{};
+  try {
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty())
+      baseline = loadBaseline(options.baseline);
+
+    std::printf("%-32s %12s %12s %12s %8s  %s\n", "benchmark", "median ns",
+                "mean ns", "min ns", "stddev", "baseline");
+    for (const auto &benchmark : benchmarks()) {
+      if (!std::strstr(benchmark.name, options.filter.c_str()))
+        continue;
+      const auto statistics{measure(benchmark.make(), options)};
+      medians.emplace_back(benchmark.name, statistics.median);
+
+      std::string comparison{"-"};
+      if (const auto found{baseline.find(benchmark.name)};
+          found != baseline.end()) {
+        const auto change{100 * (statistics.median / found->second - 1)};
+        char text[64];
+        std::snprintf(text, sizeof text, "%+.1f%%%s", change,
+                      change > options.tolerance    ? " REGRESSION"
+                      : change < -options.tolerance ? " faster"
+                                                    : "");
+        comparison = text;
+        regressions += change > options.tolerance;
+      }
+      std::printf("%-32s %12.2f %12.2f %12.2f %7.1f%%  %s\n", benchmark.name,
+                  statistics.median, statistics.mean, statistics.min,
+                  100 * statistics.deviation / statistics.mean,
+                  comparison.c_str());
+      std::fflush(stdout);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "vbag_microbench: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  if (!options.saveBaseline.empty()) {
+    auto *file{std::fopen(options.saveBaseline.c_str(), "w")};
+    if (!file) {
+      std::fprintf(stderr, "vbag_microbench: could not write '%s'\n",
+                   options.saveBaseline.c_str());
+      return EXIT_FAILURE;
+    }
+    for (const auto &[name, median] : medians)
+      std::fprintf(file, "%s %.4f\n", name.c_str(), median);
+    std::fclose(file);
+  }
+  if (regressions) {
+    std::fprintf(stderr,
+                 "vbag_microbench: %zu benchmark(s) more than %.1f%% slower "
+                 "than the baseline\n",
+                 regressions, options.tolerance);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
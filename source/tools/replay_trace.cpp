@@ -0,0 +1,141 @@
+// Replays a trace recorded by a TracingScreen into a screen as fast as it can
+// and times every frame: the frame times go to the standard output as CSV,
+// and a summary to the standard error. The null screen only reads the trace.
+//
+// usage: vbag_replay <trace> [software|terminal|null|d3d9] [--threads <count>]
+//                    [--repeat <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "output/software_screen.hpp"
+#include "output/terminal_screen.hpp"
+#include "output/tracing_screen.hpp"
+
+#if defined(_WIN32)
+#include "output/d3d9_screen.hpp"
+#endif
+
+namespace {
+
+/// @brief A screen that throws everything away, for measuring how long
+/// reading the trace itself takes.
+class NullScreen : public vbag::Screen {
+public:
+  NullScreen(size_t width, size_t height) : width_{width}, height_{height} {}
+
+  void clear() override {}
+  [[nodiscard]] size_t width() const override { return width_; }
+  [[nodiscard]] size_t height() const override { return height_; }
+  void drawLine(const vbag::Line &) override {}
+  void drawLines(const vbag::Line *, size_t) override {}
+  void drawTriangle(vbag::V3F, vbag::V3F, vbag::V3F, D3DCOLOR, D3DCOLOR,
+                    D3DCOLOR) override {}
+  void drawPoint(vbag::V3F) override {}
+  void drawTriangles(std::span<const vbag::V3F>,
+                     std::span<const D3DCOLOR>) override {}
+  void drawIndexedTriangles(std::span<const vbag::V3F>,
+                            std::span<const D3DCOLOR>,
+                            std::span<const uint32_t>) override {}
+  void drawPoints(std::span<const vbag::V3F>) override {}
+  void present() override {}
+
+private:
+  size_t width_, height_;
+};
+
+void printUsage() {
+  std::fprintf(stderr,
+               "usage: vbag_replay <trace> [software|terminal|null|d3d9] "
+               "[--threads <count>] [--repeat <count>]\n");
+}
+
+std::unique_ptr<vbag::Screen> makeScreen(const std::string &backend,
+                                         size_t width, size_t height,
+                                         size_t threads) {
+  if (backend == "software")
+    return std::make_unique<vbag::SoftwareScreen>(width, height, threads);
+  if (backend == "terminal")
+    return std::make_unique<vbag::TerminalScreen>(
+        width / vbag::TerminalScreen::cellWidth,
+        height / vbag::TerminalScreen::cellHeight,
+        vbag::TerminalGlyphs::HalfBlocks, 1, threads);
+  if (backend == "null")
+    return std::make_unique<NullScreen>(width, height);
+#if defined(_WIN32)
+  if (backend == "d3d9")
+    return std::make_unique<vbag::D3d9Screen>(GetModuleHandle(nullptr),
+                                              "vbag_replay", width, height);
+#endif
+  return nullptr;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  std::string backend{"software"};
+  size_t threads{}, repeat{1};
+  for (int i{2}; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+      threads = std::strtoull(argv[++i], nullptr, 10);
+    else if (!std::strcmp(argv[i], "--repeat") && i + 1 < argc)
+      repeat = (std::max)(std::strtoull(argv[++i], nullptr, 10), 1ull);
+    else
+      backend = argv[i];
+  }
+
+  std::vector<double> times;
+  try {
+    vbag::TraceReplayer trace{argv[1]};
+    auto screen{makeScreen(backend, trace.width(), trace.height(), threads)};
+    if (!screen) {
+      std::fprintf(stderr, "vbag_replay: unknown screen '%s'\n",
+                   backend.c_str());
+      printUsage();
+      return EXIT_FAILURE;
+    }
+    std::printf("frame,milliseconds\n");
+    for (size_t pass{}; pass < repeat; ++pass) {
+      for (size_t frame{}; frame < trace.frameCount(); ++frame) {
+        const auto start{std::chrono::steady_clock::now()};
+        trace.replay(frame, *screen);
+        times.push_back(std::chrono::duration<double, std::milli>{
+            std::chrono::steady_clock::now() - start}.count());
+        std::printf("%zu,%.4f\n", frame, times.back());
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "vbag_replay: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  if (times.empty()) {
+    std::fprintf(stderr, "vbag_replay: the trace has no frames\n");
+    return EXIT_FAILURE;
+  }
+
+  double total{};
+  for (const auto time : times)
+    total += time;
+  std::sort(times.begin(), times.end());
+  const auto percentile{[&](double p) {
+    return times[size_t(p * double(times.size() - 1) + 0.5)];
+  }};
+  std::fprintf(stderr,
+               "%s: %zu frames, mean %.3f ms, min %.3f ms, median %.3f ms, "
+               "p99 %.3f ms, max %.3f ms, %.1f fps\n",
+               backend.c_str(), times.size(), total / double(times.size()),
+               times.front(), percentile(0.5), percentile(0.99), times.back(),
+               1e3 * double(times.size()) / total);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+// Offline level-of-detail generation: loads a mesh, simplifies it and saves
+// the result as an OBJ file.
+//
+// usage: vbag_simplify <input.obj|ply> <output.obj> <ratio|triangles>
+//                      [max error] [--free-boundary]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+
+#include "graphics/mesh_io.hpp"
+#include "graphics/mesh_simplifier.hpp"
+
+namespace {
+
+void printUsage() {
+  std::fprintf(stderr,
+               "usage: vbag_simplify <input.obj|ply> <output.obj> "
+               "<ratio|triangles> [max error] [--free-boundary]\n"
+               "  ratio       a fraction of the triangles to keep, like 0.25\n"
+               "  triangles   the number of triangles to keep, like 10000\n"
+               "  max error   how far vertices may move from the original\n"
+               "              surface\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  auto maxError{std::numeric_limits<float>::infinity()};
+  auto preserveBoundary{true};
+  for (int i{4}; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--free-boundary"))
+      preserveBoundary = false;
+    else
+      maxError = std::strtof(argv[i], nullptr);
+  }
+
+  try {
+    vbag::TriangleMesh mesh{"mesh"};
+    const auto start{std::chrono::steady_clock::now()};
+    vbag::loadMesh(argv[1], mesh);
+    const auto loaded{std::chrono::steady_clock::now()};
+
+    const auto original{mesh.triangles().size()};
+    const auto amount{std::strtod(argv[3], nullptr)};
+    const auto target{amount <= 1 ? size_t(amount * double(original))
+                                  : size_t(amount)};
+    const auto result{
+        vbag::simplifyMesh(mesh, target, maxError, preserveBoundary)};
+    const auto simplified{std::chrono::steady_clock::now()};
+    vbag::saveMesh(argv[2], mesh);
+
+    using Ms = std::chrono::duration<double, std::milli>;
+    std::printf("%zu -> %zu triangles, error %g\n"
+                "load %.1f ms, simplify %.1f ms\n",
+                original, result.faceCount, double(result.error),
+                Ms{loaded - start}.count(), Ms{simplified - loaded}.count());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "vbag_simplify: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+// Spins a mesh (or a cube, without one) in the terminal.
+//
+// usage: vbag_terminal [mesh.obj|ply] [--braille] [--frames <count>]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include "animation/animation_engine.hpp"
+#include "graphics/mesh_io.hpp"
+#include "output/terminal_screen.hpp"
+
+namespace {
+
+/// @brief Returns the size of the terminal in cells, leaving the last row
+/// free for the cursor.
+void terminalSize(size_t &columns, size_t &rows) {
+  columns = 80, rows = 24;
+#if !defined(_WIN32)
+  winsize size{};
+  if (!ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) && size.ws_col && size.ws_row)
+    columns = size.ws_col, rows = size.ws_row;
+#endif
+  rows = rows > 1 ? rows - 1 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string meshPath;
+  auto glyphs{vbag::TerminalGlyphs::HalfBlocks};
+  size_t frames{};
+  for (int i{1}; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--braille"))
+      glyphs = vbag::TerminalGlyphs::Braille;
+    else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+      frames = std::strtoull(argv[++i], nullptr, 10);
+    else
+      meshPath = argv[i];
+  }
+
+  size_t bytes{};
+  double seconds{};
+  try {
+    size_t columns, rows;
+    terminalSize(columns, rows);
+    vbag::TerminalScreen screen{columns, rows, glyphs};
+
+    vbag::Camera camera{"camera", 90,
+                        float(screen.height()) / float(screen.width())};
+    vbag::TriangleMesh mesh{"mesh"};
+    auto cube{vbag::GV3F::cube("cube")};
+    vbag::Scene scene;
+    scene.addObject(&camera);
+    if (meshPath.empty())
+      scene.addObject(&cube);
+    else {
+      vbag::loadMesh(meshPath, mesh);
+      scene.addObject(&mesh);
+    }
+    scene.setMainCamera("camera");
+
+    vbag::Engine engine{
+        screen,
+        [&](vbag::Engine *) { camera.transform().translate(0, 0, 4); },
+        [&](vbag::Engine *) {
+          bytes += screen.lastFrameBytes();
+          mesh.transform().rotateInPlace(0.03f, 0.01f, 0);
+          cube.transform().rotateInPlace(0.03f, 0.01f, 0);
+        },
+        scene};
+    if (!frames)
+      engine.run();
+
+    const auto start{std::chrono::steady_clock::now()};
+    engine.runFrames(frames);
+    seconds = std::chrono::duration<double>{
+        std::chrono::steady_clock::now() - start}.count();
+    bytes += screen.lastFrameBytes();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "vbag_terminal: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  // the screen is gone by now, so the terminal is back to normal
+  std::fprintf(stderr, "%zu frames, %.1f fps, %.1f kB per frame\n", frames,
+               double(frames) / seconds,
+               double(bytes) / double(frames) / 1e3);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "util/frame_arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace vbag {
+
+namespace {
+
+#if defined(VBAG_COUNT_ALLOCATIONS)
+std::atomic<size_t> allocations{};
+#endif
+
+} // namespace
+
+FrameArena::FrameArena(size_t threads, size_t blockSize)
+    : blockSize_{(std::max)(blockSize, size_t{64})},
+      subArenas_((std::max)(threads, size_t{1})),
+      shared_{std::make_unique<std::byte[]>(blockSize_ * subArenas_.size())},
+      sharedSize_{blockSize_ * subArenas_.size()} {}
+
+void FrameArena::reset() {
+  // chunks go to whichever thread runs out of room, so the shared block only
+  // needs room for the whole frame once, however its work is spread over the
+  // threads; if the frame didn't fit, the next one gets twice what it wanted
+  const auto wanted{sharedUsed_.load(std::memory_order_relaxed)};
+  if (wanted > sharedSize_) {
+    shared_.reset();
+    sharedSize_ = wanted * 2;
+    shared_ = std::make_unique<std::byte[]>(sharedSize_);
+  }
+  sharedUsed_.store(0, std::memory_order_relaxed);
+  for (auto &subArena : subArenas_) {
+    subArena.chunk = nullptr;
+    subArena.chunkSize = 0;
+    subArena.offset = 0;
+    subArena.used = 0;
+    subArena.overflow.clear();
+  }
+}
+
+void *FrameArena::allocate(size_t thread, size_t size, size_t alignment) {
+  auto &subArena{subArenas_[thread]};
+  const auto fits{[&](size_t &offset) {
+    const auto address{reinterpret_cast<uintptr_t>(subArena.chunk)};
+    offset = ((address + subArena.offset + alignment - 1) & ~(alignment - 1)) -
+             address;
+    return offset + size <= subArena.chunkSize;
+  }};
+  size_t offset;
+  if (!subArena.chunk || !fits(offset)) {
+    subArena.used += subArena.offset;
+    subArena.offset = 0;
+    subArena.chunkSize = (std::max)(blockSize_, size + alignment);
+    const auto start{sharedUsed_.fetch_add(subArena.chunkSize,
+                                           std::memory_order_relaxed)};
+    if (start + subArena.chunkSize <= sharedSize_) {
+      subArena.chunk = shared_.get() + start;
+    } else {
+      subArena.overflow.push_back(
+          std::make_unique<std::byte[]>(subArena.chunkSize));
+      subArena.chunk = subArena.overflow.back().get();
+    }
+    fits(offset);
+  }
+  subArena.offset = offset + size;
+  return subArena.chunk + offset;
+}
+
+size_t FrameArena::threadCount() const { return subArenas_.size(); }
+
+size_t FrameArena::bytesUsed() const {
+  size_t bytes{};
+  for (const auto &subArena : subArenas_)
+    bytes += subArena.used + subArena.offset;
+  return bytes;
+}
+
+size_t allocationCount() {
+#if defined(VBAG_COUNT_ALLOCATIONS)
+  return allocations.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+} // namespace vbag
+
+#if defined(VBAG_COUNT_ALLOCATIONS)
+// replacing these counts every allocation of the program, the standard
+// library's included; the array and nothrow forms end up here too
+void *operator new(size_t size) {
+  vbag::allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto *memory{std::malloc(size ? size : 1)})
+    return memory;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+#endif
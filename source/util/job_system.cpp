@@ -0,0 +1,266 @@
+#include "util/job_system.hpp"
+
+#include <utility>
+
+namespace vbag {
+
+namespace {
+
+/// @brief How many chunks every thread gets, so the ones that finish first
+/// have something left to steal.
+constexpr size_t chunksPerThread{4};
+
+/// @brief How many times an idle worker looks for jobs before sleeping.
+constexpr int idleSpins{64};
+
+/// @brief The worker the calling thread is, of whichever job system.
+thread_local void *currentWorker{};
+
+} // namespace
+
+bool JobCounter::done() const { return pending_.load() == 0; }
+
+bool JobSystem::WorkDeque::push(Job *job) {
+  const auto bottom{bottom_.load(std::memory_order_relaxed)},
+      top{top_.load(std::memory_order_acquire)};
+  if (bottom - top >= capacity_)
+    return false;
+  jobs_[bottom & (capacity_ - 1)].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(bottom + 1, std::memory_order_relaxed);
+  return true;
+}
+
+JobSystem::Job *JobSystem::WorkDeque::pop() {
+  const auto bottom{bottom_.load(std::memory_order_relaxed) - 1};
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto top{top_.load(std::memory_order_relaxed)};
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  auto *job{jobs_[bottom & (capacity_ - 1)].load(std::memory_order_relaxed)};
+  if (top == bottom) {
+    // the last job: whoever moves the top past it gets it
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      job = nullptr;
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+JobSystem::Job *JobSystem::WorkDeque::steal() {
+  auto top{top_.load(std::memory_order_acquire)};
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const auto bottom{bottom_.load(std::memory_order_acquire)};
+  if (top >= bottom)
+    return nullptr;
+  auto *job{jobs_[top & (capacity_ - 1)].load(std::memory_order_relaxed)};
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
+    return nullptr;
+  return job;
+}
+
+JobSystem::JobSystem(size_t threads) {
+  if (threads == 0)
+    threads = (std::max)(1u, std::thread::hardware_concurrency());
+  for (size_t i{}; i + 1 < threads; ++i)
+    workers_.emplace_back(new Worker{this, i, {}});
+  threads_.reserve(workers_.size());
+  for (auto &worker : workers_)
+    threads_.emplace_back([this, &worker = *worker] { workerLoop_(worker); });
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock{sleepMutex_};
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+  while (auto *job{find_()})
+    delete job;
+  while (auto *job{freeJobs_}) {
+    freeJobs_ = job->next;
+    delete job;
+  }
+}
+
+size_t JobSystem::threadCount() const { return workers_.size() + 1; }
+
+size_t JobSystem::threadIndex() const {
+  const auto *worker{currentWorker_()};
+  return worker ? worker->index + 1 : 0;
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter &counter) {
+  ++counter.pending_;
+  push_(acquire_(std::move(job), counter));
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter &counter,
+                    JobCounter &dependency) {
+  ++counter.pending_;
+  auto *pending{acquire_(std::move(job), counter)};
+  {
+    std::lock_guard lock{dependency.mutex_};
+    if (dependency.pending_.load() != 0) {
+      dependency.dependents_.push_back(pending);
+      return;
+    }
+  }
+  push_(pending);
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  while (counter.pending_.load() != 0) {
+    if (auto *job{find_()})
+      execute_(job);
+    else
+      std::this_thread::yield();
+  }
+  // the last job to finish may still be holding the lock
+  std::lock_guard lock{counter.mutex_};
+  if (auto error{std::exchange(counter.error_, nullptr)})
+    std::rethrow_exception(error);
+}
+
+size_t JobSystem::chunkCount(size_t items, size_t minChunkSize) const {
+  minChunkSize = (std::max)(minChunkSize, size_t{1});
+  const auto chunks{(items + minChunkSize - 1) / minChunkSize};
+  return (std::max)(size_t{1},
+                    (std::min)(threadCount() > 1
+                                   ? threadCount() * chunksPerThread
+                                   : size_t{1},
+                               chunks));
+}
+
+JobSystem::Job *JobSystem::acquire_(std::function<void()> body,
+                                    JobCounter &counter) {
+  Job *job;
+  {
+    std::lock_guard lock{freeJobsMutex_};
+    ++jobsQueued_;
+    job = freeJobs_;
+    if (job)
+      freeJobs_ = job->next;
+    else
+      ++jobCount_;
+  }
+  if (!job)
+    return new Job{std::move(body), &counter, nullptr};
+  job->body = std::move(body);
+  job->counter = &counter;
+  return job;
+}
+
+void JobSystem::reserveJobs() {
+  std::lock_guard lock{freeJobsMutex_};
+  for (; jobCount_ < jobsQueued_; ++jobCount_)
+    freeJobs_ = new Job{nullptr, nullptr, freeJobs_};
+  jobsQueued_ = 0;
+}
+
+void JobSystem::release_(Job *job) {
+  // whatever the body captured goes now, not when the job is reused
+  job->body = nullptr;
+  std::lock_guard lock{freeJobsMutex_};
+  job->next = freeJobs_;
+  freeJobs_ = job;
+}
+
+void JobSystem::push_(Job *job) {
+  ++queued_;
+  auto *worker{currentWorker_()};
+  if (!worker || !worker->deque.push(job)) {
+    std::lock_guard lock{sharedMutex_};
+    job->next = nullptr;
+    (sharedBack_ ? sharedBack_->next : sharedFront_) = job;
+    sharedBack_ = job;
+  }
+  if (sleeping_.load() != 0) {
+    // taking the lock makes sure a worker about to sleep sees the job
+    { std::lock_guard lock{sleepMutex_}; }
+    wake_.notify_one();
+  }
+}
+
+JobSystem::Job *JobSystem::find_() {
+  if (queued_.load() == 0)
+    return nullptr;
+  auto *worker{currentWorker_()};
+  Job *job{worker ? worker->deque.pop() : nullptr};
+  if (!job) {
+    std::lock_guard lock{sharedMutex_};
+    if (sharedFront_) {
+      job = sharedFront_;
+      sharedFront_ = job->next;
+      if (!sharedFront_)
+        sharedBack_ = nullptr;
+    }
+  }
+  // the victims are tried starting right after the thief, so thieves don't
+  // all pile onto the first worker
+  const auto first{worker ? worker->index + 1 : 0};
+  for (size_t i{}; !job && i < workers_.size(); ++i) {
+    auto &victim{*workers_[(first + i) % workers_.size()]};
+    if (&victim != worker)
+      job = victim.deque.steal();
+  }
+  if (job)
+    --queued_;
+  return job;
+}
+
+void JobSystem::execute_(Job *job) {
+  std::exception_ptr error;
+  try {
+    job->body();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  auto &counter{*job->counter};
+  release_(job);
+  std::vector<Job *> dependents;
+  {
+    std::lock_guard lock{counter.mutex_};
+    if (error && !counter.error_)
+      counter.error_ = error;
+    if (--counter.pending_ == 0)
+      dependents.swap(counter.dependents_);
+  }
+  for (auto *dependent : dependents)
+    push_(dependent);
+}
+
+void JobSystem::workerLoop_(Worker &worker) {
+  currentWorker = &worker;
+  int spins{};
+  while (!stopping_.load()) {
+    if (auto *job{find_()}) {
+      execute_(job);
+      spins = 0;
+      continue;
+    }
+    if (++spins < idleSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+    std::unique_lock lock{sleepMutex_};
+    ++sleeping_;
+    wake_.wait(lock, [&] { return queued_.load() != 0 || stopping_.load(); });
+    --sleeping_;
+  }
+}
+
+JobSystem::Worker *JobSystem::currentWorker_() const {
+  auto *worker{static_cast<Worker *>(currentWorker)};
+  return worker && worker->system == this ? worker : nullptr;
+}
+
+} // namespace vbag
@@ -0,0 +1,84 @@
+#include "util/mapped_file.hpp"
+
+#include "util/error_handling.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vbag {
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &path) {
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE)
+    throw RuntimeError<CouldNotOpenFile>{};
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file_, &size)) {
+    CloseHandle(file_);
+    throw RuntimeError<CouldNotOpenFile>{};
+  }
+  size_ = size_t(size.QuadPart);
+  // empty files can't be mapped, but there's nothing to read anyway
+  if (size_ == 0)
+    return;
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_)
+    data_ = static_cast<const char *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    if (mapping_)
+      CloseHandle(mapping_);
+    CloseHandle(file_);
+    throw RuntimeError<CouldNotOpenFile>{};
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+  const auto descriptor{open(path.c_str(), O_RDONLY)};
+  if (descriptor < 0)
+    throw RuntimeError<CouldNotOpenFile>{};
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0) {
+    close(descriptor);
+    throw RuntimeError<CouldNotOpenFile>{};
+  }
+  size_ = size_t(status.st_size);
+  if (size_ > 0) {
+    auto mapping{mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+    if (mapping == MAP_FAILED) {
+      close(descriptor);
+      throw RuntimeError<CouldNotOpenFile>{};
+    }
+    madvise(mapping, size_, MADV_WILLNEED);
+    data_ = static_cast<const char *>(mapping);
+  }
+  // the mapping stays valid after the descriptor is closed
+  close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    munmap(const_cast<char *>(data_), size_);
+}
+
+#endif
+
+} // namespace vbag
@@ -0,0 +1,197 @@
+#include "util/profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "util/error_handling.hpp"
+
+namespace vbag {
+
+namespace {
+
+/// @brief Appends a string to JSON output, quoted and escaped.
+void appendJsonString(std::string &out, const char *string) {
+  out += '"';
+  for (; *string; ++string) {
+    const auto c{*string};
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", unsigned(c));
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+} // namespace
+
+Profiler &Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+    : startTicks_{now()}, startTime_{std::chrono::steady_clock::now()} {}
+
+void Profiler::markFrame() {
+  const auto end{now()};
+  const auto start{frameStart_.exchange(end)};
+  if (start != 0)
+    record(frameName, start, end, 0);
+}
+
+std::vector<Profiler::Zone> Profiler::zones() const {
+  const auto ticksPerNanosecond{ticksPerNanosecond_()};
+  std::vector<Zone> zones;
+  std::lock_guard lock{ringsMutex_};
+  for (const auto &ring : rings_) {
+    const auto head{ring->head.load(std::memory_order_acquire)};
+    const auto first{head > capacity ? head - capacity : 0};
+    const auto begin{zones.size()};
+    for (auto i{first}; i < head; ++i) {
+      const auto &slot{ring->slots[i & (capacity - 1)]};
+      zones.push_back({slot.name.load(std::memory_order_relaxed),
+                       slot.start.load(std::memory_order_relaxed),
+                       slot.end.load(std::memory_order_relaxed), ring->thread,
+                       slot.depth.load(std::memory_order_relaxed)});
+    }
+    // the zones the thread recorded meanwhile may have overwritten the
+    // oldest ones read, which are dropped. so is the one the slot at newHead
+    // held, since the thread may be writing it over right now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto newHead{ring->head.load(std::memory_order_relaxed)};
+    if (newHead + 1 > first + capacity) {
+      const auto overwritten{(std::min)(size_t(newHead + 1 - first - capacity),
+                                        zones.size() - begin)};
+      zones.erase(zones.begin() + std::ptrdiff_t(begin),
+                  zones.begin() + std::ptrdiff_t(begin + overwritten));
+    }
+  }
+  for (auto &zone : zones) {
+    zone.start = toNanoseconds_(zone.start, ticksPerNanosecond);
+    zone.end = toNanoseconds_(zone.end, ticksPerNanosecond);
+  }
+  std::sort(zones.begin(), zones.end(), [](const Zone &a, const Zone &b) {
+    return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+  });
+  return zones;
+}
+
+void Profiler::writeChromeTrace(const std::string &path) const {
+  std::string json{"{\"displayTimeUnit\":\"ms\",\"traceEvents\":["};
+  auto first{true};
+  for (const auto &zone : zones()) {
+    if (!first)
+      json += ',';
+    first = false;
+    json += "\n{\"name\":";
+    appendJsonString(json, zone.name);
+    // complete events, timed in microseconds
+    char fields[128];
+    std::snprintf(fields, sizeof fields,
+                  ",\"cat\":\"vbag\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"pid\":0,\"tid\":%u}",
+                  double(zone.start) / 1e3,
+                  double(zone.end - zone.start) / 1e3, unsigned(zone.thread));
+    json += fields;
+  }
+  json += "\n]}\n";
+
+  auto *file{std::fopen(path.c_str(), "wb")};
+  if (!file)
+    throw RuntimeError<CouldNotOpenFile>{};
+  const auto written{std::fwrite(json.data(), 1, json.size(), file)};
+  if (std::fclose(file) != 0 || written != json.size())
+    throw RuntimeError<CouldNotOpenFile>{};
+}
+
+std::string Profiler::frameSummary() const {
+  const auto zones{this->zones()};
+  const Zone *frame{};
+  for (const auto &zone : zones)
+    if (std::strcmp(zone.name, frameName) == 0 &&
+        (!frame || zone.start > frame->start))
+      frame = &zone;
+  if (!frame)
+    return {};
+
+  struct Total {
+    const char *name;
+    size_t calls;
+    uint64_t total, longest;
+  };
+  std::vector<Total> totals;
+  for (const auto &zone : zones) {
+    if (zone.start < frame->start || zone.start >= frame->end ||
+        &zone == frame)
+      continue;
+    auto total{std::find_if(totals.begin(), totals.end(), [&](auto &t) {
+      return std::strcmp(t.name, zone.name) == 0;
+    })};
+    if (total == totals.end())
+      total = totals.insert(totals.end(), {zone.name, 0, 0, 0});
+    const auto duration{zone.end - zone.start};
+    ++total->calls;
+    total->total += duration;
+    total->longest = (std::max)(total->longest, duration);
+  }
+  std::sort(totals.begin(), totals.end(),
+            [](const Total &a, const Total &b) { return a.total > b.total; });
+
+  std::string summary;
+  char line[160];
+  std::snprintf(line, sizeof line, "frame %.3f ms\n%-24s %8s %12s %12s\n",
+                double(frame->end - frame->start) / 1e6, "zone", "calls",
+                "total ms", "longest ms");
+  summary += line;
+  for (const auto &total : totals) {
+    std::snprintf(line, sizeof line, "%-24.24s %8zu %12.3f %12.3f\n",
+                  total.name, total.calls, double(total.total) / 1e6,
+                  double(total.longest) / 1e6);
+    summary += line;
+  }
+  return summary;
+}
+
+Profiler::Ring &Profiler::addRing_() {
+  auto ring{std::make_unique<Ring>()};
+  ring->slots = std::make_unique<Slot[]>(capacity);
+  std::lock_guard lock{ringsMutex_};
+  ring->thread = uint32_t(rings_.size());
+  // the rings outlive their threads, so their zones can still be exported
+  return *rings_.emplace_back(std::move(ring));
+}
+
+uint64_t Profiler::toNanoseconds_(uint64_t ticks,
+                                  double ticksPerNanosecond) const {
+  if (ticks <= startTicks_)
+    return 0;
+  return uint64_t(double(ticks - startTicks_) / ticksPerNanosecond);
+}
+
+double Profiler::ticksPerNanosecond_() const {
+#if defined(VBAG_PROFILER_RDTSC)
+  // the counter is compared against steady_clock over the whole time the
+  // profiler has run, which makes the ratio more accurate the longer that is
+  auto elapsed{std::chrono::steady_clock::now() - startTime_};
+  if (elapsed < std::chrono::milliseconds{10}) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10} - elapsed);
+    elapsed = std::chrono::steady_clock::now() - startTime_;
+  }
+  const auto ticks{now() - startTicks_};
+  return double(ticks) /
+         double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                    .count());
+#else
+  return 1;
+#endif
+}
+
+} // namespace vbag